@@ -69,6 +69,9 @@
 #define RELAY_SRC_PORT  (RELAY_DST_PORT - 1)
 
 #define GDL90_DST_PORT    4000
+#define GDL90_TCP_PORT    4000
+#define D1090_UDP_PORT    30002
+#define D1090_TCP_PORT    30002
 #define NMEA_UDP_PORT     10110
 #define NMEA_TCP_PORT     2000
 
@@ -112,7 +115,6 @@
 #endif /* PREMIUM_PACKAGE */
 
 typedef struct UFO {
-    uint8_t   raw[34];
     time_t    timestamp;
 
     uint8_t   protocol;
@@ -134,6 +136,7 @@ typedef struct UFO {
 
     int8_t    ns[4];
     int8_t    ew[4];
+    uint8_t   smult; /* ns/ew unit is (1 << smult) / 4 m/s */
 
     float     geoid_separation; /* metres */
     uint16_t  hdop; /* cm */
@@ -338,6 +338,8 @@ void shutdown(int reason)
   Sound_fini();
 
   NMEA_fini();
+  GDL90_fini();
+  D1090_fini();
 
   Web_fini();
 
@@ -432,14 +434,13 @@ void normal()
 
   Sound_loop();
 
-  if (isTimeToExport()) {
+  if (Traffic_Export_Tick()) {
     NMEA_Export();
     GDL90_Export();
 
     if (isValidFix()) {
       D1090_Export();
     }
-    ExportTimeMarker = millis();
   }
 
   // Handle Air Connect
@@ -501,15 +502,15 @@ void bridge()
   if(success)
   {
     size_t rx_size = RF_Payload_Size(settings->rf_protocol);
-    rx_size = rx_size > sizeof(fo.raw) ? sizeof(fo.raw) : rx_size;
+    rx_size = rx_size > sizeof(fo_raw) ? sizeof(fo_raw) : rx_size;
 
-    memset(fo.raw, 0, sizeof(fo.raw));
-    memcpy(fo.raw, RxBuffer, rx_size);
+    memset(fo_raw, 0, sizeof(fo_raw));
+    memcpy(fo_raw, RxBuffer, rx_size);
 
     if (settings->nmea_p) {
       StdOut.print(F("$PSRFI,"));
       StdOut.print((unsigned long) now());    StdOut.print(F(","));
-      StdOut.print(Bin2Hex(fo.raw, rx_size)); StdOut.print(F(","));
+      StdOut.print(Bin2Hex(fo_raw, rx_size)); StdOut.print(F(","));
       StdOut.println(RF_last_rssi);
     }
 
@@ -532,15 +533,15 @@ void watchout()
 
   if (success) {
     size_t rx_size = RF_Payload_Size(settings->rf_protocol);
-    rx_size = rx_size > sizeof(fo.raw) ? sizeof(fo.raw) : rx_size;
+    rx_size = rx_size > sizeof(fo_raw) ? sizeof(fo_raw) : rx_size;
 
-    memset(fo.raw, 0, sizeof(fo.raw));
-    memcpy(fo.raw, RxBuffer, rx_size);
+    memset(fo_raw, 0, sizeof(fo_raw));
+    memcpy(fo_raw, RxBuffer, rx_size);
 
     if (settings->nmea_p) {
       StdOut.print(F("$PSRFI,"));
       StdOut.print((unsigned long) now());    StdOut.print(F(","));
-      StdOut.print(Bin2Hex(fo.raw, rx_size)); StdOut.print(F(","));
+      StdOut.print(Bin2Hex(fo_raw, rx_size)); StdOut.print(F(","));
       StdOut.println(RF_last_rssi);
     }
   }
@@ -635,14 +636,15 @@ void txrx_test()
 #if DEBUG_TIMING
   export_start_ms = millis();
 #endif
-  if (isTimeToExport()) {
+  if (Traffic_Export_Tick()) {
 #if defined(USE_NMEALIB)
-    NMEA_Position();
+    if (Traffic_Export_Beat()) {
+      NMEA_Position();
+    }
 #endif
     NMEA_Export();
     GDL90_Export();
     D1090_Export();
-    ExportTimeMarker = millis();
   }
 #if DEBUG_TIMING
   export_end_ms = millis();
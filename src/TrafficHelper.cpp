@@ -23,14 +23,1243 @@
 #include "driver/Sound.h"
 #include "ui/Web.h"
 #include "protocol/radio/Legacy.h"
+#include "protocol/data/NMEA.h"
 
 unsigned long UpdateTrafficTimeMarker = 0;
 
 ufo_t fo, Container[MAX_TRACKING_OBJECTS], EmptyFO;
+uint8_t fo_raw[RAW_DATA_SIZE];
+traffic_hot_t Traffic_Hot;
 traffic_by_dist_t traffic_by_dist[MAX_TRACKING_OBJECTS];
 
 static int8_t (*Alarm_Level)(ufo_t *, ufo_t *);
 
+/*
+ * Traffic store.
+ *
+ * Container[] slots are handed out from a stack of free slot numbers.
+ * Slots with known aircraft ID are indexed by (addr, protocol) in
+ * a linear probing hash table. The index has at least twice as many
+ * cells as there can be keys, so the probe sequences are short.
+ * A fused slot (see below) is indexed once per source.
+ * One cell is always left empty, it ends every probe sequence.
+ */
+static uint16_t Traffic_Index[TRAFFIC_INDEX_SIZE];
+static uint32_t Traffic_Index_Key[TRAFFIC_INDEX_SIZE];
+static uint16_t Traffic_Free[MAX_TRACKING_OBJECTS];
+static uint16_t Traffic_Free_Count    = 0;
+static uint16_t Traffic_Indexed_Count = 0;
+static uint16_t Traffic_Index_Cells   = 0;
+static bool     Traffic_Busy[MAX_TRACKING_OBJECTS];
+static bool     Traffic_Store_Ready   = false;
+
+/*
+ * Busy slots are also linked oldest first, in the order of their last
+ * update. A slot moves to the end whenever it is stored, so the first
+ * one is the first to expire.
+ */
+#define TRAFFIC_AGE_NONE        0xFFFF
+
+static uint16_t Traffic_Older[MAX_TRACKING_OBJECTS];
+static uint16_t Traffic_Newer[MAX_TRACKING_OBJECTS];
+static uint16_t Traffic_Oldest        = TRAFFIC_AGE_NONE;
+static uint16_t Traffic_Newest        = TRAFFIC_AGE_NONE;
+
+#if defined(TRAFFIC_RAW_STORAGE)
+/* cold side table, only relayed entries carry raw data */
+static uint8_t  Traffic_Raw_Data[MAX_TRACKING_OBJECTS][RAW_DATA_SIZE];
+static uint8_t  Traffic_Raw_Size[MAX_TRACKING_OBJECTS];
+#endif /* TRAFFIC_RAW_STORAGE */
+
+#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
+/*
+ * Eviction queue.
+ *
+ * Binary min-heap of busy Container[] slots with the least relevant
+ * target on top. Targets are ordered by alarm level first, then by
+ * 'threat range': the distance, shortened for targets which are
+ * about to close in within TRAFFIC_THREAT_HORIZON seconds.
+ */
+#define TRAFFIC_THREAT_HORIZON  60    /* seconds */
+#define TRAFFIC_THREAT_SPEED    50.0  /* m/s, nominal closure rate */
+#define TRAFFIC_HEAP_NONE       0xFFFF
+
+static uint16_t Traffic_Heap[MAX_TRACKING_OBJECTS];
+static uint16_t Traffic_Heap_Pos[MAX_TRACKING_OBJECTS];
+static uint16_t Traffic_Heap_Size = 0;
+static float    Traffic_Threat_Range[MAX_TRACKING_OBJECTS];
+#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
+
+/*
+ * Dead reckoning.
+ *
+ * Every fix put into the store keeps its position, course and turn rate
+ * together with millis() at reception. Traffic_Extrapolate() moves the
+ * Container[] entries from their last fix to "now": piecewise linear along
+ * the announced NS/EW vectors for Legacy traffic, constant turn rate
+ * for the rest (constant velocity when the rate is unknown).
+ * Projection never goes beyond TRAFFIC_DR_HORIZON. Expired entries and
+ * those without aircraft ID stay where they were received. Traffic_Fix[]
+ * keeps the received fix, a projected entry is flagged until the next one.
+ */
+#define TRAFFIC_DR_HORIZON      8   /* seconds */
+#define TRAFFIC_DR_INTERVAL_MS  100 /* min. time between two projections */
+#define TRAFFIC_DR_MIN_TURN     0.1 /* degrees per second */
+
+typedef struct traffic_fix_struct {
+  float    latitude;
+  float    longitude;
+  float    altitude;
+  float    course;
+  float    turn_rate;   /* degrees per second */
+  uint32_t ms;          /* millis() at reception */
+  uint8_t  protocol;    /* source of the fix */
+  bool     projected;   /* Container[] entry is ahead of the fix */
+} traffic_fix_t;
+
+static traffic_fix_t Traffic_Fix[MAX_TRACKING_OBJECTS];
+static unsigned long Traffic_DR_TimeMarker = 0;
+
+#if !defined(EXCLUDE_TRAFFIC_FUSION)
+/*
+ * Fusion.
+ *
+ * One aircraft may be heard through several protocols at a time.
+ * A record of another protocol joins an existing track when it carries
+ * the same ICAO or FLARM address, or else when it falls within
+ * TRAFFIC_FUSION_RANGE of a track which has no record of that protocol.
+ * Each slot lists its sources; entry 0 is the one the slot was
+ * created for, the slot keeps its ID and protocol. Position and velocity
+ * come from the best ranked fresh source, Traffic_Fix[] tells which one,
+ * and the alarm level goes with them. Other fields come from any source
+ * having them.
+ *
+ * A record is matched by address through the index, one lookup per
+ * protocol. Otherwise it is matched by range against the tracks whose
+ * last fix lies in its own or a neighbouring cell of a grid of
+ * TRAFFIC_FUSION_CELL degrees; the cells of a row are as wide as high.
+ */
+#define TRAFFIC_FUSION_FRESH_MS 3000  /* a source is fresh that long after its last record */
+#define TRAFFIC_FUSION_RANGE    250   /* metres, horizontal gate */
+#define TRAFFIC_FUSION_VRANGE   150   /* metres, vertical gate */
+#define TRAFFIC_FUSION_COURSE   45    /* degrees, when both are faster than 20 knots */
+#define TRAFFIC_FUSION_SPLIT    1000  /* metres, a source this far off leaves the track */
+#define TRAFFIC_FUSION_CELL     0.01  /* degrees, gate plus 3 s of a fast mover */
+#define TRAFFIC_FUSION_GRID_BITS 4
+#define TRAFFIC_FUSION_GRID     (1 << TRAFFIC_FUSION_GRID_BITS)
+#define TRAFFIC_FUSION_NONE     0xFFFF
+
+typedef struct traffic_source_struct {
+  uint32_t addr;
+  uint32_t ms;          /* millis() at the last record */
+  uint8_t  protocol;
+  uint8_t  addr_type;
+} traffic_source_t;
+
+static traffic_source_t Traffic_Source[MAX_TRACKING_OBJECTS][TRAFFIC_FUSION_SOURCES];
+static uint8_t          Traffic_Source_Count[MAX_TRACKING_OBJECTS];
+static uint16_t         Traffic_Grid[TRAFFIC_FUSION_GRID];          /* first slot of a cell */
+static uint16_t         Traffic_Grid_Next[MAX_TRACKING_OBJECTS];    /* next slot of the cell */
+static uint8_t          Traffic_Grid_Cell[MAX_TRACKING_OBJECTS];
+static bool             Traffic_Grid_Busy[MAX_TRACKING_OBJECTS];
+
+static const uint8_t Traffic_Fusion_Protocols[] = {
+  RF_PROTOCOL_LEGACY, RF_PROTOCOL_OGNTP, RF_PROTOCOL_P3I,
+  RF_PROTOCOL_ADSB_1090, RF_PROTOCOL_ADSB_UAT, RF_PROTOCOL_FANET
+};
+#endif /* EXCLUDE_TRAFFIC_FUSION */
+
+#if !defined(EXCLUDE_TRAFFIC_HISTORY)
+/*
+ * Track history.
+ *
+ * Rings of the last TRAFFIC_HISTORY_SIZE received fixes are taken
+ * from a pool when a slot with aircraft ID is put into use, and go
+ * back to the pool when the slot is released. Appending is O(1),
+ * a slot has no history while the pool is empty.
+ */
+#define TRAFFIC_HISTORY_MASK  (TRAFFIC_HISTORY_SIZE - 1)
+#define TRAFFIC_HISTORY_NONE  0xFFFF
+
+typedef struct traffic_history_struct {
+  traffic_point_t point[TRAFFIC_HISTORY_SIZE];
+  uint8_t         head;   /* next point to write */
+  uint8_t         count;
+} traffic_history_t;
+
+static traffic_history_t Traffic_History_Pool[TRAFFIC_HISTORY_POOL];
+static uint16_t Traffic_History_Free[TRAFFIC_HISTORY_POOL];
+static uint16_t Traffic_History_Free_Count = 0;
+static uint16_t Traffic_History_Ring[MAX_TRACKING_OBJECTS];
+#endif /* EXCLUDE_TRAFFIC_HISTORY */
+
+#if !defined(EXCLUDE_TRAFFIC_SNAPSHOT)
+/*
+ * Snapshot.
+ *
+ * Traffic_Publish() copies the targets into the buffer which is not
+ * published and then swaps the published pointer. Readers pin the
+ * buffer they got with a reference count instead of a lock. A pinned
+ * buffer is never rewritten, publication is skipped until the next call.
+ */
+static traffic_snapshot_t  Traffic_Snapshot_Buffer[2];
+static traffic_snapshot_t *Traffic_Snapshot_Current = &Traffic_Snapshot_Buffer[0];
+#endif /* EXCLUDE_TRAFFIC_SNAPSHOT */
+
+static uint32_t Traffic_Export_Tick_ms  = 0;
+static uint32_t Traffic_Export_Beat_ms  = 0;
+static bool     Traffic_Export_Beat_Now = false;
+
+#if !defined(EXCLUDE_TRAFFIC_SCHEDULER)
+/*
+ * Export scheduler.
+ *
+ * Every sink remembers when a slot was reported last and with which
+ * alarm level. A slot is due when it has a fix newer than the report
+ * and the period of its range is over, when it had no fix for
+ * TRAFFIC_EXPORT_SLOW_MS, or at once when its alarm level has gone up.
+ * A byte budget per output port keeps slow links (UART, SPP) from
+ * flooding. All the sinks on a port draw from its budget, and so do
+ * the bytes they write besides the reports of targets (PFLAU, GNSS
+ * sentences, heartbeats). A report is charged when it is built, so
+ * that the budget holds within one tick; Traffic_Export_Out() then
+ * charges only what was not charged before.
+ * While the budget is short, distant targets wait longer and longer,
+ * so that they are served oldest first rather than in slot order.
+ */
+#define TRAFFIC_EXPORT_PORTS    (NMEA_BLUETOOTH + 1)
+
+static uint32_t Traffic_Export_ms[TRAFFIC_SINK_COUNT][MAX_TRACKING_OBJECTS];
+static int8_t   Traffic_Export_Level[TRAFFIC_SINK_COUNT][MAX_TRACKING_OBJECTS];
+static uint8_t  Traffic_Export_Port[TRAFFIC_SINK_COUNT];
+static int32_t  Traffic_Export_Budget[TRAFFIC_EXPORT_PORTS];
+static uint32_t Traffic_Export_Rate[TRAFFIC_EXPORT_PORTS]; /* bytes per second, 0 - no limit */
+static uint32_t Traffic_Export_Refill_ms[TRAFFIC_EXPORT_PORTS];
+static uint32_t Traffic_Export_Charged[TRAFFIC_EXPORT_PORTS]; /* reports not written yet */
+static uint32_t Traffic_Export_Backlog[TRAFFIC_SINK_COUNT]; /* extra wait of distant targets */
+static bool     Traffic_Export_Short[TRAFFIC_SINK_COUNT];   /* budget has held a target back */
+static uint32_t Traffic_Export_Now      = 0;
+static uint8_t  Traffic_Export_Active   = 0; /* mask of sinks in use */
+static bool     Traffic_Export_Urgent   = false;
+
+/* a rise of the alarm level brings the next export tick forward */
+static void Traffic_Export_Check(uint16_t ndx)
+{
+  for (int s=0; s < TRAFFIC_SINK_COUNT; s++) {
+    if ((Traffic_Export_Active & (1 << s)) &&
+        Container[ndx].alarm_level > Traffic_Export_Level[s][ndx]) {
+      Traffic_Export_Urgent = true;
+      break;
+    }
+  }
+}
+
+/* a new target goes out with the next tick of every sink */
+static void Traffic_Export_Reset(uint16_t ndx)
+{
+  for (int s=0; s < TRAFFIC_SINK_COUNT; s++) {
+    Traffic_Export_ms[s][ndx]    = millis() - TRAFFIC_EXPORT_SLOW_MS;
+    Traffic_Export_Level[s][ndx] = ALARM_LEVEL_NONE;
+  }
+}
+
+#else
+
+#define Traffic_Export_Check(ndx) {}
+#define Traffic_Export_Reset(ndx) {}
+
+#endif /* EXCLUDE_TRAFFIC_SCHEDULER */
+
+static void Traffic_Store_setup()
+{
+  memset(Traffic_Index, 0, sizeof(Traffic_Index));
+
+  /* lower slots are taken first */
+  for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    Traffic_Free[i] = MAX_TRACKING_OBJECTS - 1 - i;
+    Traffic_Busy[i] = false;
+    Traffic_Hot.addr[i]      = 0;
+    Traffic_Hot.timestamp[i] = 0;
+    Traffic_Hot.protocol[i]  = 0;
+#if defined(TRAFFIC_RAW_STORAGE)
+    Traffic_Raw_Size[i] = 0;
+#endif /* TRAFFIC_RAW_STORAGE */
+#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
+    Traffic_Heap_Pos[i] = TRAFFIC_HEAP_NONE;
+#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
+#if !defined(EXCLUDE_TRAFFIC_FUSION)
+    Traffic_Source_Count[i] = 0;
+    Traffic_Grid_Busy[i]    = false;
+#endif /* EXCLUDE_TRAFFIC_FUSION */
+#if !defined(EXCLUDE_TRAFFIC_HISTORY)
+    Traffic_History_Ring[i] = TRAFFIC_HISTORY_NONE;
+#endif /* EXCLUDE_TRAFFIC_HISTORY */
+  }
+
+#if !defined(EXCLUDE_TRAFFIC_FUSION)
+  for (int i=0; i < TRAFFIC_FUSION_GRID; i++) {
+    Traffic_Grid[i] = TRAFFIC_FUSION_NONE;
+  }
+#endif /* EXCLUDE_TRAFFIC_FUSION */
+
+#if !defined(EXCLUDE_TRAFFIC_HISTORY)
+  for (int i=0; i < TRAFFIC_HISTORY_POOL; i++) {
+    Traffic_History_Free[i] = TRAFFIC_HISTORY_POOL - 1 - i;
+  }
+  Traffic_History_Free_Count = TRAFFIC_HISTORY_POOL;
+#endif /* EXCLUDE_TRAFFIC_HISTORY */
+
+#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
+  Traffic_Heap_Size     = 0;
+#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
+  Traffic_Free_Count    = MAX_TRACKING_OBJECTS;
+  Traffic_Oldest        = TRAFFIC_AGE_NONE;
+  Traffic_Newest        = TRAFFIC_AGE_NONE;
+  Traffic_Indexed_Count = 0;
+  Traffic_Index_Cells   = 0;
+  Traffic_Store_Ready   = true;
+}
+
+static inline uint32_t Traffic_Key(uint32_t addr, uint8_t protocol)
+{
+  return (addr & 0x00FFFFFF) ^ ((uint32_t) protocol << 24);
+}
+
+static inline uint16_t Traffic_Hash(uint32_t key)
+{
+  /* Fibonacci hashing */
+  return (uint16_t) (((uint32_t) (key * 2654435761U)) >> (32 - TRAFFIC_INDEX_BITS));
+}
+
+static int Traffic_Index_Find(uint32_t addr, uint8_t protocol)
+{
+  uint32_t key  = Traffic_Key(addr, protocol);
+  uint16_t cell = Traffic_Hash(key);
+
+  for (int probe=0; probe < TRAFFIC_INDEX_SIZE; probe++) {
+    if (Traffic_Index[cell] == TRAFFIC_INDEX_EMPTY) {
+      break;
+    }
+
+    if (Traffic_Index_Key[cell] == key) {
+      return cell;
+    }
+
+    cell = (cell + 1) & TRAFFIC_INDEX_MASK;
+  }
+
+  return -1;
+}
+
+static bool Traffic_Index_Insert(uint16_t ndx, uint32_t addr, uint8_t protocol)
+{
+  uint32_t key  = Traffic_Key(addr, protocol);
+  uint16_t cell = Traffic_Hash(key);
+
+  if (Traffic_Index_Cells >= TRAFFIC_INDEX_SIZE - 1) {
+    return false;
+  }
+
+  for (int probe=0; probe < TRAFFIC_INDEX_SIZE; probe++) {
+    if (Traffic_Index[cell] == TRAFFIC_INDEX_EMPTY) {
+      Traffic_Index[cell]     = ndx + 1;
+      Traffic_Index_Key[cell] = key;
+      Traffic_Index_Cells++;
+      return true;
+    }
+
+    cell = (cell + 1) & TRAFFIC_INDEX_MASK;
+  }
+
+  return false;
+}
+
+/* backward shift deletion keeps the probe sequences intact without tombstones */
+static void Traffic_Index_Delete(uint16_t cell)
+{
+  uint16_t hole = cell;
+  uint16_t next = (cell + 1) & TRAFFIC_INDEX_MASK;
+
+  while (Traffic_Index[next] != TRAFFIC_INDEX_EMPTY) {
+    uint16_t home = Traffic_Hash(Traffic_Index_Key[next]);
+
+    if (((next - home) & TRAFFIC_INDEX_MASK) >= ((next - hole) & TRAFFIC_INDEX_MASK)) {
+      Traffic_Index[hole]     = Traffic_Index[next];
+      Traffic_Index_Key[hole] = Traffic_Index_Key[next];
+      hole = next;
+    }
+
+    next = (next + 1) & TRAFFIC_INDEX_MASK;
+  }
+
+  Traffic_Index[hole] = TRAFFIC_INDEX_EMPTY;
+  Traffic_Index_Cells--;
+}
+
+static inline int Traffic_Slot(ufo_t *fop)
+{
+  int ndx = fop - Container;
+
+  return (ndx >= 0 && ndx < MAX_TRACKING_OBJECTS && Traffic_Busy[ndx]) ? ndx : -1;
+}
+
+static void Traffic_Age_Unlink(uint16_t ndx)
+{
+  uint16_t older = Traffic_Older[ndx];
+  uint16_t newer = Traffic_Newer[ndx];
+
+  if (older == TRAFFIC_AGE_NONE) {
+    Traffic_Oldest = newer;
+  } else {
+    Traffic_Newer[older] = newer;
+  }
+
+  if (newer == TRAFFIC_AGE_NONE) {
+    Traffic_Newest = older;
+  } else {
+    Traffic_Older[newer] = older;
+  }
+}
+
+static void Traffic_Age_Append(uint16_t ndx)
+{
+  Traffic_Older[ndx] = Traffic_Newest;
+  Traffic_Newer[ndx] = TRAFFIC_AGE_NONE;
+
+  if (Traffic_Newest == TRAFFIC_AGE_NONE) {
+    Traffic_Oldest = ndx;
+  } else {
+    Traffic_Newer[Traffic_Newest] = ndx;
+  }
+  Traffic_Newest = ndx;
+}
+
+/* a slot has just been updated */
+static inline void Traffic_Age_Touch(uint16_t ndx)
+{
+  if (Traffic_Newest != ndx) {
+    Traffic_Age_Unlink(ndx);
+    Traffic_Age_Append(ndx);
+  }
+}
+
+#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
+
+static float Traffic_Threat(ufo_t *fop)
+{
+  float range = fop->distance;
+
+  /* relative position (m) and velocity (m/s) of the target, East/North */
+  float rx = range * sinf(radians(fop->bearing));
+  float ry = range * cosf(radians(fop->bearing));
+  float vx = (fop->speed        * sinf(radians(fop->course)) -
+              ThisAircraft.speed * sinf(radians(ThisAircraft.course))) * _GPS_MPS_PER_KNOT;
+  float vy = (fop->speed        * cosf(radians(fop->course)) -
+              ThisAircraft.speed * cosf(radians(ThisAircraft.course))) * _GPS_MPS_PER_KNOT;
+  float v2 = vx * vx + vy * vy;
+
+  if (v2 > 0.01) {
+    /* time to closest point of approach on straight tracks */
+    float t = -(rx * vx + ry * vy) / v2;
+
+    if (t > 0 && t < TRAFFIC_THREAT_HORIZON) {
+      float cx = rx + vx * t;
+      float cy = ry + vy * t;
+      float r  = sqrtf(cx * cx + cy * cy) + t * TRAFFIC_THREAT_SPEED;
+
+      if (r < range) {
+        range = r;
+      }
+    }
+  }
+
+  return range;
+}
+
+static inline bool Traffic_Threat_Less(int8_t level_a, float range_a,
+                                       int8_t level_b, float range_b)
+{
+  if (level_a != level_b) {
+    return level_a < level_b;
+  }
+
+  return range_a > range_b;
+}
+
+static inline bool Traffic_Heap_Less(uint16_t a, uint16_t b)
+{
+  return Traffic_Threat_Less(Container[a].alarm_level, Traffic_Threat_Range[a],
+                             Container[b].alarm_level, Traffic_Threat_Range[b]);
+}
+
+static inline void Traffic_Heap_Swap(uint16_t i, uint16_t j)
+{
+  uint16_t tmp = Traffic_Heap[i];
+
+  Traffic_Heap[i] = Traffic_Heap[j];
+  Traffic_Heap[j] = tmp;
+  Traffic_Heap_Pos[Traffic_Heap[i]] = i;
+  Traffic_Heap_Pos[Traffic_Heap[j]] = j;
+}
+
+static void Traffic_Heap_Up(uint16_t pos)
+{
+  while (pos > 0) {
+    uint16_t parent = (pos - 1) >> 1;
+
+    if (!Traffic_Heap_Less(Traffic_Heap[pos], Traffic_Heap[parent])) {
+      break;
+    }
+    Traffic_Heap_Swap(pos, parent);
+    pos = parent;
+  }
+}
+
+static void Traffic_Heap_Down(uint16_t pos)
+{
+  while (true) {
+    uint16_t left  = 2 * pos + 1;
+    uint16_t right = left + 1;
+    uint16_t least = pos;
+
+    if (left < Traffic_Heap_Size &&
+        Traffic_Heap_Less(Traffic_Heap[left], Traffic_Heap[least])) {
+      least = left;
+    }
+    if (right < Traffic_Heap_Size &&
+        Traffic_Heap_Less(Traffic_Heap[right], Traffic_Heap[least])) {
+      least = right;
+    }
+    if (least == pos) {
+      break;
+    }
+    Traffic_Heap_Swap(pos, least);
+    pos = least;
+  }
+}
+
+/* (re)position a slot in the queue after its alarm level or position has changed */
+static void Traffic_Heap_Update(uint16_t ndx)
+{
+  Traffic_Threat_Range[ndx] = Traffic_Threat(&Container[ndx]);
+
+  if (Traffic_Heap_Pos[ndx] == TRAFFIC_HEAP_NONE) {
+    Traffic_Heap[Traffic_Heap_Size] = ndx;
+    Traffic_Heap_Pos[ndx] = Traffic_Heap_Size++;
+  }
+
+  Traffic_Heap_Up(Traffic_Heap_Pos[ndx]);
+  Traffic_Heap_Down(Traffic_Heap_Pos[ndx]);
+}
+
+/* reorder the whole queue at once, after all the targets have moved */
+static void Traffic_Heap_Rebuild()
+{
+  for (uint16_t pos=0; pos < Traffic_Heap_Size; pos++) {
+    uint16_t ndx = Traffic_Heap[pos];
+
+    Traffic_Threat_Range[ndx] = Traffic_Threat(&Container[ndx]);
+  }
+
+  for (int pos = Traffic_Heap_Size / 2 - 1; pos >= 0; pos--) {
+    Traffic_Heap_Down(pos);
+  }
+}
+
+static void Traffic_Heap_Delete(uint16_t ndx)
+{
+  uint16_t pos = Traffic_Heap_Pos[ndx];
+
+  if (pos == TRAFFIC_HEAP_NONE) {
+    return;
+  }
+
+  Traffic_Heap_Size--;
+  if (pos != Traffic_Heap_Size) {
+    Traffic_Heap_Swap(pos, Traffic_Heap_Size);
+    Traffic_Heap_Up(pos);
+    Traffic_Heap_Down(pos);
+  }
+  Traffic_Heap_Pos[ndx] = TRAFFIC_HEAP_NONE;
+}
+
+#else
+
+#define Traffic_Heap_Update(ndx) {}
+#define Traffic_Heap_Delete(ndx) {}
+#define Traffic_Heap_Rebuild()   {}
+
+#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
+
+/*
+ * Pick an entry to give room for a new one when the Container is full.
+ * The oldest entry goes first when it has expired, as Traffic_loop()
+ * would remove it anyway. Otherwise the top of the eviction queue goes.
+ * Returns NULL when the new entry is less relevant than any stored one.
+ */
+static ufo_t *Traffic_Victim(ufo_t *fop)
+{
+  if (Traffic_Oldest != TRAFFIC_AGE_NONE &&
+      ThisAircraft.timestamp - Traffic_Hot.timestamp[Traffic_Oldest] > ENTRY_EXPIRATION_TIME) {
+    return &Container[Traffic_Oldest];
+  }
+
+#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
+  if (Traffic_Heap_Size > 0) {
+    uint16_t ndx = Traffic_Heap[0];
+
+    if (Traffic_Threat_Less(Container[ndx].alarm_level, Traffic_Threat_Range[ndx],
+                            fop->alarm_level, Traffic_Threat(fop))) {
+      return &Container[ndx];
+    }
+  }
+#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
+
+  return NULL;
+}
+
+#if !defined(EXCLUDE_TRAFFIC_HISTORY)
+static void Traffic_History_Alloc(uint16_t ndx)
+{
+  if (Traffic_History_Free_Count > 0) {
+    uint16_t ring = Traffic_History_Free[--Traffic_History_Free_Count];
+
+    Traffic_History_Pool[ring].head  = 0;
+    Traffic_History_Pool[ring].count = 0;
+    Traffic_History_Ring[ndx] = ring;
+  }
+}
+
+static void Traffic_History_Release(uint16_t ndx)
+{
+  if (Traffic_History_Ring[ndx] != TRAFFIC_HISTORY_NONE) {
+    Traffic_History_Free[Traffic_History_Free_Count++] = Traffic_History_Ring[ndx];
+    Traffic_History_Ring[ndx] = TRAFFIC_HISTORY_NONE;
+  }
+}
+
+static void Traffic_History_Append(uint16_t ndx, uint32_t ms)
+{
+  if (Traffic_History_Ring[ndx] == TRAFFIC_HISTORY_NONE) {
+    return;
+  }
+
+  ufo_t *fop = &Container[ndx];
+  traffic_history_t *hist = &Traffic_History_Pool[Traffic_History_Ring[ndx]];
+  traffic_point_t *point = &hist->point[hist->head];
+
+  point->latitude  = fop->latitude;
+  point->longitude = fop->longitude;
+  point->altitude  = fop->altitude;
+  point->ms        = ms;
+
+  hist->head = (hist->head + 1) & TRAFFIC_HISTORY_MASK;
+  if (hist->count < TRAFFIC_HISTORY_SIZE) {
+    hist->count++;
+  }
+}
+
+/* copy up to 'n' last received fixes of a target, newest first */
+int Traffic_History(ufo_t *fop, traffic_point_t *points, int n)
+{
+  int ndx = Traffic_Slot(fop);
+
+  if (ndx < 0 || Traffic_History_Ring[ndx] == TRAFFIC_HISTORY_NONE) {
+    return 0;
+  }
+
+  traffic_history_t *hist = &Traffic_History_Pool[Traffic_History_Ring[ndx]];
+
+  if (n > hist->count) {
+    n = hist->count;
+  }
+
+  for (int k=0; k < n; k++) {
+    points[k] = hist->point[(hist->head - 1 - k) & TRAFFIC_HISTORY_MASK];
+  }
+
+  return n;
+}
+
+#else
+
+#define Traffic_History_Alloc(ndx)       {}
+#define Traffic_History_Release(ndx)     {}
+#define Traffic_History_Append(ndx, ms)  {}
+
+int Traffic_History(ufo_t *fop, traffic_point_t *points, int n)
+{
+  return 0;
+}
+
+#endif /* EXCLUDE_TRAFFIC_HISTORY */
+
+#if !defined(EXCLUDE_TRAFFIC_FUSION)
+static inline int32_t Traffic_Grid_Row(float latitude)
+{
+  return (int32_t) floorf(latitude / TRAFFIC_FUSION_CELL);
+}
+
+static inline int32_t Traffic_Grid_Col(float longitude, int32_t row)
+{
+  float scale = cosf(radians((row + 0.5) * TRAFFIC_FUSION_CELL));
+
+  return (int32_t) floorf(longitude * scale / TRAFFIC_FUSION_CELL);
+}
+
+static inline uint8_t Traffic_Grid_Hash(int32_t row, int32_t col)
+{
+  uint32_t key = (uint32_t) row * 2654435761U ^ (uint32_t) col;
+
+  return (uint8_t) (((uint32_t) (key * 2654435761U)) >> (32 - TRAFFIC_FUSION_GRID_BITS));
+}
+
+static void Traffic_Grid_Drop(uint16_t ndx)
+{
+  if (!Traffic_Grid_Busy[ndx]) {
+    return;
+  }
+
+  uint16_t *link = &Traffic_Grid[Traffic_Grid_Cell[ndx]];
+
+  while (*link != ndx) {
+    link = &Traffic_Grid_Next[*link];
+  }
+  *link = Traffic_Grid_Next[ndx];
+  Traffic_Grid_Busy[ndx] = false;
+}
+
+/* file a track with aircraft ID under the cell of its last fix */
+static void Traffic_Grid_Put(uint16_t ndx)
+{
+  Traffic_Grid_Drop(ndx);
+
+  if (Traffic_Hot.addr[ndx] == 0) {
+    return;
+  }
+
+  int32_t row  = Traffic_Grid_Row(Traffic_Fix[ndx].latitude);
+  uint8_t cell = Traffic_Grid_Hash(row, Traffic_Grid_Col(Traffic_Fix[ndx].longitude, row));
+
+  Traffic_Grid_Cell[ndx] = cell;
+  Traffic_Grid_Next[ndx] = Traffic_Grid[cell];
+  Traffic_Grid[cell]     = ndx;
+  Traffic_Grid_Busy[ndx] = true;
+}
+
+#else
+
+#define Traffic_Grid_Drop(ndx) {}
+#define Traffic_Grid_Put(ndx)  {}
+
+#endif /* EXCLUDE_TRAFFIC_FUSION */
+
+/*
+ * Take a new fix of a slot from 'protocol' source,
+ * 'update' tells that the previous one is of the same target.
+ */
+static void Traffic_Fix_Store(uint16_t ndx, uint8_t protocol, bool update)
+{
+  ufo_t *fop = &Container[ndx];
+  traffic_fix_t *fix = &Traffic_Fix[ndx];
+  uint32_t ms = millis();
+  float turn_rate = 0.0;
+
+  /* sources differ in latency, that is not a turn */
+  if (update && fix->protocol == protocol) {
+    float dt = (ms - fix->ms) / 1000.0;
+
+    if (dt > 0.0 && dt <= TRAFFIC_DR_HORIZON && fop->speed > 5.0) {
+      float turn = fop->course - fix->course;
+
+      if (turn > 180.0) {
+        turn -= 360.0;
+      } else if (turn < -180.0) {
+        turn += 360.0;
+      }
+      turn_rate = constrain(turn / dt, -ALARM_LEGACY_MAX_TURN, ALARM_LEGACY_MAX_TURN);
+    }
+  }
+
+  fix->latitude  = fop->latitude;
+  fix->longitude = fop->longitude;
+  fix->altitude  = fop->altitude;
+  fix->course    = fop->course;
+  fix->turn_rate = turn_rate;
+  fix->ms        = ms;
+  fix->protocol  = protocol;
+  fix->projected = false;
+
+  Traffic_Grid_Put(ndx);
+  Traffic_History_Append(ndx, ms);
+}
+
+/* whether the position of a target is a projection of its last fix */
+bool Traffic_Extrapolated(ufo_t *fop)
+{
+  int ndx = Traffic_Slot(fop);
+
+  return ndx >= 0 && Traffic_Fix[ndx].projected;
+}
+
+/* protocol which the position of a target came from */
+uint8_t Traffic_Position_Source(ufo_t *fop)
+{
+  int ndx = Traffic_Slot(fop);
+
+  return ndx < 0 ? fop->protocol : Traffic_Fix[ndx].protocol;
+}
+
+#if !defined(EXCLUDE_TRAFFIC_FUSION)
+/* FLARM family comes first: lowest latency, and a flight path for the alarms */
+static uint8_t Traffic_Fusion_Rank(uint8_t protocol)
+{
+  switch (protocol)
+  {
+  case RF_PROTOCOL_LEGACY:
+  case RF_PROTOCOL_OGNTP:
+    return 3;
+  case RF_PROTOCOL_ADSB_1090:
+  case RF_PROTOCOL_ADSB_UAT:
+    return 2;
+  case RF_PROTOCOL_FANET:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static int Traffic_Source_Find(uint16_t ndx, uint8_t protocol)
+{
+  for (int k=0; k < Traffic_Source_Count[ndx]; k++) {
+    if (Traffic_Source[ndx][k].protocol == protocol) {
+      return k;
+    }
+  }
+
+  return -1;
+}
+
+static void Traffic_Source_Add(uint16_t ndx, ufo_t *fop)
+{
+  traffic_source_t *src = &Traffic_Source[ndx][Traffic_Source_Count[ndx]++];
+
+  src->addr      = fop->addr;
+  src->ms        = millis();
+  src->protocol  = fop->protocol;
+  src->addr_type = fop->addr_type;
+}
+
+/* detach a secondary (k > 0) source from its track */
+static void Traffic_Source_Drop(uint16_t ndx, int k)
+{
+  traffic_source_t *src = &Traffic_Source[ndx][k];
+  int cell = Traffic_Index_Find(src->addr, src->protocol);
+
+  if (cell >= 0) {
+    Traffic_Index_Delete(cell);
+  }
+
+  *src = Traffic_Source[ndx][--Traffic_Source_Count[ndx]];
+}
+
+static void Traffic_Source_Init(uint16_t ndx)
+{
+  Traffic_Source_Count[ndx] = 0;
+
+  if (Container[ndx].addr) {
+    Traffic_Source_Add(ndx, &Container[ndx]);
+  }
+}
+
+/* drop all the secondary sources, 'keep' tells whether entry 0 stays */
+static void Traffic_Source_Clear(uint16_t ndx, bool keep)
+{
+  while (Traffic_Source_Count[ndx] > 1) {
+    Traffic_Source_Drop(ndx, Traffic_Source_Count[ndx] - 1);
+  }
+
+  if (!keep) {
+    Traffic_Source_Count[ndx] = 0;
+  }
+}
+
+/* horizontal distance between two located entries */
+static float Traffic_Fusion_Gap(ufo_t *a, ufo_t *b)
+{
+  float ba    = radians(a->bearing);
+  float bb    = radians(b->bearing);
+  float east  = a->distance * sinf(ba) - b->distance * sinf(bb);
+  float north = a->distance * cosf(ba) - b->distance * cosf(bb);
+
+  return sqrtf(east * east + north * north);
+}
+
+/* whether the track of slot 'ndx' has room for a record of a new (addr, protocol) */
+static bool Traffic_Fusion_Open(uint16_t ndx, ufo_t *fop, bool named, uint32_t ms)
+{
+  if (Traffic_Source_Count[ndx] >= TRAFFIC_FUSION_SOURCES) {
+    return false;
+  }
+
+  for (int k=0; k < Traffic_Source_Count[ndx]; k++) {
+    traffic_source_t *src = &Traffic_Source[ndx][k];
+
+    if (src->protocol == fop->protocol) {
+      /* one record per protocol, a stale secondary one is replaced */
+      if (k == 0 || ms - src->ms <= TRAFFIC_FUSION_FRESH_MS) {
+        return false;
+      }
+    } else if (named && src->addr_type == fop->addr_type && src->addr != fop->addr) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* slot of the track which a record of a new (addr, protocol) belongs to, -1 if none */
+static int Traffic_Fusion_Match(ufo_t *fop)
+{
+  uint32_t ms = millis();
+  bool named  = (fop->addr_type == ADDR_TYPE_ICAO || fop->addr_type == ADDR_TYPE_FLARM);
+  bool placed = (fop->latitude != 0.0 || fop->longitude != 0.0);
+  int best    = -1;
+  float best_gap = TRAFFIC_FUSION_RANGE;
+
+  if (named) {
+    for (size_t p=0; p < sizeof(Traffic_Fusion_Protocols); p++) {
+      uint8_t protocol = Traffic_Fusion_Protocols[p];
+      int cell;
+
+      if (protocol == fop->protocol ||
+          (cell = Traffic_Index_Find(fop->addr, protocol)) < 0) {
+        continue;
+      }
+
+      uint16_t ndx = Traffic_Index[cell] - 1;
+      int k = Traffic_Source_Find(ndx, protocol);
+
+      if (k >= 0                                           &&
+          Traffic_Source[ndx][k].addr      == fop->addr      &&
+          Traffic_Source[ndx][k].addr_type == fop->addr_type &&
+          Traffic_Fusion_Open(ndx, fop, named, ms)) {
+        return ndx;
+      }
+    }
+  }
+
+  if (!placed) {
+    return -1;
+  }
+
+  int32_t row = Traffic_Grid_Row(fop->latitude);
+
+  for (int32_t r = row - 1; r <= row + 1; r++) {
+    int32_t col = Traffic_Grid_Col(fop->longitude, r);
+
+    for (int32_t c = col - 1; c <= col + 1; c++) {
+      for (uint16_t i = Traffic_Grid[Traffic_Grid_Hash(r, c)];
+           i != TRAFFIC_FUSION_NONE; i = Traffic_Grid_Next[i]) {
+        ufo_t *slot = &Container[i];
+
+        if (ms - Traffic_Fix[i].ms > TRAFFIC_FUSION_FRESH_MS                ||
+            fabsf(fop->distance - slot->distance) >= best_gap               ||
+            fabsf(fop->altitude - slot->altitude) > TRAFFIC_FUSION_VRANGE   ||
+            !Traffic_Fusion_Open(i, fop, named, ms)) {
+          continue;
+        }
+
+        if (fop->speed > 20.0 && slot->speed > 20.0) {
+          float turn = fabsf(fop->course - slot->course);
+
+          if (turn > 180.0) {
+            turn = 360.0 - turn;
+          }
+          if (turn > TRAFFIC_FUSION_COURSE) {
+            continue;
+          }
+        }
+
+        float gap = Traffic_Fusion_Gap(fop, slot);
+
+        if (gap < best_gap) {
+          best_gap = gap;
+          best     = i;
+        }
+      }
+    }
+  }
+
+  return best;
+}
+
+static void Traffic_Fusion_Merge(uint16_t ndx, ufo_t *fop)
+{
+  ufo_t *slot = &Container[ndx];
+  traffic_fix_t *fix = &Traffic_Fix[ndx];
+
+  if (fop->protocol == fix->protocol                        ||
+      millis() - fix->ms > TRAFFIC_FUSION_FRESH_MS          ||
+      Traffic_Fusion_Rank(fop->protocol) > Traffic_Fusion_Rank(fix->protocol)) {
+    slot->latitude         = fop->latitude;
+    slot->longitude        = fop->longitude;
+    slot->altitude         = fop->altitude;
+    slot->course           = fop->course;
+    slot->speed            = fop->speed;
+    slot->vs               = fop->vs;
+    slot->smult            = fop->smult;
+    slot->geoid_separation = fop->geoid_separation;
+    slot->hdop             = fop->hdop;
+    slot->distance         = fop->distance;
+    slot->bearing          = fop->bearing;
+    slot->alarm_level      = fop->alarm_level;
+    memcpy(slot->ns, fop->ns, sizeof(slot->ns));
+    memcpy(slot->ew, fop->ew, sizeof(slot->ew));
+
+    Traffic_Fix_Store(ndx, fop->protocol, true);
+  }
+
+  if (fop->pressure_altitude != 0.0) {
+    slot->pressure_altitude = fop->pressure_altitude;
+  }
+  if (fop->callsign[0]) {
+    memcpy(slot->callsign, fop->callsign, sizeof(slot->callsign));
+  }
+  if (slot->aircraft_type == AIRCRAFT_TYPE_UNKNOWN) {
+    slot->aircraft_type = fop->aircraft_type;
+  }
+  if (fop->rssi) {
+    slot->rssi = fop->rssi;
+  }
+  if (fop->timestamp > slot->timestamp) {
+    slot->timestamp = fop->timestamp;
+    Traffic_Age_Touch(ndx);
+  }
+
+  /* privacy requests of any source hold for the whole track */
+  slot->stealth  = slot->stealth  || fop->stealth;
+  slot->no_track = slot->no_track || fop->no_track;
+
+  Traffic_Hot.timestamp[ndx] = slot->timestamp;
+}
+
+/*
+ * Take a record into a fused track: 'slot' is the entry indexed
+ * under the record's own ID, if any. Returns NULL when the record
+ * has to be stored as a target of its own.
+ */
+static ufo_t *Traffic_Fusion_Store(ufo_t *fop, ufo_t *slot)
+{
+  int ndx;
+
+  if (slot) {
+    ndx = slot - Container;
+
+    if (Traffic_Source_Count[ndx] < 2) {
+      return NULL;
+    }
+
+    int k = Traffic_Source_Find(ndx, fop->protocol);
+    traffic_fix_t *fix = &Traffic_Fix[ndx];
+
+    if (fop->protocol != fix->protocol                        &&
+        millis() - fix->ms <= TRAFFIC_FUSION_FRESH_MS         &&
+        Traffic_Fusion_Gap(fop, slot) > TRAFFIC_FUSION_SPLIT) {
+      /* sources disagree, that is not one aircraft */
+      if (k > 0) {
+        Traffic_Source_Drop(ndx, k);
+      } else {
+        Traffic_Source_Clear(ndx, true);
+      }
+      return NULL;
+    }
+
+    Traffic_Source[ndx][k].ms = millis();
+  } else {
+    ndx = Traffic_Fusion_Match(fop);
+
+    if (ndx < 0) {
+      return NULL;
+    }
+
+    int k = Traffic_Source_Find(ndx, fop->protocol);
+    if (k > 0) {
+      Traffic_Source_Drop(ndx, k);
+    }
+
+    if (!Traffic_Index_Insert(ndx, fop->addr, fop->protocol)) {
+      /* index is full, the record is not merged */
+      return NULL;
+    }
+    Traffic_Source_Add(ndx, fop);
+  }
+
+  Traffic_Fusion_Merge(ndx, fop);
+  Traffic_Heap_Update(ndx);
+  Traffic_Export_Check(ndx);
+
+  return &Container[ndx];
+}
+
+#else
+
+#define Traffic_Source_Init(ndx)        {}
+#define Traffic_Source_Clear(ndx, keep) {}
+
+#endif /* EXCLUDE_TRAFFIC_FUSION */
+
+ufo_t *Traffic_Lookup(uint32_t addr, uint8_t protocol)
+{
+  if (!Traffic_Store_Ready || addr == 0) {
+    return NULL;
+  }
+
+  int cell = Traffic_Index_Find(addr, protocol);
+
+  return cell < 0 ? NULL : &Container[Traffic_Index[cell] - 1];
+}
+
+/*
+ * Update an entry with the same aircraft ID or put a new one into the Container.
+ * Entries without aircraft ID (raw data) are never matched.
+ */
+ufo_t *Traffic_Store(ufo_t *fop)
+{
+  ufo_t *slot;
+
+  if (!Traffic_Store_Ready) {
+    Traffic_Store_setup();
+  }
+
+  slot = Traffic_Lookup(fop->addr, fop->protocol);
+
+#if !defined(EXCLUDE_TRAFFIC_FUSION)
+  if (fop->addr) {
+    ufo_t *track = Traffic_Fusion_Store(fop, slot);
+
+    if (track) {
+      return track;
+    }
+
+    /* the record may have just left a fused track */
+    slot = Traffic_Lookup(fop->addr, fop->protocol);
+  }
+#endif /* EXCLUDE_TRAFFIC_FUSION */
+
+  if (slot) {
+    uint8_t alert_bak = slot->alert;
+    *slot = *fop;
+    slot->alert = alert_bak;
+    Traffic_Hot.timestamp[slot - Container] = fop->timestamp;
+    Traffic_Age_Touch(slot - Container);
+    Traffic_Fix_Store(slot - Container, fop->protocol, true);
+    Traffic_Heap_Update(slot - Container);
+    Traffic_Export_Check(slot - Container);
+    return slot;
+  }
+
+  if (Traffic_Free_Count == 0) {
+    slot = Traffic_Victim(fop);
+    if (slot == NULL) {
+      return NULL;
+    }
+    Traffic_Remove(slot);
+  }
+
+  uint16_t ndx = Traffic_Free[Traffic_Free_Count - 1];
+
+  if (fop->addr) {
+    if (!Traffic_Index_Insert(ndx, fop->addr, fop->protocol)) {
+      return NULL;
+    }
+    Traffic_Indexed_Count++;
+  }
+
+  Traffic_Free_Count--;
+  Traffic_Busy[ndx] = true;
+  slot = &Container[ndx];
+  *slot = *fop;
+
+  Traffic_Hot.addr[ndx]      = fop->addr;
+  Traffic_Hot.timestamp[ndx] = fop->timestamp;
+  Traffic_Hot.protocol[ndx]  = fop->protocol;
+  Traffic_Age_Append(ndx);
+
+  if (slot->addr) {
+    Traffic_History_Alloc(ndx);
+  }
+
+  Traffic_Source_Init(ndx);
+  Traffic_Fix_Store(ndx, fop->protocol, false);
+  Traffic_Heap_Update(ndx);
+  Traffic_Export_Reset(ndx);
+  Traffic_Export_Check(ndx);
+
+  return slot;
+}
+
+void Traffic_Remove(ufo_t *fop)
+{
+  int ndx = Traffic_Slot(fop);
+
+  if (ndx < 0) {
+    return;
+  }
+
+  Traffic_Heap_Delete(ndx);
+  Traffic_Age_Unlink(ndx);
+  Traffic_Grid_Drop(ndx);
+  Traffic_Source_Clear(ndx, false);
+  Traffic_History_Release(ndx);
+
+  if (Traffic_Hot.addr[ndx]) {
+    int cell = Traffic_Index_Find(Traffic_Hot.addr[ndx], Traffic_Hot.protocol[ndx]);
+    if (cell >= 0) {
+      Traffic_Index_Delete(cell);
+    }
+    Traffic_Indexed_Count--;
+  }
+
+  *fop = EmptyFO;
+  Traffic_Hot.addr[ndx]      = 0;
+  Traffic_Hot.timestamp[ndx] = 0;
+  Traffic_Hot.protocol[ndx]  = 0;
+#if defined(TRAFFIC_RAW_STORAGE)
+  Traffic_Raw_Size[ndx] = 0;
+#endif /* TRAFFIC_RAW_STORAGE */
+  Traffic_Busy[ndx] = false;
+  Traffic_Free[Traffic_Free_Count++] = ndx;
+}
+
+/* raw packet of a relayed entry, NULL if there is none */
+uint8_t *Traffic_Raw(ufo_t *fop)
+{
+#if defined(TRAFFIC_RAW_STORAGE)
+  int ndx = Traffic_Slot(fop);
+
+  if (ndx >= 0 && Traffic_Raw_Size[ndx] > 0) {
+    return Traffic_Raw_Data[ndx];
+  }
+#endif /* TRAFFIC_RAW_STORAGE */
+
+  return NULL;
+}
+
+void Traffic_Raw_Store(ufo_t *fop, const uint8_t *raw, size_t size)
+{
+#if defined(TRAFFIC_RAW_STORAGE)
+  int ndx = Traffic_Slot(fop);
+
+  if (ndx >= 0) {
+    size = size > RAW_DATA_SIZE ? RAW_DATA_SIZE : size;
+    memset(Traffic_Raw_Data[ndx], 0, RAW_DATA_SIZE);
+    memcpy(Traffic_Raw_Data[ndx], raw, size);
+    Traffic_Raw_Size[ndx] = size;
+  }
+#endif /* TRAFFIC_RAW_STORAGE */
+}
+
 /*
  * No any alarms issued by the firmware.
  * Rely upon high-level flight management software.
@@ -108,50 +1337,410 @@ static int8_t Alarm_Vector(ufo_t *this_aircraft, ufo_t *fop)
 
 /*
  * "Legacy" method is based on short history of 2D velocity vectors (NS/EW)
+ *
+ * Relative motion of a target is piecewise linear: one segment of
+ * ALARM_LEGACY_STEP seconds per NS/EW vector announced by the target
+ * (course and speed for non-Legacy traffic), then the last vector is
+ * held until ALARM_LEGACY_HORIZON. Own velocity is extrapolated with
+ * the turn rate taken from own course history.
+ *
+ * Time and distance at closest point of approach (CPA) are searched
+ * for all the targets in one pass. The data is kept as a structure of
+ * arrays, so that the inner loops are vectorised by the compiler.
+ * The extra lane at MAX_TRACKING_OBJECTS serves single target requests.
  */
-static int8_t Alarm_Legacy(ufo_t *this_aircraft, ufo_t *fop)
+#define ALARM_LEGACY_LANES    (MAX_TRACKING_OBJECTS + 1)
+
+static struct {
+  float rx[ALARM_LEGACY_LANES];   /* metres, East */
+  float ry[ALARM_LEGACY_LANES];   /* metres, North */
+  float dz[ALARM_LEGACY_LANES];   /* metres, Up */
+  float vz[ALARM_LEGACY_LANES];   /* m/s */
+  float vx[ALARM_LEGACY_STEPS][ALARM_LEGACY_LANES]; /* m/s */
+  float vy[ALARM_LEGACY_STEPS][ALARM_LEGACY_LANES]; /* m/s */
+  float t [ALARM_LEGACY_LANES];   /* seconds to CPA */
+  float d2[ALARM_LEGACY_LANES];   /* square of distance at CPA */
+} Alarm_CPA;
+
+static uint16_t Alarm_CPA_Slot[MAX_TRACKING_OBJECTS];
+
+static float  Own_vx[ALARM_LEGACY_STEPS];
+static float  Own_vy[ALARM_LEGACY_STEPS];
+static float  Own_Course    = 0.0;
+static float  Own_Turn_Rate = 0.0;
+static time_t Own_Course_Time = 0;
+
+static void Alarm_Legacy_Own(ufo_t *this_aircraft)
+{
+  time_t dt = this_aircraft->timestamp - Own_Course_Time;
+
+  if (dt > 0) {
+    float turn = this_aircraft->course - Own_Course;
+
+    if (turn > 180.0) {
+      turn -= 360.0;
+    } else if (turn < -180.0) {
+      turn += 360.0;
+    }
+
+    Own_Turn_Rate = (dt > ALARM_LEGACY_STEP || this_aircraft->speed < 5.0) ?
+                    0.0 : constrain(turn / dt, -ALARM_LEGACY_MAX_TURN,
+                                                ALARM_LEGACY_MAX_TURN);
+    Own_Course      = this_aircraft->course;
+    Own_Course_Time = this_aircraft->timestamp;
+  }
+
+  float speed = this_aircraft->speed * _GPS_MPS_PER_KNOT;
+
+  for (int k=0; k < ALARM_LEGACY_STEPS; k++) {
+    float course = radians(this_aircraft->course +
+                           Own_Turn_Rate * (k + 0.5) * ALARM_LEGACY_STEP);
+    Own_vx[k] = speed * sinf(course);
+    Own_vy[k] = speed * cosf(course);
+  }
+}
+
+static void Alarm_Legacy_Load(int lane, ufo_t *this_aircraft, ufo_t *fop)
+{
+  Alarm_CPA.rx[lane] = fop->distance * sinf(radians(fop->bearing));
+  Alarm_CPA.ry[lane] = fop->distance * cosf(radians(fop->bearing));
+  Alarm_CPA.dz[lane] = fop->altitude - this_aircraft->altitude;
+  Alarm_CPA.vz[lane] = (fop->vs - this_aircraft->vs) / (_GPS_FEET_PER_METER * 60.0);
+
+  if (Traffic_Position_Source(fop) == RF_PROTOCOL_LEGACY) {
+    float unit = (1 << fop->smult) / 4.0;
+
+    for (int k=0; k < ALARM_LEGACY_STEPS; k++) {
+      Alarm_CPA.vx[k][lane] = fop->ew[k] * unit - Own_vx[k];
+      Alarm_CPA.vy[k][lane] = fop->ns[k] * unit - Own_vy[k];
+    }
+  } else {
+    float speed = fop->speed * _GPS_MPS_PER_KNOT;
+    float vx    = speed * sinf(radians(fop->course));
+    float vy    = speed * cosf(radians(fop->course));
+
+    for (int k=0; k < ALARM_LEGACY_STEPS; k++) {
+      Alarm_CPA.vx[k][lane] = vx - Own_vx[k];
+      Alarm_CPA.vy[k][lane] = vy - Own_vy[k];
+    }
+  }
+}
+
+static void Alarm_Legacy_CPA(int first, int count)
 {
+  int   i;
+  int   last    = first + count;
+  float elapsed = 0.0;
 
+  for (i = first; i < last; i++) {
+    Alarm_CPA.t [i] = 0.0;
+    Alarm_CPA.d2[i] = Alarm_CPA.rx[i] * Alarm_CPA.rx[i] +
+                      Alarm_CPA.ry[i] * Alarm_CPA.ry[i];
+  }
+
+  for (int k=0; k <= ALARM_LEGACY_STEPS; k++) {
+    /* the tail segment holds the last vector */
+    const float *vx = Alarm_CPA.vx[k < ALARM_LEGACY_STEPS ? k : ALARM_LEGACY_STEPS - 1];
+    const float *vy = Alarm_CPA.vy[k < ALARM_LEGACY_STEPS ? k : ALARM_LEGACY_STEPS - 1];
+    const float span = k < ALARM_LEGACY_STEPS ? ALARM_LEGACY_STEP :
+                       ALARM_LEGACY_HORIZON - ALARM_LEGACY_STEPS * ALARM_LEGACY_STEP;
+
+    for (i = first; i < last; i++) {
+      float px = Alarm_CPA.rx[i];
+      float py = Alarm_CPA.ry[i];
+      float v2 = vx[i] * vx[i] + vy[i] * vy[i] + 1e-6f;
+      float t  = fminf(fmaxf(-(px * vx[i] + py * vy[i]) / v2, 0.0f), span);
+      float cx = px + vx[i] * t;
+      float cy = py + vy[i] * t;
+      float d2 = cx * cx + cy * cy;
+      bool  closer = d2 < Alarm_CPA.d2[i];
+
+      Alarm_CPA.t [i] = closer ? elapsed + t : Alarm_CPA.t[i];
+      Alarm_CPA.d2[i] = closer ? d2          : Alarm_CPA.d2[i];
+      Alarm_CPA.rx[i] = px + vx[i] * span;
+      Alarm_CPA.ry[i] = py + vy[i] * span;
+    }
+
+    elapsed += span;
+  }
+}
+
+static int8_t Alarm_Legacy_Level(int lane)
+{
   int8_t rval = ALARM_LEVEL_NONE;
+  float t = Alarm_CPA.t[lane];
+  float alt_diff = Alarm_CPA.dz[lane] + Alarm_CPA.vz[lane] * t;
 
-  /* TBD */
+  if (Alarm_CPA.d2[lane] < (float) ALARM_LEGACY_RADIUS * ALARM_LEGACY_RADIUS &&
+      fabsf(alt_diff) < VERTICAL_SEPARATION) {
+
+    /* time limit values are compliant with FLARM data port specs */
+    if (t < 9.0) {
+      rval = ALARM_LEVEL_URGENT;
+    } else if (t < 13.0) {
+      rval = ALARM_LEVEL_IMPORTANT;
+    } else if (t < 19.0) {
+      rval = ALARM_LEVEL_LOW;
+    }
+  }
 
   return rval;
 }
 
-void Traffic_Update(ufo_t *fop)
+static int8_t Alarm_Legacy(ufo_t *this_aircraft, ufo_t *fop)
+{
+  Alarm_Legacy_Own(this_aircraft);
+  Alarm_Legacy_Load(MAX_TRACKING_OBJECTS, this_aircraft, fop);
+  Alarm_Legacy_CPA(MAX_TRACKING_OBJECTS, 1);
+
+  return Alarm_Legacy_Level(MAX_TRACKING_OBJECTS);
+}
+
+/*
+ * Local tangent plane around this aircraft.
+ *
+ * Scale factors are refreshed once per own position change.
+ * Nearby traffic is projected with a few single precision operations,
+ * TinyGPS++ haversine (double precision) is used beyond TRAFFIC_LTP_RANGE.
+ * Error of the projection is well below 1 m within ALARM_ZONE_NONE.
+ */
+#define TRAFFIC_LTP_RANGE     50000     /* metres */
+#define TRAFFIC_EARTH_RADIUS  6372795.0 /* metres, same as TinyGPS++ */
+
+static struct {
+  float latitude;
+  float longitude;
+  float m_per_deg_lat;
+  float m_per_deg_lon;
+  float convergence;    /* meridians convergence, per degree of latitude */
+} Traffic_LTP = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+static inline void Traffic_LTP_Refresh()
+{
+  if (Traffic_LTP.m_per_deg_lat == 0.0                  ||
+      Traffic_LTP.latitude      != ThisAircraft.latitude ||
+      Traffic_LTP.longitude     != ThisAircraft.longitude) {
+    Traffic_LTP.latitude      = ThisAircraft.latitude;
+    Traffic_LTP.longitude     = ThisAircraft.longitude;
+    Traffic_LTP.m_per_deg_lat = TRAFFIC_EARTH_RADIUS * PI / 180.0;
+    Traffic_LTP.m_per_deg_lon = Traffic_LTP.m_per_deg_lat *
+                                cosf(radians(ThisAircraft.latitude));
+    Traffic_LTP.convergence   = tanf(radians(ThisAircraft.latitude)) * PI / 360.0;
+  }
+}
+
+static void Traffic_Locate(ufo_t *fop)
+{
+  Traffic_LTP_Refresh();
+
+  float dlon = fop->longitude - Traffic_LTP.longitude;
+
+  if (dlon > 180.0) {
+    dlon -= 360.0;
+  } else if (dlon < -180.0) {
+    dlon += 360.0;
+  }
+
+  float dlat  = fop->latitude - Traffic_LTP.latitude;
+  float north = dlat * Traffic_LTP.m_per_deg_lat;
+  /* scale longitude at mid-latitude: cos(lat + dlat/2) ~ cos(lat) * (1 - tan(lat) * dlat/2) */
+  float east  = dlon * Traffic_LTP.m_per_deg_lon * (1.0 - Traffic_LTP.convergence * dlat);
+
+  if (fabsf(north) < TRAFFIC_LTP_RANGE && fabsf(east) < TRAFFIC_LTP_RANGE) {
+    float bearing = atan2f(east, north) * 180.0 / PI;
+
+    fop->distance = sqrtf(north * north + east * east);
+    fop->bearing  = bearing < 0.0 ? bearing + 360.0 : bearing;
+  } else {
+    fop->distance = gnss.distanceBetween( ThisAircraft.latitude,
+                                          ThisAircraft.longitude,
+                                          fop->latitude,
+                                          fop->longitude);
+
+    fop->bearing  = gnss.courseTo( ThisAircraft.latitude,
+                                   ThisAircraft.longitude,
+                                   fop->latitude,
+                                   fop->longitude);
+  }
+}
+
+/* East/North displacement (m) of a target 'dt' seconds after its last fix */
+static void Traffic_DR_Offset(ufo_t *fop, traffic_fix_t *fix, float dt,
+                              float *east, float *north)
+{
+  if (fix->protocol == RF_PROTOCOL_LEGACY) {
+    float unit = (1 << fop->smult) / 4.0;
+    float x = 0.0, y = 0.0;
+
+    for (int k=0; k < ALARM_LEGACY_STEPS && dt > 0.0; k++) {
+      /* the last vector is held */
+      float span = (k < ALARM_LEGACY_STEPS - 1 && dt > ALARM_LEGACY_STEP) ?
+                   ALARM_LEGACY_STEP : dt;
+
+      x  += fop->ew[k] * unit * span;
+      y  += fop->ns[k] * unit * span;
+      dt -= span;
+    }
+
+    *east  = x;
+    *north = y;
+  } else {
+    float speed = fop->speed * _GPS_MPS_PER_KNOT;
+    float c0    = radians(fix->course);
+
+    if (fabsf(fix->turn_rate) < TRAFFIC_DR_MIN_TURN) {
+      *east  = speed * sinf(c0) * dt;
+      *north = speed * cosf(c0) * dt;
+    } else {
+      float w  = radians(fix->turn_rate);
+      float c1 = c0 + w * dt;
+
+      *east  = speed / w * (cosf(c0) - cosf(c1));
+      *north = speed / w * (sinf(c1) - sinf(c0));
+
+      fop->course = fix->course + fix->turn_rate * dt;
+      if (fop->course >= 360.0) {
+        fop->course -= 360.0;
+      } else if (fop->course < 0.0) {
+        fop->course += 360.0;
+      }
+    }
+  }
+}
+
+static void Traffic_DR_Project(uint32_t ms)
+{
+  Traffic_DR_TimeMarker = ms;
+
+  Traffic_LTP_Refresh();
+
+  for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    if (Traffic_Hot.addr[i] == 0 ||
+        ThisAircraft.timestamp - Traffic_Hot.timestamp[i] > ENTRY_EXPIRATION_TIME) {
+      continue;
+    }
+
+    ufo_t *fop = &Container[i];
+    traffic_fix_t *fix = &Traffic_Fix[i];
+    float dt = (ms - fix->ms) / 1000.0;
+    float east, north;
+
+    if (dt > TRAFFIC_DR_HORIZON) {
+      dt = TRAFFIC_DR_HORIZON;
+    }
+
+    Traffic_DR_Offset(fop, fix, dt, &east, &north);
+
+    fop->latitude  = fix->latitude  + north / Traffic_LTP.m_per_deg_lat;
+    fop->longitude = fix->longitude + east  / (Traffic_LTP.m_per_deg_lat *
+                                               cosf(radians(fix->latitude)));
+    fop->altitude  = fix->altitude  + dt * fop->vs / (_GPS_FEET_PER_METER * 60.0);
+
+    Traffic_Locate(fop);
+    fix->projected = true;
+  }
+}
+
+#if !defined(EXCLUDE_TRAFFIC_SNAPSHOT)
+void Traffic_Publish()
+{
+  traffic_snapshot_t *back =
+    __atomic_load_n(&Traffic_Snapshot_Current, __ATOMIC_SEQ_CST) ==
+      &Traffic_Snapshot_Buffer[0] ? &Traffic_Snapshot_Buffer[1] :
+                                    &Traffic_Snapshot_Buffer[0];
+
+  if (__atomic_load_n(&back->readers, __ATOMIC_SEQ_CST) != 0) {
+    return;
+  }
+
+  uint16_t count = 0;
+
+  for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    if (Traffic_Hot.addr[i]) {
+      back->fo[count]   = Container[i];
+      back->slot[count] = i;
+      count++;
+    }
+  }
+
+  back->count = count;
+  back->ms    = millis();
+
+  __atomic_store_n(&Traffic_Snapshot_Current, back, __ATOMIC_SEQ_CST);
+}
+
+/* latest published snapshot, read only, to be given back with Traffic_Snapshot_Release() */
+traffic_snapshot_t *Traffic_Snapshot_Acquire()
+{
+  for (;;) {
+    traffic_snapshot_t *snap = __atomic_load_n(&Traffic_Snapshot_Current, __ATOMIC_SEQ_CST);
+
+    __atomic_add_fetch(&snap->readers, 1, __ATOMIC_SEQ_CST);
+
+    /* the writer may have taken this buffer over before it got pinned */
+    if (__atomic_load_n(&Traffic_Snapshot_Current, __ATOMIC_SEQ_CST) == snap) {
+      return snap;
+    }
+
+    __atomic_sub_fetch(&snap->readers, 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+void Traffic_Snapshot_Release(traffic_snapshot_t *snap)
+{
+  __atomic_sub_fetch(&snap->readers, 1, __ATOMIC_SEQ_CST);
+}
+
+#else
+
+#define Traffic_Publish() {}
+
+#endif /* EXCLUDE_TRAFFIC_SNAPSHOT */
+
+/* project every stored target to this moment */
+void Traffic_Extrapolate()
 {
-  fop->distance = gnss.distanceBetween( ThisAircraft.latitude,
-                                        ThisAircraft.longitude,
-                                        fop->latitude,
-                                        fop->longitude);
+  uint32_t ms = millis();
 
-  fop->bearing  = gnss.courseTo( ThisAircraft.latitude,
-                                 ThisAircraft.longitude,
-                                 fop->latitude,
-                                 fop->longitude);
+  if (ms - Traffic_DR_TimeMarker >= TRAFFIC_DR_INTERVAL_MS) {
+    Traffic_DR_Project(ms);
+    Traffic_Heap_Rebuild();
+    Traffic_Publish();
+  }
+}
+
+void Traffic_Update(ufo_t *fop)
+{
+  Traffic_Locate(fop);
 
   if (Alarm_Level) {
     fop->alarm_level = (*Alarm_Level)(&ThisAircraft, fop);
   }
+
+  int ndx = Traffic_Slot(fop);
+  if (ndx >= 0) {
+    Traffic_Heap_Update(ndx);
+    Traffic_Export_Check(ndx);
+  }
 }
 
-void ParseData()
+/* $PSRFI log of a received frame, false for an echo of our own TX */
+bool ParseData_Accept()
 {
     size_t rx_size = RF_Payload_Size(settings->rf_protocol);
-    rx_size = rx_size > sizeof(fo.raw) ? sizeof(fo.raw) : rx_size;
+    rx_size = rx_size > sizeof(fo_raw) ? sizeof(fo_raw) : rx_size;
 
 #if DEBUG
     Hex2Bin(TxDataTemplate, RxBuffer);
 #endif
 
-    memset(fo.raw, 0, sizeof(fo.raw));
-    memcpy(fo.raw, RxBuffer, rx_size);
+    memset(fo_raw, 0, sizeof(fo_raw));
+    memcpy(fo_raw, RxBuffer, rx_size);
 
     if (settings->nmea_p) {
       StdOut.print(F("$PSRFI,"));
       StdOut.print((unsigned long) now()); StdOut.print(F(","));
-      StdOut.print(Bin2Hex(fo.raw, rx_size)); StdOut.print(F(","));
+      StdOut.print(Bin2Hex(fo_raw, rx_size)); StdOut.print(F(","));
       StdOut.println(RF_last_rssi);
     }
 
@@ -159,62 +1748,34 @@ void ParseData()
       if (settings->nmea_p) {
         StdOut.println(F("$PSRFE,RF loopback is detected"));
       }
+      return false;
+    }
+
+    return true;
+}
+
+void ParseData()
+{
+    if (!ParseData_Accept()) {
       return;
     }
 
     if (protocol_decode && (*protocol_decode)((void *) RxBuffer, &ThisAircraft, &fo)) {
 
-      int i;
-
       fo.rssi = RF_last_rssi;
 
       Traffic_Update(&fo);
 
-      for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-        if (Container[i].addr == fo.addr) {
-          uint8_t alert_bak = Container[i].alert;
-          Container[i] = fo;
-          Container[i].alert = alert_bak;
-          return;
-        }
-      }
-
-      int max_dist_ndx = 0;
-      int min_level_ndx = 0;
-
-      for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-        if (now() - Container[i].timestamp > ENTRY_EXPIRATION_TIME) {
-          Container[i] = fo;
-          return;
-        }
-#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
-        if  (Container[i].distance > Container[max_dist_ndx].distance)  {
-          max_dist_ndx = i;
-        }
-        if  (Container[i].alarm_level < Container[min_level_ndx].alarm_level)  {
-          min_level_ndx = i;
-        }
-#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
-      }
-
-#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
-      if (fo.alarm_level > Container[min_level_ndx].alarm_level) {
-        Container[min_level_ndx] = fo;
-        return;
-      }
-
-      if (fo.distance    <  Container[max_dist_ndx].distance &&
-          fo.alarm_level >= Container[max_dist_ndx].alarm_level) {
-        Container[max_dist_ndx] = fo;
-        return;
-      }
-#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
-
+      Traffic_Store(&fo);
     }
 }
 
 void Traffic_setup()
 {
+  if (!Traffic_Store_Ready) {
+    Traffic_Store_setup();
+  }
+
   switch (settings->alarm)
   {
   case TRAFFIC_ALARM_NONE:
@@ -236,22 +1797,51 @@ void Traffic_setup()
 void Traffic_loop()
 {
   if (isTimeToUpdateTraffic()) {
+    /* "Legacy" alarms are evaluated for all the targets at once */
+    bool batch = (Alarm_Level == &Alarm_Legacy);
+    int n = 0;
+
+    if (batch) {
+      Alarm_Legacy_Own(&ThisAircraft);
+    }
+
+    /* alarms work from projected, not last received positions */
+    Traffic_DR_Project(millis());
+
     for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
 
-      if (Container[i].addr &&
-          (ThisAircraft.timestamp - Container[i].timestamp) <= ENTRY_EXPIRATION_TIME) {
-        if ((ThisAircraft.timestamp - Container[i].timestamp) >= TRAFFIC_VECTOR_UPDATE_INTERVAL) {
-          Traffic_Update(&Container[i]);
+      if (Traffic_Hot.addr[i] &&
+          (ThisAircraft.timestamp - Traffic_Hot.timestamp[i]) <= ENTRY_EXPIRATION_TIME) {
+        if (!batch && Alarm_Level) {
+          Container[i].alarm_level = (*Alarm_Level)(&ThisAircraft, &Container[i]);
+          Traffic_Export_Check(i);
+        }
+        if (batch) {
+          Alarm_Legacy_Load(n, &ThisAircraft, &Container[i]);
+          Alarm_CPA_Slot[n++] = i;
         }
         if ((Container[i].alert & TRAFFIC_ALERT_SOUND) == 0) {
           Sound_Notify();
           Container[i].alert |= TRAFFIC_ALERT_SOUND;
         }
       } else {
-        Container[i] = EmptyFO;
+        Traffic_Remove(&Container[i]);
+      }
+    }
+
+    if (batch) {
+      Alarm_Legacy_CPA(0, n);
+
+      for (int k=0; k < n; k++) {
+        Container[Alarm_CPA_Slot[k]].alarm_level = Alarm_Legacy_Level(k);
+        Traffic_Export_Check(Alarm_CPA_Slot[k]);
       }
     }
 
+    Traffic_Heap_Rebuild();
+
+    Traffic_Publish();
+
     UpdateTrafficTimeMarker = millis();
   }
 }
@@ -259,24 +1849,197 @@ void Traffic_loop()
 void ClearExpired()
 {
   for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-    if (Container[i].addr && (ThisAircraft.timestamp - Container[i].timestamp) > ENTRY_EXPIRATION_TIME) {
-      Container[i] = EmptyFO;
+    if (Traffic_Hot.addr[i] && (ThisAircraft.timestamp - Traffic_Hot.timestamp[i]) > ENTRY_EXPIRATION_TIME) {
+      Traffic_Remove(&Container[i]);
     }
   }
 }
 
 int Traffic_Count()
 {
-  int count = 0;
+  return Traffic_Indexed_Count;
+}
 
-  for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-    if (Container[i].addr) {
-      count++;
+/* time to run the exporters: every tick, or at once after an alarm level rise */
+bool Traffic_Export_Tick()
+{
+  uint32_t ms = millis();
+
+#if !defined(EXCLUDE_TRAFFIC_SCHEDULER)
+  if (ms - Traffic_Export_Tick_ms < TRAFFIC_EXPORT_TICK_MS && !Traffic_Export_Urgent) {
+    return false;
+  }
+  Traffic_Export_Urgent = false;
+#else
+  if (ms - Traffic_Export_Tick_ms < TRAFFIC_EXPORT_MS) {
+    return false;
+  }
+#endif /* EXCLUDE_TRAFFIC_SCHEDULER */
+
+  Traffic_Export_Tick_ms  = ms;
+  Traffic_Export_Beat_Now = (ms - Traffic_Export_Beat_ms >= TRAFFIC_EXPORT_MS);
+  if (Traffic_Export_Beat_Now) {
+    Traffic_Export_Beat_ms = ms;
+  }
+
+  return true;
+}
+
+/* this tick also carries the 1 Hz messages (heartbeat, PFLAU, ownship...) */
+bool Traffic_Export_Beat()
+{
+  return Traffic_Export_Beat_Now;
+}
+
+/* milliseconds left to the next export tick, for a main loop that sleeps */
+uint32_t Traffic_Export_Wait()
+{
+  uint32_t elapsed = millis() - Traffic_Export_Tick_ms;
+
+#if !defined(EXCLUDE_TRAFFIC_SCHEDULER)
+  if (Traffic_Export_Urgent) {
+    return 0;
+  }
+
+  return elapsed < TRAFFIC_EXPORT_TICK_MS ? TRAFFIC_EXPORT_TICK_MS - elapsed : 0;
+#else
+  return elapsed < TRAFFIC_EXPORT_MS ? TRAFFIC_EXPORT_MS - elapsed : 0;
+#endif /* EXCLUDE_TRAFFIC_SCHEDULER */
+}
+
+#if !defined(EXCLUDE_TRAFFIC_SCHEDULER)
+/*
+ * Start of an export by 'sink' into 'dest' output.
+ * Outputs of NMEA, GDL90 and D1090 share the values of NMEA_OFF ... NMEA_BLUETOOTH.
+ */
+void Traffic_Export_Begin(uint8_t sink, uint8_t dest)
+{
+  uint32_t ms = millis();
+  uint32_t rate;
+
+  Traffic_Export_Now = ms;
+
+  if (dest == NMEA_OFF || dest >= TRAFFIC_EXPORT_PORTS) {
+    Traffic_Export_Active &= ~(1 << sink);
+    return;
+  }
+  Traffic_Export_Active |= (1 << sink);
+  Traffic_Export_Port[sink] = dest;
+
+  switch (dest)
+  {
+  case NMEA_UART:
+    rate = SERIAL_OUT_BR / 10;
+    break;
+  case NMEA_BLUETOOTH:
+    rate = TRAFFIC_EXPORT_BT_RATE;
+    break;
+  default:
+    rate = 0; /* UDP, TCP and USB keep up */
+    break;
+  }
+
+  if (Traffic_Export_Short[sink]) {
+    if (Traffic_Export_Backlog[sink] < 3 * TRAFFIC_EXPORT_SLOW_MS) {
+      Traffic_Export_Backlog[sink] += TRAFFIC_EXPORT_TICK_MS;
     }
+  } else if (Traffic_Export_Backlog[sink] >= TRAFFIC_EXPORT_TICK_MS) {
+    Traffic_Export_Backlog[sink] -= TRAFFIC_EXPORT_TICK_MS;
   }
+  Traffic_Export_Short[sink] = false;
 
-  return count;
+  /* the sink before has flushed its output */
+  Traffic_Export_Charged[dest] = 0;
+
+  if (rate != Traffic_Export_Rate[dest]) {
+    Traffic_Export_Rate[dest]    = rate;
+    Traffic_Export_Budget[dest]  = rate;
+    Traffic_Export_Backlog[sink] = 0;
+  } else if (rate > 0) {
+    uint32_t elapsed = ms - Traffic_Export_Refill_ms[dest];
+
+    elapsed = elapsed > 1000 ? 1000 : elapsed;
+    Traffic_Export_Budget[dest] += rate * elapsed / 1000;
+    if (Traffic_Export_Budget[dest] > (int32_t) rate) {
+      Traffic_Export_Budget[dest] = rate;
+    }
+  }
+  Traffic_Export_Refill_ms[dest] = ms;
+}
+
+bool Traffic_Export_Due(uint8_t sink, uint16_t ndx)
+{
+  ufo_t *fop = &Container[ndx];
+  uint32_t last = Traffic_Export_ms[sink][ndx];
+  uint32_t age  = Traffic_Export_Now - last;
+  bool changed  = (int32_t) (Traffic_Fix[ndx].ms - last) > 0;
+  bool near     = fop->distance < TRAFFIC_EXPORT_NEAR ||
+                  fop->alarm_level > ALARM_LEVEL_NONE;
+  uint32_t period;
+
+  /* alarms neither wait nor count against the budget */
+  if (fop->alarm_level > Traffic_Export_Level[sink][ndx]) {
+    return true;
+  }
+
+  if (changed) {
+    period = near ? TRAFFIC_EXPORT_TICK_MS : TRAFFIC_EXPORT_MS;
+  } else {
+    period = near ? TRAFFIC_EXPORT_MS : TRAFFIC_EXPORT_SLOW_MS;
+  }
+  if (!near) {
+    period += Traffic_Export_Backlog[sink];
+  }
+
+  /* half a tick of slack, a period is not to be missed by a loop iteration */
+  if (age + TRAFFIC_EXPORT_TICK_MS / 2 < period) {
+    return false;
+  }
+
+  uint8_t port = Traffic_Export_Port[sink];
+
+  if (Traffic_Export_Rate[port] > 0) {
+    /* distant traffic leaves a quarter of the budget to the close one */
+    int32_t reserve = near ? 0 : Traffic_Export_Rate[port] / 4;
+
+    if (Traffic_Export_Budget[port] <= reserve) {
+      Traffic_Export_Short[sink] = true;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* report of slot 'ndx' by 'sink', 'size' bytes are going to be written */
+void Traffic_Export_Sent(uint8_t sink, uint16_t ndx, size_t size)
+{
+  uint8_t port = Traffic_Export_Port[sink];
+
+  Traffic_Export_ms[sink][ndx]    = Traffic_Export_Now;
+  Traffic_Export_Level[sink][ndx] = Container[ndx].alarm_level;
+
+  if (Traffic_Export_Rate[port] > 0) {
+    Traffic_Export_Budget[port]  -= size;
+    Traffic_Export_Charged[port] += size;
+  }
+}
+
+/* 'size' bytes written to output 'dest' by any sink */
+void Traffic_Export_Out(uint8_t dest, size_t size)
+{
+  if (dest >= TRAFFIC_EXPORT_PORTS || Traffic_Export_Rate[dest] == 0) {
+    return;
+  }
+
+  if (Traffic_Export_Charged[dest] >= size) {
+    Traffic_Export_Charged[dest] -= size;
+  } else {
+    Traffic_Export_Budget[dest] -= size - Traffic_Export_Charged[dest];
+    Traffic_Export_Charged[dest] = 0;
+  }
 }
+#endif /* EXCLUDE_TRAFFIC_SCHEDULER */
 
 int traffic_cmp_by_distance(const void *a, const void *b)
 {
@@ -29,11 +29,121 @@
 #define VERTICAL_SEPARATION         300 /* metres */
 #define VERTICAL_VISIBILITY_RANGE   500 /* value from FLARM data port specs */
 
+#define ALARM_LEGACY_STEPS    4   /* number of NS/EW velocity vectors */
+#define ALARM_LEGACY_STEP     3   /* seconds covered by each vector */
+#define ALARM_LEGACY_HORIZON  20  /* seconds */
+#define ALARM_LEGACY_RADIUS   150 /* metres */
+#define ALARM_LEGACY_MAX_TURN 30  /* degrees per second */
+
 #define TRAFFIC_VECTOR_UPDATE_INTERVAL 2 /* seconds */
 #define TRAFFIC_UPDATE_INTERVAL_MS (TRAFFIC_VECTOR_UPDATE_INTERVAL * 1000)
 #define isTimeToUpdateTraffic() (millis() - UpdateTrafficTimeMarker > \
                                   TRAFFIC_UPDATE_INTERVAL_MS)
 
+#if !defined(EXCLUDE_TRAFFIC_FUSION)
+#define TRAFFIC_FUSION_SOURCES  4     /* protocols per track */
+#define TRAFFIC_INDEX_KEYS    (MAX_TRACKING_OBJECTS * TRAFFIC_FUSION_SOURCES)
+#else
+#define TRAFFIC_INDEX_KEYS    MAX_TRACKING_OBJECTS
+#endif /* EXCLUDE_TRAFFIC_FUSION */
+
+/*
+ * Open addressing index of the traffic container, keyed by (addr, protocol).
+ * A fused slot holds one key per source, up to TRAFFIC_FUSION_SOURCES.
+ * Size of the index is a power of 2, at least twice TRAFFIC_INDEX_KEYS.
+ */
+#if   TRAFFIC_INDEX_KEYS <= 8
+#define TRAFFIC_INDEX_BITS    4
+#elif TRAFFIC_INDEX_KEYS <= 16
+#define TRAFFIC_INDEX_BITS    5
+#elif TRAFFIC_INDEX_KEYS <= 32
+#define TRAFFIC_INDEX_BITS    6
+#elif TRAFFIC_INDEX_KEYS <= 64
+#define TRAFFIC_INDEX_BITS    7
+#elif TRAFFIC_INDEX_KEYS <= 128
+#define TRAFFIC_INDEX_BITS    8
+#elif TRAFFIC_INDEX_KEYS <= 256
+#define TRAFFIC_INDEX_BITS    9
+#elif TRAFFIC_INDEX_KEYS <= 512
+#define TRAFFIC_INDEX_BITS    10
+#elif TRAFFIC_INDEX_KEYS <= 1024
+#define TRAFFIC_INDEX_BITS    11
+#elif TRAFFIC_INDEX_KEYS <= 2048
+#define TRAFFIC_INDEX_BITS    12
+#else
+#define TRAFFIC_INDEX_BITS    14
+#endif
+
+#define TRAFFIC_INDEX_SIZE    (1 << TRAFFIC_INDEX_BITS)
+#define TRAFFIC_INDEX_MASK    (TRAFFIC_INDEX_SIZE - 1)
+#define TRAFFIC_INDEX_EMPTY   0 /* index cells keep (slot + 1) */
+
+#define RAW_DATA_SIZE         34
+
+#if defined(RASPBERRY_PI) && !defined(EXCLUDE_TRAFFIC_RAW)
+/* raw packets are kept for SOFTRF_MODE_RELAY */
+#define TRAFFIC_RAW_STORAGE
+#endif /* RASPBERRY_PI && !EXCLUDE_TRAFFIC_RAW */
+
+#if !defined(EXCLUDE_TRAFFIC_HISTORY)
+#define TRAFFIC_HISTORY_SIZE  32  /* received fixes per target, power of 2 */
+
+/* number of history rings, slots beyond that have no history */
+#if !defined(TRAFFIC_HISTORY_POOL)
+#define TRAFFIC_HISTORY_POOL  MAX_TRACKING_OBJECTS
+#endif /* TRAFFIC_HISTORY_POOL */
+#endif /* EXCLUDE_TRAFFIC_HISTORY */
+
+/*
+ * Hot part of the traffic table, in the same order as Container[].
+ * Lookup, expiry and export scans do not have to touch full ufo_t entries.
+ */
+typedef struct traffic_hot_struct {
+  uint32_t  addr[MAX_TRACKING_OBJECTS];
+  time_t    timestamp[MAX_TRACKING_OBJECTS];
+  uint8_t   protocol[MAX_TRACKING_OBJECTS];
+} traffic_hot_t;
+
+typedef struct traffic_point_struct {
+  float     latitude;
+  float     longitude;
+  float     altitude;
+  uint32_t  ms;         /* millis() at reception */
+} traffic_point_t;
+
+#if !defined(EXCLUDE_TRAFFIC_SNAPSHOT)
+/*
+ * Published copy of the tracked targets, for readers out of the main loop.
+ * fo[] keeps the entries with aircraft ID only, in Container[] order.
+ */
+typedef struct traffic_snapshot_struct {
+  ufo_t         fo[MAX_TRACKING_OBJECTS];
+  uint16_t      slot[MAX_TRACKING_OBJECTS]; /* Container[] index of fo[] entries */
+  uint16_t      count;
+  unsigned long ms;                         /* millis() at publication */
+  int           readers;
+} traffic_snapshot_t;
+#endif /* EXCLUDE_TRAFFIC_SNAPSHOT */
+
+/*
+ * Export scheduler: targets are reported when they have changed, at a rate
+ * that depends on the range, and at once when their alarm level goes up.
+ */
+#define TRAFFIC_EXPORT_TICK_MS  250  /* fastest report rate, 4 Hz */
+#define TRAFFIC_EXPORT_MS       1000 /* regular rate, also of the 1 Hz messages */
+#define TRAFFIC_EXPORT_SLOW_MS  3000 /* distant targets without a new fix */
+#define TRAFFIC_EXPORT_NEAR     2000 /* metres, range of the fast rate */
+#define TRAFFIC_EXPORT_BT_RATE  2000 /* bytes per second over Bluetooth SPP */
+
+enum
+{
+	TRAFFIC_SINK_NMEA,
+	TRAFFIC_SINK_GDL90,
+	TRAFFIC_SINK_D1090,
+	TRAFFIC_SINK_JSON,
+	TRAFFIC_SINK_COUNT
+};
+
 typedef struct traffic_by_dist_struct {
   ufo_t *fop;
   float distance;
@@ -49,16 +159,53 @@ enum
 
 #define TRAFFIC_ALERT_SOUND   1
 
+bool ParseData_Accept(void);
 void ParseData(void);
 void Traffic_setup(void);
 void Traffic_loop(void);
 void ClearExpired(void);
 void Traffic_Update(ufo_t *);
+void Traffic_Extrapolate(void);
 int  Traffic_Count(void);
+uint8_t  Traffic_Position_Source(ufo_t *);
+bool     Traffic_Extrapolated(ufo_t *);
+
+ufo_t *Traffic_Lookup(uint32_t, uint8_t);
+ufo_t *Traffic_Store(ufo_t *);
+void   Traffic_Remove(ufo_t *);
+
+uint8_t *Traffic_Raw(ufo_t *);
+void     Traffic_Raw_Store(ufo_t *, const uint8_t *, size_t);
+
+int      Traffic_History(ufo_t *, traffic_point_t *, int);
+
+#if !defined(EXCLUDE_TRAFFIC_SNAPSHOT)
+void                Traffic_Publish(void);
+traffic_snapshot_t *Traffic_Snapshot_Acquire(void);
+void                Traffic_Snapshot_Release(traffic_snapshot_t *);
+#endif /* EXCLUDE_TRAFFIC_SNAPSHOT */
+
+bool     Traffic_Export_Tick(void);
+bool     Traffic_Export_Beat(void);
+uint32_t Traffic_Export_Wait(void);
+
+#if !defined(EXCLUDE_TRAFFIC_SCHEDULER)
+void Traffic_Export_Begin(uint8_t, uint8_t);
+bool Traffic_Export_Due(uint8_t, uint16_t);
+void Traffic_Export_Sent(uint8_t, uint16_t, size_t);
+void Traffic_Export_Out(uint8_t, size_t);
+#else
+#define Traffic_Export_Begin(sink, dest)      {}
+#define Traffic_Export_Due(sink, ndx)         (true)
+#define Traffic_Export_Sent(sink, ndx, size)  {}
+#define Traffic_Export_Out(dest, size)        {}
+#endif /* EXCLUDE_TRAFFIC_SCHEDULER */
 
 int  traffic_cmp_by_distance(const void *, const void *);
 
 extern ufo_t fo, Container[MAX_TRACKING_OBJECTS], EmptyFO;
+extern uint8_t fo_raw[RAW_DATA_SIZE];
+extern traffic_hot_t Traffic_Hot;
 extern traffic_by_dist_t traffic_by_dist[MAX_TRACKING_OBJECTS];
 
 #endif /* TRAFFICHELPER_H */
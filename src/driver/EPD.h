@@ -37,6 +37,7 @@
 #define maxof2(a,b)             (a > b ? a : b)
 
 #define EPD_RADAR_V_THRESHOLD   50      /* metres */
+#define EPD_RADAR_TRAIL         8       /* track history points per target */
 
 #define TEXT_VIEW_LINE_LENGTH   13     /* characters */
 #define TEXT_VIEW_LINE_SPACING  12     /* pixels */
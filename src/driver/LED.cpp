@@ -163,7 +163,7 @@ void LED_DisplayTraffic() {
 
     for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
 
-      if (Container[i].addr && (now() - Container[i].timestamp) <= LED_EXPIRATION_TIME) {
+      if (Traffic_Hot.addr[i] && (now() - Traffic_Hot.timestamp[i]) <= LED_EXPIRATION_TIME) {
 
         bearing  = (int) Container[i].bearing;
         distance = (int) Container[i].distance;
@@ -28,6 +28,7 @@
 #include "../protocol/data/MAVLink.h"
 #endif /* EXCLUDE_MAVLINK */
 #include <fec.h>
+#include "../system/CRC.h"
 
 #if LOGGER_IS_ENABLED
 #include "../system/Log.h"
@@ -40,6 +41,7 @@ byte TxBuffer[MAX_PKT_SIZE] __attribute__((aligned(sizeof(uint32_t))));
 
 uint32_t tx_packets_counter = 0;
 uint32_t rx_packets_counter = 0;
+uint32_t rx_manchester_errors = 0;
 
 int8_t RF_last_rssi = 0;
 
@@ -68,6 +70,25 @@ static uint8_t       RF_timing = RF_TIMING_INTERVAL;
 
 extern const gnss_chip_ops_t *gnss_chip;
 
+/* CRC-CCITT register value in front of the first payload byte */
+static inline u2_t RF_CCITT_Seed(const rf_proto_desc_t *rf_protocol)
+{
+  u2_t crc16 = rf_protocol->crc_type == RF_CHECKSUM_TYPE_CCITT_0000 ?
+               CRC_CCITT_SEED_0000 : CRC_CCITT_SEED_FFFF;
+
+  if (rf_protocol->type == RF_PROTOCOL_LEGACY) {
+    /* take in account NRF905/FLARM "address" bytes */
+    if (crc16 == CRC_CCITT_SEED_FFFF) {
+      crc16 = CRC_CCITT_LEGACY_FFFF;
+    } else {
+      static const u1_t legacy_addr[] = { 0x31, 0xFA, 0xB6 };
+      crc16 = CRC_CCITT_Update(crc16, legacy_addr, sizeof(legacy_addr));
+    }
+  }
+
+  return crc16;
+}
+
 static bool nrf905_probe(void);
 static void nrf905_setup(void);
 static void nrf905_channel(uint8_t);
@@ -1064,7 +1085,7 @@ static void sx12xx_rx_func (osjob_t* job) {
 
   u1_t crc8, pkt_crc8;
   u2_t crc16, pkt_crc16;
-  u1_t i;
+  u1_t i, first;
 
   // SX1276 is in SLEEP after IRQ handler, Force it to enter RX mode
   sx12xx_receive_active = false;
@@ -1074,77 +1095,43 @@ static void sx12xx_rx_func (osjob_t* job) {
     return;
   }
 
+  //Serial.print("Got ");
+  //Serial.print(LMIC.dataLen);
+  //Serial.println(" bytes");
+
+  first = LMIC.protocol->payload_offset;
+  i     = LMIC.dataLen - LMIC.protocol->crc_size > first ?
+          LMIC.dataLen - LMIC.protocol->crc_size : first;
+
+  /* CRC is taken over whitened ("on air") octets */
   switch (LMIC.protocol->crc_type)
   {
   case RF_CHECKSUM_TYPE_GALLAGER:
   case RF_CHECKSUM_TYPE_NONE:
-     /* crc16 left not initialized */
     break;
   case RF_CHECKSUM_TYPE_CRC8_107:
-    crc8 = 0x71;     /* seed value */
-    break;
-  case RF_CHECKSUM_TYPE_CCITT_0000:
-    crc16 = 0x0000;  /* seed value */
+    crc8 = CRC_8_107_Update(CRC_8_107_SEED, (u1_t *) &LMIC.frame[first],
+                            i - first);
     break;
   case RF_CHECKSUM_TYPE_CCITT_FFFF:
+  case RF_CHECKSUM_TYPE_CCITT_0000:
   default:
-    crc16 = 0xffff;  /* seed value */
-    break;
-  }
-
-  //Serial.print("Got ");
-  //Serial.print(LMIC.dataLen);
-  //Serial.println(" bytes");
-
-  switch (LMIC.protocol->type)
-  {
-  case RF_PROTOCOL_LEGACY:
-    /* take in account NRF905/FLARM "address" bytes */
-    crc16 = update_crc_ccitt(crc16, 0x31);
-    crc16 = update_crc_ccitt(crc16, 0xFA);
-    crc16 = update_crc_ccitt(crc16, 0xB6);
-    break;
-  case RF_PROTOCOL_P3I:
-  case RF_PROTOCOL_OGNTP:
-  default:
+    crc16 = CRC_CCITT_Update(RF_CCITT_Seed(LMIC.protocol),
+                             (u1_t *) &LMIC.frame[first], i - first);
     break;
   }
 
-  for (i = LMIC.protocol->payload_offset;
-       i < (LMIC.dataLen - LMIC.protocol->crc_size);
-       i++)
-  {
-
-    switch (LMIC.protocol->crc_type)
-    {
-    case RF_CHECKSUM_TYPE_GALLAGER:
-    case RF_CHECKSUM_TYPE_NONE:
-      break;
-    case RF_CHECKSUM_TYPE_CRC8_107:
-      update_crc8(&crc8, (u1_t)(LMIC.frame[i]));
-      break;
-    case RF_CHECKSUM_TYPE_CCITT_FFFF:
-    case RF_CHECKSUM_TYPE_CCITT_0000:
-    default:
-      crc16 = update_crc_ccitt(crc16, (u1_t)(LMIC.frame[i]));
-      break;
-    }
-
-    switch (LMIC.protocol->whitening)
-    {
-    case RF_WHITENING_NICERF:
-      LMIC.frame[i] ^= pgm_read_byte(&whitening_pattern[i - LMIC.protocol->payload_offset]);
-      break;
-    case RF_WHITENING_MANCHESTER:
-    case RF_WHITENING_NONE:
-    default:
-      break;
+  if (LMIC.protocol->whitening == RF_WHITENING_NICERF) {
+    for (u1_t j = first; j < i; j++) {
+      LMIC.frame[j] ^= pgm_read_byte(&whitening_pattern[j - first]);
     }
+  }
 
 #if DEBUG
-    Serial.printf("%02x", (u1_t)(LMIC.frame[i]));
-#endif
+  for (u1_t j = first; j < i; j++) {
+    Serial.printf("%02x", (u1_t)(LMIC.frame[j]));
   }
+#endif
 
   switch (LMIC.protocol->crc_type)
   {
@@ -1152,7 +1139,8 @@ static void sx12xx_rx_func (osjob_t* job) {
     sx12xx_receive_complete = true;
     break;
   case RF_CHECKSUM_TYPE_GALLAGER:
-    if (LDPC_Check((uint8_t  *) &LMIC.frame[0])) {
+    if (LDPC_Check((uint8_t  *) &LMIC.frame[0]) &&
+        !ogntp_repair((uint8_t  *) &LMIC.frame[0])) {
 #if DEBUG
       Serial.printf(" %02x%02x%02x%02x%02x%02x is wrong FEC",
         LMIC.frame[i], LMIC.frame[i+1], LMIC.frame[i+2],
@@ -1208,25 +1196,8 @@ static void sx12xx_tx(unsigned char *buf, size_t size, osjobcb_t func) {
 
   u1_t crc8;
   u2_t crc16;
+  u1_t first;
 
-  switch (LMIC.protocol->crc_type)
-  {
-  case RF_CHECKSUM_TYPE_GALLAGER:
-  case RF_CHECKSUM_TYPE_NONE:
-     /* crc16 left not initialized */
-    break;
-  case RF_CHECKSUM_TYPE_CRC8_107:
-    crc8 = 0x71;     /* seed value */
-    break;
-  case RF_CHECKSUM_TYPE_CCITT_0000:
-    crc16 = 0x0000;  /* seed value */
-    break;
-  case RF_CHECKSUM_TYPE_CCITT_FFFF:
-  default:
-    crc16 = 0xffff;  /* seed value */
-    break;
-  }
-  
   os_radio(RADIO_RST); // Stop RX first
   delay(1); // Wait a bit, without this os_radio below asserts, apparently because the state hasn't changed yet
 
@@ -1234,12 +1205,6 @@ static void sx12xx_tx(unsigned char *buf, size_t size, osjobcb_t func) {
 
   switch (LMIC.protocol->type)
   {
-  case RF_PROTOCOL_LEGACY:
-    /* take in account NRF905/FLARM "address" bytes */
-    crc16 = update_crc_ccitt(crc16, 0x31);
-    crc16 = update_crc_ccitt(crc16, 0xFA);
-    crc16 = update_crc_ccitt(crc16, 0xB6);
-    break;
   case RF_PROTOCOL_P3I:
     /* insert Net ID */
     LMIC.frame[LMIC.dataLen++] = (u1_t) ((LMIC.protocol->net_id >> 24) & 0x000000FF);
@@ -1251,45 +1216,25 @@ static void sx12xx_tx(unsigned char *buf, size_t size, osjobcb_t func) {
 
     /* insert byte with CRC-8 seed value when necessary */
     if (LMIC.protocol->crc_type == RF_CHECKSUM_TYPE_CRC8_107) {
-      LMIC.frame[LMIC.dataLen++] = crc8;
+      LMIC.frame[LMIC.dataLen++] = CRC_8_107_SEED;
     }
 
     break;
+  case RF_PROTOCOL_LEGACY:
   case RF_PROTOCOL_OGNTP:
   default:
     break;
   }
 
-  for (u1_t i=0; i < size; i++) {
+  first = LMIC.dataLen;
 
-    switch (LMIC.protocol->whitening)
-    {
-    case RF_WHITENING_NICERF:
-      LMIC.frame[LMIC.dataLen] = buf[i] ^ pgm_read_byte(&whitening_pattern[i]);
-      break;
-    case RF_WHITENING_MANCHESTER:
-    case RF_WHITENING_NONE:
-    default:
-      LMIC.frame[LMIC.dataLen] = buf[i];
-      break;
-    }
-
-    switch (LMIC.protocol->crc_type)
-    {
-    case RF_CHECKSUM_TYPE_GALLAGER:
-    case RF_CHECKSUM_TYPE_NONE:
-      break;
-    case RF_CHECKSUM_TYPE_CRC8_107:
-      update_crc8(&crc8, (u1_t)(LMIC.frame[LMIC.dataLen]));
-      break;
-    case RF_CHECKSUM_TYPE_CCITT_FFFF:
-    case RF_CHECKSUM_TYPE_CCITT_0000:
-    default:
-      crc16 = update_crc_ccitt(crc16, (u1_t)(LMIC.frame[LMIC.dataLen]));
-      break;
+  if (LMIC.protocol->whitening == RF_WHITENING_NICERF) {
+    for (u1_t i=0; i < size; i++) {
+      LMIC.frame[LMIC.dataLen++] = buf[i] ^ pgm_read_byte(&whitening_pattern[i]);
     }
-
-    LMIC.dataLen++;
+  } else {
+    memcpy(&LMIC.frame[LMIC.dataLen], buf, size);
+    LMIC.dataLen += size;
   }
 
   switch (LMIC.protocol->crc_type)
@@ -1298,11 +1243,14 @@ static void sx12xx_tx(unsigned char *buf, size_t size, osjobcb_t func) {
   case RF_CHECKSUM_TYPE_NONE:
     break;
   case RF_CHECKSUM_TYPE_CRC8_107:
+    crc8 = CRC_8_107_Update(CRC_8_107_SEED, (u1_t *) &LMIC.frame[first], size);
     LMIC.frame[LMIC.dataLen++] = crc8;
     break;
   case RF_CHECKSUM_TYPE_CCITT_FFFF:
   case RF_CHECKSUM_TYPE_CCITT_0000:
   default:
+    crc16 = CRC_CCITT_Update(RF_CCITT_Seed(LMIC.protocol),
+                             (u1_t *) &LMIC.frame[first], size);
     LMIC.frame[LMIC.dataLen++] = (crc16 >>  8) & 0xFF;
     LMIC.frame[LMIC.dataLen++] = (crc16      ) & 0xFF;
     break;
@@ -1334,11 +1282,27 @@ static void sx12xx_tx_func (osjob_t* job) {
 
 #include <uat.h>
 
-#define UAT_RINGBUF_SIZE  (sizeof(Stratux_frame_t) * 2)
+#define UAT_RINGBUF_SIZE  128 /* power of two, two frames at least */
+#define UAT_RINGBUF_MASK  (UAT_RINGBUF_SIZE - 1)
+
+#define UAT_FRAME_MAGIC   (((uint32_t) STRATUX_UATRADIO_MAGIC_1 << 24) | \
+                           ((uint32_t) STRATUX_UATRADIO_MAGIC_2 << 16) | \
+                           ((uint32_t) STRATUX_UATRADIO_MAGIC_3 <<  8) | \
+                           ((uint32_t) STRATUX_UATRADIO_MAGIC_4      ))
 
-static unsigned char uat_ringbuf[UAT_RINGBUF_SIZE];
-static unsigned int uatbuf_head = 0;
-Stratux_frame_t uatradio_frame;
+static_assert(UAT_RINGBUF_SIZE >= 2 * sizeof(Stratux_frame_t),
+              "UAT ring buffer is too small");
+
+/*
+ * Leading sizeof(Stratux_frame_t) octets of the ring are mirrored
+ * past its end, so that every frame is contiguous in memory
+ */
+static unsigned char uat_ringbuf[UAT_RINGBUF_SIZE + sizeof(Stratux_frame_t)];
+static unsigned int uatbuf_head  = 0; /* octets taken from UATSerial */
+static unsigned int uatbuf_scan  = 0; /* octets passed by sync search */
+static unsigned int uatbuf_frame = 0; /* start of a pending frame */
+static bool uatbuf_pending       = false;
+static uint32_t uatbuf_magic     = 0;
 
 const char UAT_ident[] PROGMEM = SOFTRF_IDENT;
 
@@ -1370,13 +1334,13 @@ static bool uatm_probe()
 #if DEBUG
       Serial.println(c, HEX);
 #endif
-      uat_ringbuf[uatbuf_head % UAT_RINGBUF_SIZE] = c;
+      uat_ringbuf[uatbuf_head & UAT_RINGBUF_MASK] = c;
 
       uatbuf_tail = uatbuf_head - keylen;
       uatbuf_head++;
 
       for (i=0; i < keylen; i++) {
-        if (pgm_read_byte(&UAT_ident[i]) != uat_ringbuf[(uatbuf_tail + i) % UAT_RINGBUF_SIZE]) {
+        if (pgm_read_byte(&UAT_ident[i]) != uat_ringbuf[(uatbuf_tail + i) & UAT_RINGBUF_MASK]) {
           break;
         }
       }
@@ -1389,7 +1353,10 @@ static bool uatm_probe()
   }
 
   /* cleanup UAT data buffer */
-  uatbuf_head = 0;
+  uatbuf_head    = 0;
+  uatbuf_scan    = 0;
+  uatbuf_pending = false;
+  uatbuf_magic   = 0;
   memset(uat_ringbuf, 0, sizeof(uat_ringbuf));
 
   /* Current ESP32 Core has a bug with Serial2.end()+Serial2.begin() cycle */
@@ -1424,30 +1391,65 @@ static void uatm_setup()
 static bool uatm_receive()
 {
   bool success = false;
-  unsigned int uatbuf_tail;
   int rs_errors;
 
-  while (UATSerial.available()) {
-    unsigned char c = UATSerial.read();
+  for (;;) {
+    Stratux_frame_t *frame = NULL;
 
-    uat_ringbuf[uatbuf_head % UAT_RINGBUF_SIZE] = c;
+    /* bulk ingest once everything in the ring has been searched through */
+    if (uatbuf_scan == uatbuf_head) {
+      unsigned int pos = uatbuf_head & UAT_RINGBUF_MASK;
+      size_t len = UATSerial.available();
 
-    uatbuf_tail = uatbuf_head - sizeof(Stratux_frame_t);
-    uatbuf_head++;
+      /* never let the write overrun a pending frame */
+      if (len > UAT_RINGBUF_SIZE / 2) {
+        len = UAT_RINGBUF_SIZE / 2;
+      }
+      if (len > UAT_RINGBUF_SIZE - pos) {
+        len = UAT_RINGBUF_SIZE - pos;
+      }
+      if (len > 0) {
+        len = UATSerial.readBytes(&uat_ringbuf[pos], len);
+      }
+      if (len == 0) {
+        break;
+      }
 
-    if (uat_ringbuf[ uatbuf_tail      % UAT_RINGBUF_SIZE] == STRATUX_UATRADIO_MAGIC_1 &&
-        uat_ringbuf[(uatbuf_tail + 1) % UAT_RINGBUF_SIZE] == STRATUX_UATRADIO_MAGIC_2 &&
-        uat_ringbuf[(uatbuf_tail + 2) % UAT_RINGBUF_SIZE] == STRATUX_UATRADIO_MAGIC_3 &&
-        uat_ringbuf[(uatbuf_tail + 3) % UAT_RINGBUF_SIZE] == STRATUX_UATRADIO_MAGIC_4) {
+      if (pos < sizeof(Stratux_frame_t)) {
+        memcpy(&uat_ringbuf[UAT_RINGBUF_SIZE + pos], &uat_ringbuf[pos],
+               min(len, sizeof(Stratux_frame_t) - pos));
+      }
 
-      unsigned char *pre_fec_buf = (unsigned char *) &uatradio_frame;
-      for (u1_t i=0; i < sizeof(Stratux_frame_t); i++) {
-          pre_fec_buf[i] = uat_ringbuf[(uatbuf_tail + i) % UAT_RINGBUF_SIZE];
+      uatbuf_head += len;
+    }
+
+    while (uatbuf_scan != uatbuf_head) {
+      uatbuf_magic = (uatbuf_magic << 8) |
+                     uat_ringbuf[uatbuf_scan & UAT_RINGBUF_MASK];
+      uatbuf_scan++;
+
+      if (!uatbuf_pending && uatbuf_magic == UAT_FRAME_MAGIC) {
+        uatbuf_frame   = uatbuf_scan - 4;
+        uatbuf_pending = true;
+      }
+
+      if (uatbuf_pending &&
+          uatbuf_scan - uatbuf_frame == sizeof(Stratux_frame_t)) {
+        frame = (Stratux_frame_t *) &uat_ringbuf[uatbuf_frame & UAT_RINGBUF_MASK];
+        uatbuf_pending = false;
+        break;
       }
+    }
+
+    if (frame != NULL) {
 
-      int frame_type = correct_adsb_frame(uatradio_frame.data, &rs_errors);
+      /* Reed-Solomon runs in place, on the ring */
+      int frame_type = correct_adsb_frame(frame->data, &rs_errors);
 
       if (frame_type == -1) {
+        /* a false sync, search on from the octet that follows it */
+        uatbuf_scan  = uatbuf_frame + 1;
+        uatbuf_magic = 0;
         continue;
       }
 
@@ -1464,9 +1466,9 @@ static bool uatm_receive()
       }
 
       if (size > 0) {
-        memcpy(RxBuffer, uatradio_frame.data, size);
+        memcpy(RxBuffer, frame->data, size);
 
-        RF_last_rssi = uatradio_frame.rssi;
+        RF_last_rssi = frame->rssi;
         rx_packets_counter++;
         success = true;
 
@@ -1506,6 +1508,40 @@ static void uatm_shutdown()
 
 #define MAX_SYNCWORD_SIZE       4
 
+#if !defined(EXCLUDE_OGLEP3)
+/*
+ * IEEE 802.3 Manchester, one raw octet (4 chip pairs) into one nibble.
+ * "01" is 1, "10" is 0. Invalid "00" and "11" pairs decode by the second
+ * chip and set bit 7, so that coding errors can be counted.
+ */
+#define MANCHESTER_ERROR        0x80
+
+static const uint8_t RF_Manchester_Decode[256] PROGMEM = {
+  0x80, 0x81, 0x80, 0x81, 0x82, 0x83, 0x82, 0x83, 0x80, 0x81, 0x80, 0x81,
+  0x82, 0x83, 0x82, 0x83, 0x84, 0x85, 0x84, 0x85, 0x86, 0x87, 0x86, 0x87,
+  0x84, 0x85, 0x84, 0x85, 0x86, 0x87, 0x86, 0x87, 0x80, 0x81, 0x80, 0x81,
+  0x82, 0x83, 0x82, 0x83, 0x80, 0x81, 0x80, 0x81, 0x82, 0x83, 0x82, 0x83,
+  0x84, 0x85, 0x84, 0x85, 0x86, 0x87, 0x86, 0x87, 0x84, 0x85, 0x84, 0x85,
+  0x86, 0x87, 0x86, 0x87, 0x88, 0x89, 0x88, 0x89, 0x8a, 0x8b, 0x8a, 0x8b,
+  0x88, 0x89, 0x88, 0x89, 0x8a, 0x8b, 0x8a, 0x8b, 0x8c, 0x8d, 0x8c, 0x8d,
+  0x8e, 0x0f, 0x0e, 0x8f, 0x8c, 0x0d, 0x0c, 0x8d, 0x8e, 0x8f, 0x8e, 0x8f,
+  0x88, 0x89, 0x88, 0x89, 0x8a, 0x0b, 0x0a, 0x8b, 0x88, 0x09, 0x08, 0x89,
+  0x8a, 0x8b, 0x8a, 0x8b, 0x8c, 0x8d, 0x8c, 0x8d, 0x8e, 0x8f, 0x8e, 0x8f,
+  0x8c, 0x8d, 0x8c, 0x8d, 0x8e, 0x8f, 0x8e, 0x8f, 0x80, 0x81, 0x80, 0x81,
+  0x82, 0x83, 0x82, 0x83, 0x80, 0x81, 0x80, 0x81, 0x82, 0x83, 0x82, 0x83,
+  0x84, 0x85, 0x84, 0x85, 0x86, 0x07, 0x06, 0x87, 0x84, 0x05, 0x04, 0x85,
+  0x86, 0x87, 0x86, 0x87, 0x80, 0x81, 0x80, 0x81, 0x82, 0x03, 0x02, 0x83,
+  0x80, 0x01, 0x00, 0x81, 0x82, 0x83, 0x82, 0x83, 0x84, 0x85, 0x84, 0x85,
+  0x86, 0x87, 0x86, 0x87, 0x84, 0x85, 0x84, 0x85, 0x86, 0x87, 0x86, 0x87,
+  0x88, 0x89, 0x88, 0x89, 0x8a, 0x8b, 0x8a, 0x8b, 0x88, 0x89, 0x88, 0x89,
+  0x8a, 0x8b, 0x8a, 0x8b, 0x8c, 0x8d, 0x8c, 0x8d, 0x8e, 0x8f, 0x8e, 0x8f,
+  0x8c, 0x8d, 0x8c, 0x8d, 0x8e, 0x8f, 0x8e, 0x8f, 0x88, 0x89, 0x88, 0x89,
+  0x8a, 0x8b, 0x8a, 0x8b, 0x88, 0x89, 0x88, 0x89, 0x8a, 0x8b, 0x8a, 0x8b,
+  0x8c, 0x8d, 0x8c, 0x8d, 0x8e, 0x8f, 0x8e, 0x8f, 0x8c, 0x8d, 0x8c, 0x8d,
+  0x8e, 0x8f, 0x8e, 0x8f
+};
+#endif /* EXCLUDE_OGLEP3 */
+
 const rf_proto_desc_t  *cc13xx_protocol = &uat978_proto_desc;
 
 EasyLink myLink;
@@ -1532,49 +1568,16 @@ void cc13xx_Receive_callback(EasyLink_RxPacket *rxPacket_ptr, EasyLink_Status st
     u1_t crc8, pkt_crc8;
     u2_t crc16, pkt_crc16;
 
-#if !defined(EXCLUDE_OGLEP3)
-    switch (cc13xx_protocol->crc_type)
-    {
-    case RF_CHECKSUM_TYPE_GALLAGER:
-    case RF_CHECKSUM_TYPE_NONE:
-       /* crc16 left not initialized */
-      break;
-    case RF_CHECKSUM_TYPE_CRC8_107:
-      crc8 = 0x71;     /* seed value */
-      break;
-    case RF_CHECKSUM_TYPE_CCITT_0000:
-      crc16 = 0x0000;  /* seed value */
-      break;
-    case RF_CHECKSUM_TYPE_CCITT_FFFF:
-    default:
-      crc16 = 0xffff;  /* seed value */
-      break;
-    }
-
-    switch (cc13xx_protocol->type)
-    {
-    case RF_PROTOCOL_LEGACY:
-      /* take in account NRF905/FLARM "address" bytes */
-      crc16 = update_crc_ccitt(crc16, 0x31);
-      crc16 = update_crc_ccitt(crc16, 0xFA);
-      crc16 = update_crc_ccitt(crc16, 0xB6);
-      break;
-    case RF_PROTOCOL_P3I:
-    case RF_PROTOCOL_OGNTP:
-    default:
-      break;
-    }
-#endif /* EXCLUDE_OGLEP3 */
-
     switch (cc13xx_protocol->type)
     {
 #if !defined(EXCLUDE_OGLEP3)
     case RF_PROTOCOL_P3I:
       uint8_t i;
       offset = cc13xx_protocol->payload_offset;
+      crc8 = CRC_8_107_Update(CRC_8_107_SEED, &rxPacket_ptr->payload[offset],
+                              cc13xx_protocol->payload_size);
       for (i = 0; i < cc13xx_protocol->payload_size; i++)
       {
-        update_crc8(&crc8, (u1_t)(rxPacket_ptr->payload[i + offset]));
         if (i < sizeof(RxBuffer)) {
           RxBuffer[i] = rxPacket_ptr->payload[i + offset] ^
                         pgm_read_byte(&whitening_pattern[i]);
@@ -1602,34 +1605,39 @@ void cc13xx_Receive_callback(EasyLink_RxPacket *rxPacket_ptr, EasyLink_Status st
           rxPacket_ptr->payload[2] == cc13xx_protocol->syncword[6] &&
           (offset > 3 ? (rxPacket_ptr->payload[3] == cc13xx_protocol->syncword[7]) : true)) {
 
-        uint8_t i, val1, val2;
-        for (i = 0; i < size; i++) {
-          val1 = pgm_read_byte(&ManchesterDecode[rxPacket_ptr->payload[i + offset]]);
-          i++;
-          val2 = pgm_read_byte(&ManchesterDecode[rxPacket_ptr->payload[i + offset]]);
-          if ((i>>1) < sizeof(RxBuffer)) {
-            RxBuffer[i>>1] = ((val1 & 0x0F) << 4) | (val2 & 0x0F);
-
-            if (i < size - (cc13xx_protocol->crc_size + cc13xx_protocol->crc_size)) {
-              switch (cc13xx_protocol->crc_type)
-              {
-              case RF_CHECKSUM_TYPE_GALLAGER:
-              case RF_CHECKSUM_TYPE_NONE:
-                break;
-              case RF_CHECKSUM_TYPE_CCITT_FFFF:
-              case RF_CHECKSUM_TYPE_CCITT_0000:
-              default:
-                crc16 = update_crc_ccitt(crc16, (u1_t)(RxBuffer[i>>1]));
-                break;
-              }
-            }
+        const uint8_t *raw = &rxPacket_ptr->payload[offset];
+        uint8_t i, val1, val2, crc_len, errors = 0;
+        uint8_t n = (size + 1) >> 1;
+
+        if (n > sizeof(RxBuffer)) {
+          n = sizeof(RxBuffer);
+        }
+
+        crc_len = cc13xx_protocol->crc_type == RF_CHECKSUM_TYPE_GALLAGER ? 0 :
+                  cc13xx_protocol->payload_offset + cc13xx_protocol->payload_size;
+        crc16   = RF_CCITT_Seed(cc13xx_protocol);
+
+        /* Manchester decode and CRC in one pass */
+        for (i = 0; i < n; i++, raw += 2) {
+          val1 = pgm_read_byte(&RF_Manchester_Decode[raw[0]]);
+          val2 = pgm_read_byte(&RF_Manchester_Decode[raw[1]]);
+          errors += ((val1 & MANCHESTER_ERROR) != 0) +
+                    ((val2 & MANCHESTER_ERROR) != 0);
+
+          RxBuffer[i] = (val1 << 4) | (val2 & 0x0F);
+
+          if (i < crc_len) {
+            crc16 = CRC_CCITT_Byte(crc16, RxBuffer[i]);
           }
         }
 
+        rx_manchester_errors += errors;
+
         switch (cc13xx_protocol->crc_type)
         {
         case RF_CHECKSUM_TYPE_GALLAGER:
-          if (LDPC_Check((uint8_t  *) &RxBuffer[0]) == 0) {
+          if (LDPC_Check((uint8_t  *) &RxBuffer[0]) == 0 ||
+              ogntp_repair((uint8_t  *) &RxBuffer[0])) {
 
             success = true;
           }
@@ -1827,6 +1835,7 @@ static void cc13xx_transmit()
   u1_t crc8;
   u2_t crc16;
   u1_t i;
+  size_t first;
 
   if (RF_tx_size <= 0) {
     return;
@@ -1843,24 +1852,6 @@ static void cc13xx_transmit()
 
   size_t PayloadLen = 0;
 
-  switch (cc13xx_protocol->crc_type)
-  {
-  case RF_CHECKSUM_TYPE_GALLAGER:
-  case RF_CHECKSUM_TYPE_NONE:
-     /* crc16 left not initialized */
-    break;
-  case RF_CHECKSUM_TYPE_CRC8_107:
-    crc8 = 0x71;     /* seed value */
-    break;
-  case RF_CHECKSUM_TYPE_CCITT_0000:
-    crc16 = 0x0000;  /* seed value */
-    break;
-  case RF_CHECKSUM_TYPE_CCITT_FFFF:
-  default:
-    crc16 = 0xffff;  /* seed value */
-    break;
-  }
-
   for (i = MAX_SYNCWORD_SIZE; i < cc13xx_protocol->syncword_size; i++)
   {
     txPacket.payload[PayloadLen++] = cc13xx_protocol->syncword[i];
@@ -1868,12 +1859,6 @@ static void cc13xx_transmit()
 
   switch (cc13xx_protocol->type)
   {
-  case RF_PROTOCOL_LEGACY:
-    /* take in account NRF905/FLARM "address" bytes */
-    crc16 = update_crc_ccitt(crc16, 0x31);
-    crc16 = update_crc_ccitt(crc16, 0xFA);
-    crc16 = update_crc_ccitt(crc16, 0xB6);
-    break;
   case RF_PROTOCOL_P3I:
     /* insert Net ID */
     txPacket.payload[PayloadLen++] = (u1_t) ((cc13xx_protocol->net_id >> 24) & 0x000000FF);
@@ -1885,53 +1870,36 @@ static void cc13xx_transmit()
 
     /* insert byte with CRC-8 seed value when necessary */
     if (cc13xx_protocol->crc_type == RF_CHECKSUM_TYPE_CRC8_107) {
-      txPacket.payload[PayloadLen++] = crc8;
+      txPacket.payload[PayloadLen++] = CRC_8_107_SEED;
     }
 
     break;
+  case RF_PROTOCOL_LEGACY:
   case RF_PROTOCOL_OGNTP:
   default:
     break;
   }
 
-  for (i=0; i < RF_tx_size; i++) {
+  first = PayloadLen;
 
-    switch (cc13xx_protocol->whitening)
-    {
-    case RF_WHITENING_NICERF:
-      txPacket.payload[PayloadLen] = TxBuffer[i] ^ pgm_read_byte(&whitening_pattern[i]);
-      break;
-    case RF_WHITENING_MANCHESTER:
-      txPacket.payload[PayloadLen] = pgm_read_byte(&ManchesterEncode[(TxBuffer[i] >> 4) & 0x0F]);
-      PayloadLen++;
-      txPacket.payload[PayloadLen] = pgm_read_byte(&ManchesterEncode[(TxBuffer[i]     ) & 0x0F]);
-      break;
-    case RF_WHITENING_NONE:
-    default:
-      txPacket.payload[PayloadLen] = TxBuffer[i];
-      break;
+  switch (cc13xx_protocol->whitening)
+  {
+  case RF_WHITENING_NICERF:
+    for (i=0; i < RF_tx_size; i++) {
+      txPacket.payload[PayloadLen++] = TxBuffer[i] ^ pgm_read_byte(&whitening_pattern[i]);
     }
-
-    switch (cc13xx_protocol->crc_type)
-    {
-    case RF_CHECKSUM_TYPE_GALLAGER:
-    case RF_CHECKSUM_TYPE_NONE:
-      break;
-    case RF_CHECKSUM_TYPE_CRC8_107:
-      update_crc8(&crc8, (u1_t)(txPacket.payload[PayloadLen]));
-      break;
-    case RF_CHECKSUM_TYPE_CCITT_FFFF:
-    case RF_CHECKSUM_TYPE_CCITT_0000:
-    default:
-      if (cc13xx_protocol->whitening == RF_WHITENING_MANCHESTER) {
-        crc16 = update_crc_ccitt(crc16, (u1_t)(TxBuffer[i]));
-      } else {
-        crc16 = update_crc_ccitt(crc16, (u1_t)(txPacket.payload[PayloadLen]));
-      }
-      break;
+    break;
+  case RF_WHITENING_MANCHESTER:
+    for (i=0; i < RF_tx_size; i++) {
+      txPacket.payload[PayloadLen++] = pgm_read_byte(&ManchesterEncode[(TxBuffer[i] >> 4) & 0x0F]);
+      txPacket.payload[PayloadLen++] = pgm_read_byte(&ManchesterEncode[(TxBuffer[i]     ) & 0x0F]);
     }
-
-    PayloadLen++;
+    break;
+  case RF_WHITENING_NONE:
+  default:
+    memcpy(&txPacket.payload[PayloadLen], TxBuffer, RF_tx_size);
+    PayloadLen += RF_tx_size;
+    break;
   }
 
   switch (cc13xx_protocol->crc_type)
@@ -1940,11 +1908,17 @@ static void cc13xx_transmit()
   case RF_CHECKSUM_TYPE_NONE:
     break;
   case RF_CHECKSUM_TYPE_CRC8_107:
+    crc8 = CRC_8_107_Update(CRC_8_107_SEED, &txPacket.payload[first], RF_tx_size);
     txPacket.payload[PayloadLen++] = crc8;
     break;
   case RF_CHECKSUM_TYPE_CCITT_FFFF:
   case RF_CHECKSUM_TYPE_CCITT_0000:
   default:
+    /* Manchester coded frames carry CRC of the plain octets */
+    crc16 = CRC_CCITT_Update(RF_CCITT_Seed(cc13xx_protocol),
+                             cc13xx_protocol->whitening == RF_WHITENING_MANCHESTER ?
+                             TxBuffer : &txPacket.payload[first], RF_tx_size);
+
     if (cc13xx_protocol->whitening == RF_WHITENING_MANCHESTER) {
       txPacket.payload[PayloadLen++] = pgm_read_byte(&ManchesterEncode[(((crc16 >>  8) & 0xFF) >> 4) & 0x0F]);
       txPacket.payload[PayloadLen++] = pgm_read_byte(&ManchesterEncode[(((crc16 >>  8) & 0xFF)     ) & 0x0F]);
@@ -2161,7 +2135,8 @@ static bool ognrf_receive()
     RxRSSI = TRX.ReadRSSI();
 
     TRX.ReadPacket(RxBuffer, Err);
-    if (LDPC_Check((uint8_t  *) RxBuffer) == 0) {
+    if (LDPC_Check((uint8_t  *) RxBuffer) == 0 ||
+        ogntp_repair((uint8_t  *) RxBuffer)) {
       success = true;
     }
   }
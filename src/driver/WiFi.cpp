@@ -35,6 +35,8 @@ void WiFi_fini()    {}
 #include "RF.h"
 #include "../ui/Web.h"
 #include "../protocol/data/NMEA.h"
+#include "../protocol/data/GDL90.h"
+#include "../protocol/data/D1090.h"
 #include "Battery.h"
 
 String station_ssid = MY_ACCESSPOINT_SSID ;
@@ -187,8 +189,8 @@ size_t Raw_Receive_UDP(uint8_t *buf)
 void Raw_Transmit_UDP()
 {
     size_t rx_size = RF_Payload_Size(settings->rf_protocol);
-    rx_size = rx_size > sizeof(fo.raw) ? sizeof(fo.raw) : rx_size;
-    String str = Bin2Hex(fo.raw, rx_size);
+    rx_size = rx_size > sizeof(fo_raw) ? sizeof(fo_raw) : rx_size;
+    String str = Bin2Hex(fo_raw, rx_size);
     size_t len = str.length();
     // ASSERT(sizeof(UDPpacketBuffer) > 2 * PKT_SIZE + 1)
     str.toCharArray(UDPpacketBuffer, sizeof(UDPpacketBuffer));
@@ -323,6 +325,8 @@ void WiFi_loop()
     if (SoC->WiFi_clients_count() == 0) {
       if ((millis() - WiFi_No_Clients_Time_ms) > POWER_SAVING_WIFI_TIMEOUT) {
         NMEA_fini();
+        GDL90_fini();
+        D1090_fini();
         Web_fini();
         WiFi_fini();
 
@@ -132,6 +132,11 @@ struct rst_info {
 #define EXCLUDE_TEST_MODE
 #define EXCLUDE_WATCHOUT_MODE
 #define EXCLUDE_TRAFFIC_FILTER_EXTENSION
+#define EXCLUDE_TRAFFIC_FUSION
+#define EXCLUDE_TRAFFIC_HISTORY
+#define EXCLUDE_TRAFFIC_SNAPSHOT
+#define EXCLUDE_TRAFFIC_SCHEDULER
+#define EXCLUDE_D1090_CACHE
 //#define EXCLUDE_LK8EX1
 
 #define EXCLUDE_GNSS_UBLOX
@@ -160,6 +165,10 @@ struct rst_info {
 
 //#define USE_TIME_SLOTS
 
+#define NMEA_BATCH_SIZE          256
+#define GDL90_BATCH_SIZE         128
+#define D1090_BATCH_SIZE         128
+
 /* SoftRF/AVR PFLAU NMEA sentence extension. In use by WebTop adapter */
 //#define PFLAU_EXT1_FMT  ",%06X,%d,%d,%d,%d"
 //#define PFLAU_EXT1_ARGS ,ThisAircraft.addr,settings->rf_protocol,rx_packets_counter,tx_packets_counter,(int)(Battery_voltage()*100)
@@ -95,9 +95,12 @@ struct rst_info {
 #define EXCLUDE_NRF905
 #define EXCLUDE_UATM
 
-/* SoftRF/CC13XX PFLAU NMEA sentence extension. In use by WebTop adapter */
-#define PFLAU_EXT1_FMT  ",%06X,%d,%d,%d"
-#define PFLAU_EXT1_ARGS ,ThisAircraft.addr,settings->rf_protocol,rx_packets_counter,tx_packets_counter
+/*
+ * SoftRF/CC13XX PFLAU NMEA sentence extension. In use by WebTop adapter.
+ * The last field is the count of Manchester code violations received.
+ */
+#define PFLAU_EXT1_FMT  ",%06X,%d,%d,%d,%u"
+#define PFLAU_EXT1_ARGS ,ThisAircraft.addr,settings->rf_protocol,rx_packets_counter,tx_packets_counter,rx_manchester_errors
 
 #include "../../hal_conf_extra.h"   // Sketch-specific definitions are located there
 
@@ -143,6 +146,8 @@ struct rst_info {
 #define EXCLUDE_LK8EX1
 #define EXCLUDE_WATCHOUT_MODE
 #define EXCLUDE_TRAFFIC_FILTER_EXTENSION
+#define EXCLUDE_TRAFFIC_HISTORY
+#define EXCLUDE_TRAFFIC_SNAPSHOT
 #define EXCLUDE_LOG_GNSS_VERSION
 
 //#define USE_TIME_SLOTS
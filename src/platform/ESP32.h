@@ -300,6 +300,8 @@ struct rst_info {
 #define ESP32_DISABLE_BROWNOUT_DETECTOR 0
 
 #define NMEA_TCP_SERVICE
+#define GDL90_TCP_SERVICE
+#define D1090_TCP_SERVICE
 #define USE_NMEALIB
 #define USE_OLED
 #define EXCLUDE_OLED_049
@@ -141,6 +141,11 @@ struct rst_info {
 #define EXCLUDE_TEST_MODE
 #define EXCLUDE_WATCHOUT_MODE
 #define EXCLUDE_TRAFFIC_FILTER_EXTENSION
+#define EXCLUDE_TRAFFIC_FUSION
+#define EXCLUDE_TRAFFIC_HISTORY
+#define EXCLUDE_TRAFFIC_SNAPSHOT
+#define EXCLUDE_TRAFFIC_SCHEDULER
+#define EXCLUDE_D1090_CACHE
 #define EXCLUDE_LK8EX1
 
 #define EXCLUDE_GNSS_UBLOX
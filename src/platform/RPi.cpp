@@ -65,10 +65,7 @@
 #include "../driver/Bluetooth.h"
 #include "../system/Time.h"
 
-#include "TCPServer.h"
-
 #include <stdio.h>
-#include <sys/select.h>
 
 #include <iostream>
 
@@ -141,13 +138,8 @@ hardware_info_t hw_info = {
   .imu      = IMU_NONE
 };
 
-#define isTimeToExport() (millis() - ExportTimeMarker > 1000)
-unsigned long ExportTimeMarker = 0;
-
 std::string input_line;
 
-TCPServer Traffic_TCP_Server;
-
 #if defined(USE_EPAPER)
 GxEPD2_BW<GxEPD2_270, GxEPD2_270::HEIGHT> __attribute__ ((common)) epd_waveshare(GxEPD2_270(/*CS=5*/ 8,
                                        /*DC=*/ 25, /*RST=*/ 17, /*BUSY=*/ 24));
@@ -581,18 +573,6 @@ const SoC_ops_t RPi_ops = {
   NULL
 };
 
-static bool inputAvailable()
-{
-  struct timeval tv;
-  fd_set fds;
-  tv.tv_sec = 0;
-  tv.tv_usec = 0;
-  FD_ZERO(&fds);
-  FD_SET(STDIN_FILENO, &fds);
-  select(STDIN_FILENO+1, &fds, NULL, NULL, &tv);
-  return (FD_ISSET(0, &fds));
-}
-
 static void parseNMEA(const char *str, int len)
 {
   // NMEA input
@@ -628,115 +608,1352 @@ static void parseNMEA(const char *str, int len)
   }
 }
 
+static void RPi_ParseInput(const char *str, int len)
+{
+  if (str[0] == '$' && str[1] == 'G') {
+    // NMEA input
+    parseNMEA(str, len);
+
+  } else if (str[0] == '{' &&
+             parseD1090_Stream(str, len,
+                               ThisAircraft.latitude, ThisAircraft.longitude,
+                               isValidFix() ? JSON_D1090_RANGE : 0,
+                               JSON_Traffic_Store)) {
+    /* 'aircraft.json' output from 'dump1090' application, no DOM needed */
+  } else if (str[0] == '{') {
+    // JSON input
+
+    JsonObject& root = jsonBuffer.parseObject(str);
+
+    JsonVariant msg_class = root["class"];
+
+    if (msg_class.success()) {
+      const char *msg_class_s = msg_class.as<char*>();
+
+      if (!strcmp(msg_class_s,"TPV")) { // "TPV"
+        parseTPV(root);
+      } else if (!strcmp(msg_class_s,"SOFTRF")) {
+        parseSettings(root);
+
+        RF_setup();
+        Traffic_setup();
+      }
+    }
+
+    if (root.containsKey("now") &&
+        root.containsKey("messages") &&
+        root.containsKey("aircraft")) {
+      /* 'aircraft.json' output from 'dump1090' application */
+      parseD1090(root, JSON_Traffic_Store);
+    } else if (root.containsKey("aircraft")) {
+      /* uAvionix PingStation */
+      parsePING(root, JSON_Traffic_Store);
+    }
+
+    jsonBuffer.clear();
+
+    if ((time(NULL) - now()) > 3) {
+      hasValidGPSDFix = false;
+    }
+  }
+}
+
+static bool RPi_Input_EOF = false;
+
+/*
+ * stdin is non-blocking and read with read(2) rather than std::cin,
+ * so no lines are left behind in a stdio buffer where neither select()
+ * nor epoll can see them. Every complete line of the burst is parsed.
+ */
 static void RPi_PickGNSSFix()
 {
-  if (inputAvailable()) {
-    std::getline(std::cin, input_line);
-    const char *str = input_line.c_str();
-    int len = input_line.length();
+  char buf[1024];
+  size_t start = 0;
+  size_t eol;
+
+  while (!RPi_Input_EOF) {
+    ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+
+    if (n > 0) {
+      input_line.append(buf, n);
+    } else {
+      if (n == 0) {
+        RPi_Input_EOF = true;
+      }
+      break; /* EAGAIN */
+    }
+  }
+
+  while ((eol = input_line.find('\n', start)) != std::string::npos) {
+    input_line[eol] = '\0';
+    RPi_ParseInput(input_line.c_str() + start, eol - start);
+    start = eol + 1;
+  }
+
+  if (start > 0) {
+    input_line.erase(0, start);
+  }
+}
+
+/*
+ * Traffic ingest TCP server (JSON_SRV_TCP_PORT).
+ *
+ * Up to JSON_SRV_MAX_CLIENTS feeds (dump1090, PingStation, raw relays)
+ * may be connected at once, each with a read buffer of its own. A message
+ * is either one JSON object, whatever line breaks it contains, or one line
+ * of text. Framing picks up where the previous read stopped. A complete
+ * message is queued as a slice of the read buffer and handed to the
+ * consumer in place, NUL terminated for the duration of the call.
+ */
+#include <ctype.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+
+#define RPI_SERVER_BUFSIZE    262144 /* largest message, a busy aircraft.json */
+#define RPI_SERVER_QUEUE      64     /* slices */
+#define RPI_SERVER_EVENTS     8
+#define RPI_SERVER_LISTEN     0xFFFF
+#define RPI_SERVER_FEED       0xFFFE /* dump1090 Beast/AVR client */
+
+typedef struct {
+  int       fd;
+  char     *buf;
+  uint32_t  len;        /* bytes in buf */
+  uint32_t  scan;       /* framing goes on from here */
+  uint32_t  start;      /* of the message in progress */
+  uint32_t  pinned;     /* slices of buf in the queue */
+  int       depth;      /* of JSON objects */
+  bool      quoted;     /* inside a JSON string */
+  bool      escape;
+  bool      closing;    /* EOF, to be closed once not pinned */
+  uint32_t  tokens;     /* of the rate limit, in messages */
+  uint32_t  refill_ms;
+  uint32_t  limited;    /* messages dropped by the rate limit */
+} rpi_conn_t;
+
+typedef struct {
+  rpi_conn_t *conn;
+  uint32_t    offset;
+  uint32_t    len;
+} rpi_slice_t;
+
+typedef void (*rpi_message_t)(char *, int);
+
+static struct {
+  int         listen_fd;
+  int         epoll_fd;
+  rpi_conn_t  conn[JSON_SRV_MAX_CLIENTS];
+  rpi_slice_t queue[RPI_SERVER_QUEUE];
+  uint32_t    head;
+  uint32_t    tail;
+
+  uint32_t    accepted;
+  uint32_t    rejected;  /* no free connection */
+  uint32_t    messages;
+  uint32_t    limited;   /* over the rate limit of a client */
+  uint32_t    overflows; /* message larger than the read buffer */
+  uint32_t    stalls;    /* framing held back by a full queue */
+} RPi_Server = { -1, -1 };
+
+static void RPi_Server_Close(rpi_conn_t *c)
+{
+  epoll_ctl(RPi_Server.epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+  close(c->fd);
+  free(c->buf);
+  memset(c, 0, sizeof(rpi_conn_t));
+  c->fd = -1;
+}
 
-    if (str[0] == '$' && str[1] == 'G') {
-      // NMEA input
-      parseNMEA(str, len);
+static void RPi_Server_Accept()
+{
+  int fd;
 
-    } else if (str[0] == '{') {
-      // JSON input
+  while ((fd = accept4(RPi_Server.listen_fd, NULL, NULL,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    rpi_conn_t *c = NULL;
 
-      JsonObject& root = jsonBuffer.parseObject(str);
+    for (int i = 0; i < JSON_SRV_MAX_CLIENTS; i++) {
+      if (RPi_Server.conn[i].fd < 0) {
+        c = &RPi_Server.conn[i];
+        break;
+      }
+    }
 
-      JsonVariant msg_class = root["class"];
+    if (c == NULL || (c->buf = (char *) malloc(RPI_SERVER_BUFSIZE)) == NULL) {
+      RPi_Server.rejected++;
+      close(fd);
+      continue;
+    }
 
-      if (msg_class.success()) {
-        const char *msg_class_s = msg_class.as<char*>();
+    struct epoll_event ev;
+    ev.events   = EPOLLIN;
+    ev.data.u32 = c - RPi_Server.conn;
+    epoll_ctl(RPi_Server.epoll_fd, EPOLL_CTL_ADD, fd, &ev);
 
-        if (!strcmp(msg_class_s,"TPV")) { // "TPV"
-          parseTPV(root);
-        } else if (!strcmp(msg_class_s,"SOFTRF")) {
-          parseSettings(root);
+    c->fd        = fd;
+    c->tokens    = JSON_SRV_RATE_LIMIT;
+    c->refill_ms = millis();
+    RPi_Server.accepted++;
+  }
+}
+
+/* queue buf[from, to) of a connection, blanks around are not a message */
+static void RPi_Server_Message(rpi_conn_t *c, uint32_t from, uint32_t to)
+{
+  c->start = c->scan;
+
+  while (from < to && isspace((unsigned char) c->buf[from])) from++;
+  while (to > from && isspace((unsigned char) c->buf[to - 1])) to--;
+
+  if (from == to) {
+    return;
+  }
+
+#if JSON_SRV_RATE_LIMIT > 0
+  uint32_t ms = millis();
+  uint32_t refill = (ms - c->refill_ms) * JSON_SRV_RATE_LIMIT / 1000;
+
+  if (refill > 0) {
+    c->tokens    = c->tokens + refill > JSON_SRV_RATE_LIMIT ?
+                   JSON_SRV_RATE_LIMIT : c->tokens + refill;
+    c->refill_ms = ms;
+  }
 
-          RF_setup();
-          Traffic_setup();
+  if (c->tokens == 0) {
+    c->limited++;
+    RPi_Server.limited++;
+    return;
+  }
+  c->tokens--;
+#endif /* JSON_SRV_RATE_LIMIT */
+
+  rpi_slice_t *s = &RPi_Server.queue[RPi_Server.head++ % RPI_SERVER_QUEUE];
+
+  s->conn   = c;
+  s->offset = from;
+  s->len    = to - from;
+  c->pinned++;
+  RPi_Server.messages++;
+}
+
+/* frame what is buffered, false when the queue is full */
+static bool RPi_Server_Frame(rpi_conn_t *c)
+{
+  while (c->scan < c->len) {
+    if (RPi_Server.head - RPi_Server.tail >= RPI_SERVER_QUEUE) {
+      RPi_Server.stalls++;
+      return false;
+    }
+
+    char ch = c->buf[c->scan++];
+
+    if (c->depth > 0) {
+      if (c->quoted) {
+        if (c->escape) {
+          c->escape = false;
+        } else if (ch == '\\') {
+          c->escape = true;
+        } else if (ch == '"') {
+          c->quoted = false;
         }
+      } else if (ch == '"') {
+        c->quoted = true;
+      } else if (ch == '{') {
+        c->depth++;
+      } else if (ch == '}' && --c->depth == 0) {
+        RPi_Server_Message(c, c->start, c->scan);
       }
+    } else if (ch == '{') {
+      /* text in front of an object is not a message of its own */
+      c->start = c->scan - 1;
+      c->depth = 1;
+    } else if (ch == '\n') {
+      RPi_Server_Message(c, c->start, c->scan - 1);
+    }
+  }
 
-      if (root.containsKey("now") &&
-          root.containsKey("messages") &&
-          root.containsKey("aircraft")) {
-        /* 'aircraft.json' output from 'dump1090' application */
-        parseD1090(root);
-      } else if (root.containsKey("aircraft")) {
-        /* uAvionix PingStation */
-        parsePING(root);
+  return true;
+}
+
+static void RPi_Server_Read(rpi_conn_t *c)
+{
+  while (!c->closing && RPi_Server_Frame(c)) {
+    /* one octet is kept spare for the NUL behind the last message */
+    if (c->len >= RPI_SERVER_BUFSIZE - 1) {
+      if (c->start == 0 && c->pinned == 0) {
+        RPi_Server.overflows++;
+        c->closing = true;
       }
+      break;
+    }
 
-      jsonBuffer.clear();
+    ssize_t n = read(c->fd, c->buf + c->len, RPI_SERVER_BUFSIZE - 1 - c->len);
+
+    if (n > 0) {
+      c->len += n;
+    } else {
+      if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+        /* a last line may come without a line break, the spare octet takes one */
+        if (c->depth == 0) {
+          c->buf[c->len++] = '\n';
+        }
+        c->closing = true;
+      }
+      break;
+    }
+  }
+}
+
+static void RPi_Server_setup(uint16_t port)
+{
+  struct sockaddr_in addr;
+  struct epoll_event ev;
+  int one = 1;
+
+  for (int i = 0; i < JSON_SRV_MAX_CLIENTS; i++) {
+    RPi_Server.conn[i].fd = -1;
+  }
+
+  RPi_Server.listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  RPi_Server.epoll_fd  = epoll_create1(EPOLL_CLOEXEC);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port        = htons(port);
+
+  ev.events   = EPOLLIN;
+  ev.data.u32 = RPI_SERVER_LISTEN;
+
+  if (RPi_Server.listen_fd < 0 || RPi_Server.epoll_fd < 0 ||
+      setsockopt(RPi_Server.listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+      bind(RPi_Server.listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+      listen(RPi_Server.listen_fd, JSON_SRV_MAX_CLIENTS) < 0 ||
+      epoll_ctl(RPi_Server.epoll_fd, EPOLL_CTL_ADD, RPi_Server.listen_fd, &ev) < 0) {
+    perror("traffic TCP server");
+    exit(EXIT_FAILURE);
+  }
+}
+
+#if defined(USE_D1090_FEED)
+/*
+ * Client of the dump1090 Beast (or AVR) output, D1090_FEED_HOST.
+ * The connection is in the epoll set of the traffic server and is served
+ * by the thread which polls it. Frames are decoded as they come in, a
+ * target goes to the traffic table with every position message.
+ * A lost connection is made again after D1090_FEED_RETRY_MS.
+ */
+#include <arpa/inet.h>
+
+#define RPI_FEED_READS        16 /* per event, not to starve the clients */
+
+static struct {
+  int              fd;
+  uint32_t         retry_ms;
+  uint32_t         connects;
+  bool             fix;     /* own position, set by the polling thread */
+  float            latitude;
+  float            longitude;
+  d1090_traffic_t  sink;
+  d1090_feed_t     feed;    /* counters are those of the last connection */
+} RPi_Feed = { -1 };
+
+static void RPi_Feed_Close()
+{
+  epoll_ctl(RPi_Server.epoll_fd, EPOLL_CTL_DEL, RPi_Feed.fd, NULL);
+  close(RPi_Feed.fd);
+  RPi_Feed.fd       = -1;
+  RPi_Feed.retry_ms = millis() + D1090_FEED_RETRY_MS;
+}
+
+/* non-blocking, a refused connection turns up as a failed read */
+static void RPi_Feed_Connect()
+{
+  struct sockaddr_in addr;
+  struct epoll_event ev;
+
+  if (RPi_Feed.fd >= 0 || (int32_t) (millis() - RPi_Feed.retry_ms) < 0) {
+    return;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port   = htons(D1090_FEED_PORT);
+  inet_pton(AF_INET, D1090_FEED_HOST, &addr.sin_addr);
+
+  ev.events   = EPOLLIN;
+  ev.data.u32 = RPI_SERVER_FEED;
+
+  RPi_Feed.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+  if (RPi_Feed.fd < 0) {
+    RPi_Feed.retry_ms = millis() + D1090_FEED_RETRY_MS;
+    return;
+  }
+
+  if ((connect(RPi_Feed.fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 &&
+       errno != EINPROGRESS) ||
+      epoll_ctl(RPi_Server.epoll_fd, EPOLL_CTL_ADD, RPi_Feed.fd, &ev) < 0) {
+    RPi_Feed_Close();
+    return;
+  }
+
+  D1090_Feed_init(&RPi_Feed.feed, D1090_FEED_FORMAT);
+  RPi_Feed.connects++;
+}
 
-      if ((time(NULL) - now()) > 3) {
-        hasValidGPSDFix = false;
+/* own position and where the targets go, ahead of RPi_Server_Poll() */
+static void RPi_Feed_Origin(bool fix, float lat, float lon, d1090_traffic_t sink)
+{
+  RPi_Feed.fix       = fix;
+  RPi_Feed.latitude  = lat;
+  RPi_Feed.longitude = lon;
+  RPi_Feed.sink      = sink;
+
+  RPi_Feed_Connect();
+}
+
+static void RPi_Feed_Read()
+{
+  d1090_feed_t *feed = &RPi_Feed.feed;
+  uint8_t buf[4096];
+
+  feed->ms        = millis();
+  feed->fix       = RPi_Feed.fix;
+  feed->latitude  = RPi_Feed.latitude;
+  feed->longitude = RPi_Feed.longitude;
+  feed->range     = JSON_D1090_RANGE;
+  feed->sink      = RPi_Feed.fix ? RPi_Feed.sink : NULL;
+
+  for (int i = 0; i < RPI_FEED_READS; i++) {
+    ssize_t n = read(RPi_Feed.fd, buf, sizeof(buf));
+
+    if (n > 0) {
+      D1090_Feed(feed, buf, n);
+    } else {
+      if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+        RPi_Feed_Close();
+      }
+      break;
+    }
+  }
+}
+
+/* server poll has to wake up for the next attempt */
+#define RPi_Feed_Timeout(t)  (RPi_Feed.fd < 0 ? D1090_FEED_RETRY_MS : (t))
+#else
+#define RPi_Feed_Origin(fix, lat, lon, sink) {}
+#define RPi_Feed_Timeout(t)  (t)
+#endif /* USE_D1090_FEED */
+
+/*
+ * Wait up to 'timeout' ms (-1 - for ever) for traffic connections,
+ * then hand every complete message to 'handler'.
+ */
+static void RPi_Server_Poll(int timeout, rpi_message_t handler)
+{
+  struct epoll_event events[RPI_SERVER_EVENTS];
+  bool more;
+
+  int n = epoll_wait(RPi_Server.epoll_fd, events, RPI_SERVER_EVENTS, timeout);
+
+  for (int i = 0; i < n; i++) {
+    if (events[i].data.u32 == RPI_SERVER_LISTEN) {
+      RPi_Server_Accept();
+#if defined(USE_D1090_FEED)
+    } else if (events[i].data.u32 == RPI_SERVER_FEED) {
+      RPi_Feed_Read();
+#endif /* USE_D1090_FEED */
+    } else {
+      RPi_Server_Read(&RPi_Server.conn[events[i].data.u32]);
+    }
+  }
+
+  do {
+    while (RPi_Server.tail != RPi_Server.head) {
+      rpi_slice_t *s = &RPi_Server.queue[RPi_Server.tail % RPI_SERVER_QUEUE];
+      char *msg  = s->conn->buf + s->offset;
+      char  next = msg[s->len];
+
+      msg[s->len] = '\0';
+      (*handler)(msg, s->len);
+      msg[s->len] = next;
+
+      s->conn->pinned--;
+      RPi_Server.tail++;
+    }
+
+    more = false;
+
+    for (int i = 0; i < JSON_SRV_MAX_CLIENTS; i++) {
+      rpi_conn_t *c = &RPi_Server.conn[i];
+
+      if (c->fd < 0) {
+        continue;
+      }
+
+      /* framing held back by a full queue, or the last line before EOF */
+      if (c->scan < c->len && !RPi_Server_Frame(c)) {
+        more = true;
+        continue;
       }
+
+      if (c->pinned > 0) {
+        continue;
+      }
+
+      if (c->closing) {
+        RPi_Server_Close(c);
+      } else if (c->start > 0) {
+        memmove(c->buf, c->buf + c->start, c->len - c->start);
+        c->len  -= c->start;
+        c->scan -= c->start;
+        c->start = 0;
+      }
+    }
+  } while (more || RPi_Server.tail != RPi_Server.head);
+}
+
+static void RPi_Server_fini()
+{
+#if defined(USE_D1090_FEED)
+  if (RPi_Feed.fd >= 0) {
+    RPi_Feed_Close();
+  }
+#endif /* USE_D1090_FEED */
+
+  for (int i = 0; i < JSON_SRV_MAX_CLIENTS; i++) {
+    if (RPi_Server.conn[i].fd >= 0) {
+      RPi_Server_Close(&RPi_Server.conn[i]);
+    }
+  }
+
+  if (RPi_Server.listen_fd >= 0) {
+    close(RPi_Server.listen_fd);
+    RPi_Server.listen_fd = -1;
+  }
+}
+
+#if !defined(USE_RX_PIPELINE)
+/* rpi_message_t of the main thread, JSON is parsed in place */
+static void RPi_Traffic_Message(char *str, int len)
+{
+  if (str[0] == '{' &&
+      parseD1090_Stream(str, len,
+                        ThisAircraft.latitude, ThisAircraft.longitude,
+                        JSON_D1090_RANGE,
+                        isValidFix() ? JSON_Traffic_Store : NULL)) {
+    /* 'aircraft.json' output from 'dump1090' application, no DOM needed */
+  } else if (str[0] == '{') {
+    // JSON input
+
+    JsonObject& root = jsonBuffer.parseObject(str);
+
+    JsonVariant msg_class = root["class"];
+
+    if (msg_class.success()) {
+      const char *msg_class_s = msg_class.as<char*>();
+
+      if (!strcmp(msg_class_s,"SOFTRF")) {
+        parseSettings(root);
+
+        RF_setup();
+        Traffic_setup();
+      }
+    }
+
+    if (root.containsKey("now") &&
+        root.containsKey("messages") &&
+        root.containsKey("aircraft")) {
+      /* 'aircraft.json' output from 'dump1090' application */
+      if (isValidFix()) {
+        parseD1090(root, JSON_Traffic_Store);
+      }
+    } else if (root.containsKey("aircraft")) {
+      /* uAvionix PingStation */
+      if (isValidFix()) {
+        parsePING(root, JSON_Traffic_Store);
+      }
+    }
+
+    JsonVariant rawdata = root["rawdata"];
+    if (rawdata.success()) {
+      parseRAW(root, JSON_Traffic_Store);
+    }
+
+    jsonBuffer.clear();
+  } else if (str[0] == 'q') {
+    if (len >= 4 && str[1] == 'u' && str[2] == 'i' && str[3] == 't') {
+      RPi_Server_fini();
+      fprintf( stderr, "Program termination.\n" );
+      exit(EXIT_SUCCESS);
     }
   }
 }
 
 static void RPi_ReadTraffic()
 {
-  string traffic_input = Traffic_TCP_Server.getMessage();
-  if (traffic_input != "") {
-    const char *str = traffic_input.c_str();
-    int len = traffic_input.length();
+  RPi_Feed_Origin(isValidFix(), ThisAircraft.latitude, ThisAircraft.longitude,
+                  JSON_Traffic_Store);
+  RPi_Server_Poll(0, RPi_Traffic_Message);
+}
+#endif /* USE_RX_PIPELINE */
 
-    if (str[0] == '{') {
-      // JSON input
+#if defined(USE_EPOLL_LOOP) || defined(USE_LOOP_STATS) || defined(USE_RX_PIPELINE)
+#include <errno.h>
+#include <time.h>
+#include <linux/gpio.h>
 
-//    cout << "Traffic message:" << traffic_input << endl;
+#define RPI_GPIO_CHIP         "/dev/gpiochip0"
 
-      JsonObject& root = jsonBuffer.parseObject(str);
+static int      RPi_DIO0_fd = -1;
+static uint64_t RPi_DIO0_ns = 0; /* rising edge of the last radio IRQ */
 
-      JsonVariant msg_class = root["class"];
+static uint64_t RPi_Monotonic_ns()
+{
+  struct timespec ts;
 
-      if (msg_class.success()) {
-        const char *msg_class_s = msg_class.as<char*>();
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 
-        if (!strcmp(msg_class_s,"SOFTRF")) {
-          parseSettings(root);
+/*
+ * SX127x DIO0 edges through the GPIO character device.
+ * BCM pin numbers are line offsets of gpiochip0. The pin stays
+ * an input, so this does not get in the way of the bcm2835 library.
+ */
+static int RPi_DIO0_open()
+{
+  struct gpioevent_request req;
+  int fd = open(RPI_GPIO_CHIP, O_RDONLY);
 
-          RF_setup();
-          Traffic_setup();
-        }
+  if (fd < 0) {
+    return -1;
+  }
+
+  memset(&req, 0, sizeof(req));
+  req.lineoffset  = SOC_GPIO_PIN_DIO0;
+  req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+  req.eventflags  = GPIOEVENT_REQUEST_RISING_EDGE;
+  strncpy(req.consumer_label, "SoftRF DIO0", sizeof(req.consumer_label) - 1);
+
+  int rval = ioctl(fd, GPIO_GET_LINEEVENT_IOCTL, &req);
+  close(fd);
+
+  if (rval < 0) {
+    return -1;
+  }
+
+  fcntl(req.fd, F_SETFL, fcntl(req.fd, F_GETFL) | O_NONBLOCK);
+
+  return req.fd;
+}
+
+/* event timestamps are CLOCK_MONOTONIC since Linux 5.7 */
+static void RPi_DIO0_Drain()
+{
+  struct gpioevent_data event;
+
+  while (RPi_DIO0_fd >= 0 &&
+         read(RPi_DIO0_fd, &event, sizeof(event)) == sizeof(event)) {
+    RPi_DIO0_ns = event.timestamp;
+  }
+}
+#endif /* USE_EPOLL_LOOP || USE_LOOP_STATS || USE_RX_PIPELINE */
+
+#if defined(USE_LOOP_STATS)
+#include <sys/resource.h>
+
+#define RPI_STATS_PERIOD_MS   60000
+
+#if defined(USE_RX_PIPELINE)
+static void RPi_Pipeline_Report(void);
+#endif /* USE_RX_PIPELINE */
+
+/*
+ * Main loop counters, to compare the event loop with the polling one.
+ * RX to export latency runs from the DIO0 edge of a packet (or from
+ * RF_Receive() when DIO0 is not available) to the end of the export
+ * tick that follows it.
+ */
+static struct {
+  uint32_t passes;
+  uint32_t wakeups;
+  uint32_t packets;
+  bool     pending;
+  uint64_t rx_ns;
+  uint64_t lat_sum_ns;
+  uint64_t lat_max_ns;
+  uint32_t lat_count;
+  uint64_t since_ns;
+  struct timeval cpu;
+} RPi_Stats;
+
+static void RPi_Stats_RX()
+{
+  RPi_DIO0_Drain();
+
+  RPi_Stats.packets++;
+  if (!RPi_Stats.pending) {
+    RPi_Stats.rx_ns   = RPi_DIO0_fd >= 0 ? RPi_DIO0_ns : RPi_Monotonic_ns();
+    RPi_Stats.pending = true;
+  }
+}
+
+static void RPi_Stats_Export()
+{
+  if (RPi_Stats.pending) {
+    uint64_t lat = RPi_Monotonic_ns() - RPi_Stats.rx_ns;
+
+    RPi_Stats.lat_sum_ns += lat;
+    if (lat > RPi_Stats.lat_max_ns) {
+      RPi_Stats.lat_max_ns = lat;
+    }
+    RPi_Stats.lat_count++;
+    RPi_Stats.pending = false;
+  }
+}
+
+static void RPi_Stats_Report()
+{
+  uint64_t ns = RPi_Monotonic_ns();
+  struct rusage ru;
+
+  RPi_Stats.passes++;
+
+  if (RPi_Stats.since_ns == 0) {
+    getrusage(RUSAGE_SELF, &ru);
+    timeradd(&ru.ru_utime, &ru.ru_stime, &RPi_Stats.cpu);
+    RPi_Stats.since_ns = ns;
+    return;
+  }
+
+  if (ns - RPi_Stats.since_ns < RPI_STATS_PERIOD_MS * 1000000ULL) {
+    return;
+  }
+
+  struct timeval cpu, used;
+  float secs = (ns - RPi_Stats.since_ns) / 1e9;
+
+  getrusage(RUSAGE_SELF, &ru);
+  timeradd(&ru.ru_utime, &ru.ru_stime, &cpu);
+  timersub(&cpu, &RPi_Stats.cpu, &used);
+
+  fprintf(stderr, "loop: %.1f passes/s %.1f wakeups/s CPU %.1f%% "
+                  "RX %u pkts, RX to export %.1f ms avg %.1f ms max\n",
+          RPi_Stats.passes / secs, RPi_Stats.wakeups / secs,
+          (used.tv_sec + used.tv_usec / 1e6) * 100 / secs,
+          RPi_Stats.packets,
+          RPi_Stats.lat_count ?
+            RPi_Stats.lat_sum_ns / 1e6 / RPi_Stats.lat_count : 0.0,
+          RPi_Stats.lat_max_ns / 1e6);
+
+  fprintf(stderr, "  server: %u accepted, %u rejected, %u msgs, "
+                  "%u rate limited, %u overflows, %u stalls\n",
+          RPi_Server.accepted, RPi_Server.rejected, RPi_Server.messages,
+          RPi_Server.limited, RPi_Server.overflows, RPi_Server.stalls);
+
+#if defined(USE_D1090_FEED)
+  fprintf(stderr, "  feed: %u connects, last one %u frames, %u CRC errors, "
+                  "%u positions, %u targets\n",
+          RPi_Feed.connects, RPi_Feed.feed.frames, RPi_Feed.feed.crc_errors,
+          RPi_Feed.feed.positions, RPi_Feed.feed.targets);
+#endif /* USE_D1090_FEED */
+
+#if defined(USE_RX_PIPELINE)
+  RPi_Pipeline_Report();
+#endif /* USE_RX_PIPELINE */
+
+  memset(&RPi_Stats, 0, sizeof(RPi_Stats));
+  RPi_Stats.cpu      = cpu;
+  RPi_Stats.since_ns = ns;
+}
+#else
+#define RPi_Stats_RX()        {}
+#define RPi_Stats_Export()    {}
+#define RPi_Stats_Report()    {}
+#endif /* USE_LOOP_STATS */
+
+#if defined(USE_EPOLL_LOOP)
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+/*
+ * Event driven main loop.
+ *
+ * One pass of the mode loop runs on every wake up. The process sleeps in
+ * epoll_wait() until stdin data, a DIO0 edge of the radio, a signal or
+ * the timer. The timer is armed for the earliest of the next export tick,
+ * the next TX slot and a service period. The service period covers
+ * frequency hopping and the display. Traffic TCP connections wake the
+ * loop up too, unless the ingest thread of USE_RX_PIPELINE serves them.
+ * It is shorter when DIO0 is not available, because then the radio
+ * has to be polled over SPI.
+ */
+#define RPI_LOOP_SERVICE_MS   20
+#define RPI_LOOP_POLL_MS      5
+#define RPI_LOOP_MAX_EVENTS   4
+
+enum
+{
+  RPI_EVENT_STDIN,
+  RPI_EVENT_RADIO,
+  RPI_EVENT_TIMER,
+  RPI_EVENT_WAKEUP,
+  RPI_EVENT_TRAFFIC
+};
+
+static int RPi_Loop_fd   = -1;
+static int RPi_Timer_fd  = -1;
+static int RPi_Wakeup_fd = -1;
+static volatile sig_atomic_t RPi_Loop_Stop = 0;
+
+/* async signal safe, may be called by any thread */
+static void RPi_Loop_Wakeup()
+{
+  uint64_t one = 1;
+
+  if (write(RPi_Wakeup_fd, &one, sizeof(one)) < 0) {
+    /* the loop is already awake */
+  }
+}
+
+static void RPi_Loop_Signal(int sig)
+{
+  RPi_Loop_Stop = sig;
+  RPi_Loop_Wakeup();
+}
+
+static bool RPi_Loop_Add(int fd, int id, uint32_t events)
+{
+  struct epoll_event ev;
+
+  ev.events   = events;
+  ev.data.u32 = id;
+
+  return epoll_ctl(RPi_Loop_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+static void RPi_Loop_setup()
+{
+  RPi_Loop_fd   = epoll_create1(EPOLL_CLOEXEC);
+  RPi_Timer_fd  = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  RPi_Wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  if (RPi_Loop_fd < 0 || RPi_Timer_fd < 0 || RPi_Wakeup_fd < 0) {
+    perror("event loop");
+    exit(EXIT_FAILURE);
+  }
+
+  RPi_Loop_Add(RPi_Timer_fd,  RPI_EVENT_TIMER,  EPOLLIN);
+  RPi_Loop_Add(RPi_Wakeup_fd, RPI_EVENT_WAKEUP, EPOLLIN);
+#if !defined(USE_RX_PIPELINE)
+  RPi_Loop_Add(RPi_Server.epoll_fd, RPI_EVENT_TRAFFIC, EPOLLIN);
+#endif /* USE_RX_PIPELINE */
+
+  /*
+   * Edge triggered: the mode loop drains stdin until EAGAIN.
+   * epoll refuses regular files (stdin redirected from a file);
+   * such input is always ready and is read on every pass.
+   */
+  if (!RPi_Loop_Add(STDIN_FILENO, RPI_EVENT_STDIN, EPOLLIN | EPOLLET) &&
+      errno != EPERM) {
+    perror("epoll stdin");
+  }
+
+  RPi_DIO0_fd = RPi_DIO0_open();
+  if (RPi_DIO0_fd < 0 || !RPi_Loop_Add(RPi_DIO0_fd, RPI_EVENT_RADIO, EPOLLIN)) {
+    fprintf(stderr, "DIO0 IRQ is not available, radio is polled every %d ms\n",
+            RPI_LOOP_POLL_MS);
+  }
+
+  signal(SIGINT,  RPi_Loop_Signal);
+  signal(SIGTERM, RPi_Loop_Signal);
+}
+
+static uint32_t RPi_Loop_Timeout()
+{
+  unsigned long ms = millis();
+  uint32_t wait = RPi_DIO0_fd < 0 ? RPI_LOOP_POLL_MS : RPI_LOOP_SERVICE_MS;
+
+  /* relay mode does not export */
+  if (settings->mode != SOFTRF_MODE_RELAY) {
+    uint32_t tick = Traffic_Export_Wait();
+    if (tick < wait) {
+      wait = tick;
+    }
+  }
+
+  /* RF_Transmit() fires once millis() is past the marker */
+  if (TxTimeMarker >= ms && TxTimeMarker - ms + 1 < wait) {
+    wait = TxTimeMarker - ms + 1;
+  }
+
+  return wait;
+}
+
+static void RPi_Loop_Sleep()
+{
+  struct epoll_event events[RPI_LOOP_MAX_EVENTS];
+  struct itimerspec its;
+  uint64_t count;
+  uint32_t wait = RPi_Loop_Timeout();
+  int n;
+
+  if (wait > 0) {
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec  = wait / 1000;
+    its.it_value.tv_nsec = (wait % 1000) * 1000000L;
+    timerfd_settime(RPi_Timer_fd, 0, &its, NULL);
+  }
+
+  do {
+    n = epoll_wait(RPi_Loop_fd, events, RPI_LOOP_MAX_EVENTS, wait > 0 ? -1 : 0);
+  } while (n < 0 && errno == EINTR && !RPi_Loop_Stop);
+
+  for (int i = 0; i < n; i++) {
+    switch (events[i].data.u32)
+    {
+    case RPI_EVENT_RADIO:
+      RPi_DIO0_Drain();
+      break;
+    case RPI_EVENT_TIMER:
+      if (read(RPi_Timer_fd, &count, sizeof(count)) < 0) { /* EAGAIN */ }
+      break;
+    case RPI_EVENT_WAKEUP:
+      if (read(RPi_Wakeup_fd, &count, sizeof(count)) < 0) { /* EAGAIN */ }
+      break;
+    case RPI_EVENT_STDIN:
+    case RPI_EVENT_TRAFFIC:
+    default:
+      break;
+    }
+  }
+
+#if defined(USE_LOOP_STATS)
+  RPi_Stats.wakeups++;
+#endif /* USE_LOOP_STATS */
+
+  if (RPi_Loop_Stop) {
+    shutdown(SOFTRF_SHUTDOWN_DEFAULT);
+  }
+}
+#else
+#define RPi_Loop_Wakeup()     {}
+#endif /* USE_EPOLL_LOOP */
+
+#if defined(USE_RX_PIPELINE)
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+/*
+ * Receive pipeline.
+ *
+ * The main thread drives the radio (LMIC is not thread safe), owns the
+ * traffic table and runs the exporters. Two threads work next to it:
+ *  - the decode worker runs protocol_decode() on the received frames;
+ *  - the ingest thread serves the traffic TCP connections and parses
+ *    their JSON messages (dump1090, PingStation, raw data), a large
+ *    aircraft.json no longer holds up RX and alarms.
+ * Every hand-over is a bounded single producer, single consumer ring.
+ * The producer fills a slot in place and the consumer works on it in
+ * place. Only the main thread touches the table, so it takes no lock.
+ */
+#define RPI_FRAME_QUEUE_SIZE    16  /* main -> decode worker */
+#define RPI_DECODE_QUEUE_SIZE   16  /* decode worker -> main */
+#define RPI_INGEST_QUEUE_SIZE   512 /* ingest -> main, a busy aircraft.json at once */
+#define RPI_QUEUE_WAIT_US       1000
+
+typedef struct {
+  uint8_t  *slots;
+  size_t    size;       /* of a slot, it starts with the enqueue time */
+  uint32_t  mask;       /* number of slots - 1 */
+  uint32_t  head __attribute__ ((aligned (64))); /* producer */
+  uint32_t  full;       /* producer found no free slot */
+  uint32_t  peak;       /* depth */
+  uint32_t  tail __attribute__ ((aligned (64))); /* consumer */
+  uint32_t  count;
+  uint64_t  lat_sum_ns; /* from enqueue to pop */
+  uint64_t  lat_max_ns;
+} rpi_queue_t;
+
+enum
+{
+  RPI_TARGET_UFO,
+  RPI_TARGET_RAW,
+  RPI_TARGET_SETTINGS,
+  RPI_TARGET_QUIT
+};
+
+typedef struct {
+  uint64_t  ns;                         /* time of reception */
+  bool    (*decode)(void *, ufo_t *, ufo_t *);
+  int8_t    rssi;
+  ufo_t     own;                        /* ThisAircraft at reception */
+  uint8_t   frame[MAX_PKT_SIZE];
+} rpi_frame_t;
+
+typedef struct {
+  uint64_t  ns;                         /* time of reception */
+  uint8_t   type;
+  uint8_t   raw_size;
+  char     *text;                       /* RPI_TARGET_SETTINGS, malloc()ed */
+  ufo_t     fo;
+  uint8_t   raw[RAW_DATA_SIZE];
+} rpi_target_t;
+
+#define RPI_QUEUE(name, type, n) \
+  static type name##_slots[n]; \
+  static rpi_queue_t name = { (uint8_t *) name##_slots, sizeof(type), (n) - 1 }
+
+RPI_QUEUE(RPi_Frame_Queue,  rpi_frame_t,  RPI_FRAME_QUEUE_SIZE);
+RPI_QUEUE(RPi_Decode_Queue, rpi_target_t, RPI_DECODE_QUEUE_SIZE);
+RPI_QUEUE(RPi_Ingest_Queue, rpi_target_t, RPI_INGEST_QUEUE_SIZE);
+
+static int  RPi_Frame_fd   = -1; /* wakes the decode worker up */
+static bool RPi_Fix_Valid  = false;
+static float RPi_Fix_Lat   = 0; /* own position, for the range filter of ingest */
+static float RPi_Fix_Lon   = 0;
+static StaticJsonBuffer<JSON_BUFFER_SIZE> RPi_Ingest_Buffer;
+
+/* producer: free slot to fill, or NULL when the ring is full */
+static void *RPi_Queue_Slot(rpi_queue_t *q)
+{
+  uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+
+  if (q->head - tail > q->mask) {
+    q->full++;
+    return NULL;
+  }
+
+  return q->slots + (q->head & q->mask) * q->size;
+}
+
+static void RPi_Queue_Push(rpi_queue_t *q)
+{
+  uint32_t head  = q->head + 1;
+  uint32_t depth = head - __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+
+  if (depth > q->peak) {
+    q->peak = depth;
+  }
+
+  __atomic_store_n(&q->head, head, __ATOMIC_RELEASE);
+}
+
+/* consumer: oldest slot, or NULL when the ring is empty */
+static void *RPi_Queue_Peek(rpi_queue_t *q)
+{
+  if (__atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == q->tail) {
+    return NULL;
+  }
+
+  return q->slots + (q->tail & q->mask) * q->size;
+}
+
+static void RPi_Queue_Pop(rpi_queue_t *q)
+{
+  uint64_t lat = RPi_Monotonic_ns() -
+                 *(uint64_t *) (q->slots + (q->tail & q->mask) * q->size);
+
+  q->count++;
+  q->lat_sum_ns += lat;
+  if (lat > q->lat_max_ns) {
+    q->lat_max_ns = lat;
+  }
+
+  __atomic_store_n(&q->tail, q->tail + 1, __ATOMIC_RELEASE);
+}
+
+/* producers off the main thread wait for room rather than drop */
+static void *RPi_Queue_Wait(rpi_queue_t *q)
+{
+  void *slot;
+
+  while ((slot = RPi_Queue_Slot(q)) == NULL) {
+    RPi_Loop_Wakeup();
+    usleep(RPI_QUEUE_WAIT_US);
+  }
+
+  return slot;
+}
+
+/* RX stage, main thread: hand a received frame to the decode worker */
+static void RPi_Decode_Push()
+{
+  uint64_t one = 1;
+
+  if (!ParseData_Accept() || protocol_decode == NULL) {
+    return;
+  }
+
+  rpi_frame_t *f = (rpi_frame_t *) RPi_Queue_Slot(&RPi_Frame_Queue);
+
+  /* the radio does not wait, the frame is dropped and counted */
+  if (f == NULL) {
+    return;
+  }
+
+  f->ns     = RPi_Monotonic_ns();
+  f->decode = protocol_decode;
+  f->rssi   = RF_last_rssi;
+  f->own    = ThisAircraft;
+  memcpy(f->frame, RxBuffer, sizeof(f->frame));
+
+  RPi_Queue_Push(&RPi_Frame_Queue);
+
+  if (write(RPi_Frame_fd, &one, sizeof(one)) < 0) {
+    /* the worker is already awake */
+  }
+}
+
+static void *RPi_Decode_loop(void *arg)
+{
+  rpi_frame_t  *f;
+  rpi_target_t *t;
+  uint64_t      count;
+
+  pthread_detach(pthread_self());
+
+  while (true) {
+    if (read(RPi_Frame_fd, &count, sizeof(count)) < 0 && errno != EINTR) {
+      perror("decode worker");
+      break;
+    }
+
+    while ((f = (rpi_frame_t *) RPi_Queue_Peek(&RPi_Frame_Queue)) != NULL) {
+      ufo_t fo = EmptyFO;
+
+      if ((*f->decode)((void *) f->frame, &f->own, &fo)) {
+        fo.rssi = f->rssi;
+
+        t = (rpi_target_t *) RPi_Queue_Wait(&RPi_Decode_Queue);
+        t->ns   = f->ns;
+        t->type = RPI_TARGET_UFO;
+        t->fo   = fo;
+        RPi_Queue_Push(&RPi_Decode_Queue);
+
+        RPi_Loop_Wakeup();
       }
 
-      if (root.containsKey("now") &&
-          root.containsKey("messages") &&
-          root.containsKey("aircraft")) {
-        /* 'aircraft.json' output from 'dump1090' application */
-        if (isValidFix()) {
-          parseD1090(root);
-        }
-      } else if (root.containsKey("aircraft")) {
-        /* uAvionix PingStation */
-        if (isValidFix()) {
-          parsePING(root);
+      RPi_Queue_Pop(&RPi_Frame_Queue);
+    }
+  }
+
+  return NULL;
+}
+
+/* json_traffic_t of the ingest thread */
+static void RPi_Ingest_Target(ufo_t *fop, const uint8_t *raw, size_t size)
+{
+  rpi_target_t *t = (rpi_target_t *) RPi_Queue_Wait(&RPi_Ingest_Queue);
+
+  t->ns   = RPi_Monotonic_ns();
+  t->type = raw ? RPI_TARGET_RAW : RPI_TARGET_UFO;
+  t->fo   = *fop;
+  if (raw) {
+    t->raw_size = size > sizeof(t->raw) ? sizeof(t->raw) : size;
+    memcpy(t->raw, raw, t->raw_size);
+  }
+
+  RPi_Queue_Push(&RPi_Ingest_Queue);
+}
+
+#if defined(USE_D1090_FEED)
+/* d1090_traffic_t of the ingest thread, every Mode-S target is let in at once */
+static void RPi_Feed_Target(ufo_t *fop, const uint8_t *raw, size_t size)
+{
+  RPi_Ingest_Target(fop, raw, size);
+  RPi_Loop_Wakeup();
+}
+#endif /* USE_D1090_FEED */
+
+/* settings and "quit" are carried out by the main thread, 'str' is malloc()ed */
+static void RPi_Ingest_Control(uint8_t type, char *str)
+{
+  rpi_target_t *t = (rpi_target_t *) RPi_Queue_Wait(&RPi_Ingest_Queue);
+
+  t->ns   = RPi_Monotonic_ns();
+  t->type = type;
+  t->text = (char *) str;
+
+  RPi_Queue_Push(&RPi_Ingest_Queue);
+}
+
+/* rpi_message_t of the ingest thread, JSON is parsed in place */
+static void RPi_Ingest(char *str, int len)
+{
+  bool fix = __atomic_load_n(&RPi_Fix_Valid, __ATOMIC_RELAXED);
+  float lat, lon;
+
+  /* a torn pair is a few metres off at most, good enough for the filter */
+  __atomic_load(&RPi_Fix_Lat, &lat, __ATOMIC_RELAXED);
+  __atomic_load(&RPi_Fix_Lon, &lon, __ATOMIC_RELAXED);
+
+  if (str[0] == '{' &&
+      parseD1090_Stream(str, len, lat, lon, JSON_D1090_RANGE,
+                        fix ? RPi_Ingest_Target : NULL)) {
+    /* 'aircraft.json' output from 'dump1090' application, no DOM needed */
+  } else if (str[0] == '{') {
+    // JSON input
+
+    JsonObject& root = RPi_Ingest_Buffer.parseObject(str);
+
+    JsonVariant msg_class = root["class"];
+
+    if (msg_class.success()) {
+      const char *msg_class_s = msg_class.as<char*>();
+
+      if (!strcmp(msg_class_s,"SOFTRF")) {
+        /* the in place parse has taken the message apart */
+        size_t size = root.measureLength() + 1;
+        char *text = (char *) malloc(size);
+
+        if (text) {
+          root.printTo(text, size);
+          RPi_Ingest_Control(RPI_TARGET_SETTINGS, text);
         }
       }
+    }
 
-      JsonVariant rawdata = root["rawdata"];
-      if (rawdata.success()) {
-        parseRAW(root);
+    if (root.containsKey("now") &&
+        root.containsKey("messages") &&
+        root.containsKey("aircraft")) {
+      /* 'aircraft.json' output from 'dump1090' application */
+      if (fix) {
+        parseD1090(root, RPi_Ingest_Target);
+      }
+    } else if (root.containsKey("aircraft")) {
+      /* uAvionix PingStation */
+      if (fix) {
+        parsePING(root, RPi_Ingest_Target);
       }
+    }
+
+    JsonVariant rawdata = root["rawdata"];
+    if (rawdata.success()) {
+      parseRAW(root, RPi_Ingest_Target);
+    }
+
+    RPi_Ingest_Buffer.clear();
+  } else if (str[0] == 'q') {
+    if (len >= 4 && str[1] == 'u' && str[2] == 'i' && str[3] == 't') {
+      RPi_Ingest_Control(RPI_TARGET_QUIT, NULL);
+    }
+  }
+
+  RPi_Loop_Wakeup();
+}
+
+static void *RPi_Ingest_loop(void *arg)
+{
+  pthread_detach(pthread_self());
+
+  while (true) {
+#if defined(USE_D1090_FEED)
+    float lat, lon;
+
+    __atomic_load(&RPi_Fix_Lat, &lat, __ATOMIC_RELAXED);
+    __atomic_load(&RPi_Fix_Lon, &lon, __ATOMIC_RELAXED);
+    RPi_Feed_Origin(__atomic_load_n(&RPi_Fix_Valid, __ATOMIC_RELAXED),
+                    lat, lon, RPi_Feed_Target);
+#endif /* USE_D1090_FEED */
+
+    RPi_Server_Poll(RPi_Feed_Timeout(-1), RPi_Ingest);
+  }
+
+  return NULL;
+}
+
+static void RPi_Target_Store(rpi_target_t *t)
+{
+  switch (t->type)
+  {
+  case RPI_TARGET_SETTINGS:
+    {
+      JsonObject& root = jsonBuffer.parseObject(t->text);
+
+      parseSettings(root);
+
+      RF_setup();
+      Traffic_setup();
 
       jsonBuffer.clear();
-    } else if (str[0] == 'q') {
-      if (len >= 4 && str[1] == 'u' && str[2] == 'i' && str[3] == 't') {
-        Traffic_TCP_Server.detach();
-        fprintf( stderr, "Program termination.\n" );
-        exit(EXIT_SUCCESS);
-      }
+      free(t->text);
     }
+    break;
+  case RPI_TARGET_QUIT:
+    RPi_Server_fini();
+    fprintf( stderr, "Program termination.\n" );
+    exit(EXIT_SUCCESS);
+    break;
+  case RPI_TARGET_RAW:
+    JSON_Traffic_Store(&t->fo, t->raw, t->raw_size);
+    break;
+  case RPI_TARGET_UFO:
+  default:
+    JSON_Traffic_Store(&t->fo, NULL, 0);
+    break;
+  }
+}
 
-    Traffic_TCP_Server.clean();
+/* traffic table stage, main thread: take in what the other stages have made */
+static void RPi_ReadTraffic()
+{
+  rpi_target_t *t;
+
+  __atomic_store(&RPi_Fix_Lat, &ThisAircraft.latitude,  __ATOMIC_RELAXED);
+  __atomic_store(&RPi_Fix_Lon, &ThisAircraft.longitude, __ATOMIC_RELAXED);
+  __atomic_store_n(&RPi_Fix_Valid, isValidFix(), __ATOMIC_RELAXED);
+
+  while ((t = (rpi_target_t *) RPi_Queue_Peek(&RPi_Decode_Queue)) != NULL) {
+    RPi_Target_Store(t);
+    RPi_Queue_Pop(&RPi_Decode_Queue);
+  }
+
+  while ((t = (rpi_target_t *) RPi_Queue_Peek(&RPi_Ingest_Queue)) != NULL) {
+    RPi_Target_Store(t);
+    RPi_Queue_Pop(&RPi_Ingest_Queue);
   }
 }
 
+static void RPi_Pipeline_setup()
+{
+  pthread_t thread;
+
+  RPi_Frame_fd = eventfd(0, EFD_CLOEXEC);
+
+  if (RPi_Frame_fd < 0 ||
+      pthread_create(&thread, NULL, RPi_Decode_loop, (void *)0) != 0 ||
+      pthread_create(&thread, NULL, RPi_Ingest_loop, (void *)0) != 0) {
+    fprintf( stderr, "RX pipeline setup Failed\n\n" );
+    exit(EXIT_FAILURE);
+  }
+}
+
+/* counters are cumulative and read without a lock, good enough for a report */
+static void RPi_Queue_Report(const char *name, rpi_queue_t *q)
+{
+  fprintf(stderr, "  %-6s: %u msgs, depth %u peak %u, %u full, "
+                  "latency %.2f ms avg %.2f ms max\n",
+          name, q->count, q->head - q->tail, q->peak, q->full,
+          q->count ? q->lat_sum_ns / 1e6 / q->count : 0.0,
+          q->lat_max_ns / 1e6);
+}
+
+static void RPi_Pipeline_Report()
+{
+  RPi_Queue_Report("frames", &RPi_Frame_Queue);
+  RPi_Queue_Report("decode", &RPi_Decode_Queue);
+  RPi_Queue_Report("ingest", &RPi_Ingest_Queue);
+}
+#else
+#define RPi_Decode_Push()     ParseData()
+#endif /* USE_RX_PIPELINE */
+
 void normal_loop()
 {
     /* Read GNSS data from standard input */
@@ -757,13 +1974,15 @@ void normal_loop()
 
     bool success = RF_Receive();
 
-    if (success && isValidFix()) ParseData();
+    if (success) RPi_Stats_RX();
+
+    if (success && isValidFix()) RPi_Decode_Push();
 
     if (isValidFix()) {
       Traffic_loop();
     }
 
-    if (isTimeToExport()) {
+    if (Traffic_Export_Tick()) {
       NMEA_Export();
 
       if (isValidFix()) {
@@ -771,7 +1990,8 @@ void normal_loop()
         D1090_Export();
         JSON_Export();
       }
-      ExportTimeMarker = millis();
+
+      RPi_Stats_Export();
     }
 
     // Handle Air Connect
@@ -796,12 +2016,13 @@ void relay_loop()
 
     for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
       size_t size = RF_Payload_Size(settings->rf_protocol);
-      size = size > sizeof(Container[i].raw) ? sizeof(Container[i].raw) : size;
+      size = size > RAW_DATA_SIZE ? RAW_DATA_SIZE : size;
+      uint8_t *raw = Traffic_Raw(&Container[i]);
 
-      if (memcmp (Container[i].raw, EmptyFO.raw, size) != 0) {
+      if (raw) {
         // Raw data
         size_t tx_size = sizeof(TxBuffer) > size ? size : sizeof(TxBuffer);
-        memcpy(TxBuffer, Container[i].raw, tx_size);
+        memcpy(TxBuffer, raw, tx_size);
 
         if (tx_size > 0) {
           /* Follow duty cycle rule */
@@ -810,7 +2031,7 @@ void relay_loop()
             String str = Bin2Hex(TxBuffer, tx_size);
             printf("%s\n", str.c_str());
 #endif
-            Container[i] = EmptyFO;
+            Traffic_Remove(&Container[i]);
           }
         }
       } else if (isValidFix() &&
@@ -835,7 +2056,7 @@ void relay_loop()
               (int) fo.vs,
               fo.aircraft_type);
 #endif
-          Container[i] = EmptyFO;
+          Traffic_Remove(&Container[i]);
         }
       }
     }
@@ -903,12 +2124,13 @@ void txrx_test_loop()
 #if DEBUG_TIMING
   export_start_ms = millis();
 #endif
-  if (isTimeToExport()) {
-    NMEA_Position();
+  if (Traffic_Export_Tick()) {
+    if (Traffic_Export_Beat()) {
+      NMEA_Position();
+    }
     NMEA_Export();
     GDL90_Export();
     D1090_Export();
-    ExportTimeMarker = millis();
   }
 #if DEBUG_TIMING
   export_end_ms = millis();
@@ -949,12 +2171,6 @@ void txrx_test_loop()
 }
 
 
-void * traffic_tcpserv_loop(void * m)
-{
-  pthread_detach(pthread_self());
-  Traffic_TCP_Server.receive();
-}
-
 int main()
 {
   // Init GPIO bcm
@@ -1003,18 +2219,25 @@ int main()
   Traffic_setup();
   NMEA_setup();
 
-  Traffic_TCP_Server.setup(JSON_SRV_TCP_PORT);
+  RPi_Server_setup(JSON_SRV_TCP_PORT);
 
-  pthread_t traffic_tcpserv_thread;
-  if ( pthread_create(&traffic_tcpserv_thread, NULL, traffic_tcpserv_loop, (void *)0) != 0) {
-    fprintf( stderr, "pthread_create(traffic_tcpserv_thread) Failed\n\n" );
-    exit(EXIT_FAILURE);
-  }
+#if defined(USE_RX_PIPELINE)
+  RPi_Pipeline_setup();
+#endif /* USE_RX_PIPELINE */
 
   SoC->post_init();
 
   SoC->WDT_setup();
 
+  /* stdin is drained with read(2) in RPi_PickGNSSFix() */
+  fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+
+#if defined(USE_EPOLL_LOOP)
+  RPi_Loop_setup();
+#elif defined(USE_LOOP_STATS)
+  RPi_DIO0_fd = RPi_DIO0_open();
+#endif
+
   while (true) {
     switch (settings->mode)
     {
@@ -1040,22 +2263,28 @@ int main()
 
       if (current_time == ((time_t)-1) ||
           localtime_r(&current_time, &timebuf) == NULL) {
-        Traffic_TCP_Server.detach();
+        RPi_Server_fini();
         fprintf(stderr, "Failure to obtain the current time.\n");
         exit(EXIT_FAILURE);
       }
 
       /* shut SoftRF down at night time only */
       if (timebuf.tm_hour >= 2 && timebuf.tm_hour <= 5) {
-        Traffic_TCP_Server.detach();
+        RPi_Server_fini();
         fprintf( stderr, "Program termination: millis() rollover prevention.\n" );
         exit(EXIT_SUCCESS);
       }
     }
 #endif /* TAKE_CARE_OF_MILLIS_ROLLOVER */
+
+    RPi_Stats_Report();
+
+#if defined(USE_EPOLL_LOOP)
+    RPi_Loop_Sleep();
+#endif /* USE_EPOLL_LOOP */
   }
 
-  Traffic_TCP_Server.detach();
+  RPi_Server_fini();
   return 0;
 }
 
@@ -1067,7 +2296,7 @@ void shutdown(int reason)
     SoC->Display_fini(reason);
   }
 
-  Traffic_TCP_Server.detach();
+  RPi_Server_fini();
   fprintf( stderr, "Program termination. Reason code: %d.\n", reason );
   exit(EXIT_SUCCESS);
 }
@@ -21,8 +21,13 @@
 #ifndef PLATFORM_RPI_H
 #define PLATFORM_RPI_H
 
-/* Maximum of tracked flying objects is now SoC-specific constant */
-#define MAX_TRACKING_OBJECTS  8
+/*
+ * Maximum of tracked flying objects is now SoC-specific constant.
+ * Ground stations may see a lot of traffic - override at build time if needed.
+ */
+#if !defined(MAX_TRACKING_OBJECTS)
+#define MAX_TRACKING_OBJECTS  256
+#endif /* MAX_TRACKING_OBJECTS */
 
 #define DEFAULT_SOFTRF_MODEL    SOFTRF_MODEL_RASPBERRY
 
@@ -98,6 +103,13 @@ struct rst_info {
 #else
 #define JSON_SRV_TCP_PORT     30007
 #endif
+#define JSON_SRV_MAX_CLIENTS  8
+#define JSON_SRV_RATE_LIMIT   20 /* messages per second and client, 0 - no limit */
+
+#define D1090_FEED_HOST       "127.0.0.1" /* dump1090, IPv4 address */
+#define D1090_FEED_PORT       30005       /* Beast output, 30002 - AVR */
+#define D1090_FEED_FORMAT     D1090_FEED_BEAST
+#define D1090_FEED_RETRY_MS   5000
 
 extern TTYSerial Serial1;
 extern TTYSerial Serial2;
@@ -115,6 +127,10 @@ extern const char *Hardware_Rev[];
 //#define USE_EPAPER
 
 #define TAKE_CARE_OF_MILLIS_ROLLOVER
+#define USE_EPOLL_LOOP
+#define USE_RX_PIPELINE
+#define USE_D1090_FEED
+//#define USE_LOOP_STATS
 
 //#define EXCLUDE_GNSS_UBLOX
 #define EXCLUDE_GNSS_SONY
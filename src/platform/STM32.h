@@ -229,6 +229,10 @@ typedef struct stm32_backup_struct {
 //#define USE_OGN_ENCRYPTION
 #define EXCLUDE_LK8EX1
 #define EXCLUDE_IMU
+#define EXCLUDE_TRAFFIC_FUSION
+#define EXCLUDE_TRAFFIC_HISTORY
+#define EXCLUDE_TRAFFIC_SNAPSHOT
+#define EXCLUDE_TRAFFIC_SCHEDULER
 
 //#define ENFORCE_S78G
 #define USE_TIME_SLOTS
@@ -316,6 +320,10 @@ typedef struct stm32_backup_struct {
 #define EXCLUDE_SOUND
 #define EXCLUDE_LK8EX1
 #define EXCLUDE_IMU
+#define EXCLUDE_TRAFFIC_FUSION
+#define EXCLUDE_TRAFFIC_HISTORY
+#define EXCLUDE_TRAFFIC_SNAPSHOT
+#define EXCLUDE_TRAFFIC_SCHEDULER
 //#define USE_OGN_RF_DRIVER
 //#define WITH_RFM95
 //#define WITH_RFM69
@@ -394,6 +402,8 @@ typedef struct stm32_backup_struct {
 #define EXCLUDE_TEST_MODE
 #define EXCLUDE_WATCHOUT_MODE
 #define EXCLUDE_TRAFFIC_FILTER_EXTENSION
+#define EXCLUDE_TRAFFIC_HISTORY
+#define EXCLUDE_TRAFFIC_SNAPSHOT
 #define EXCLUDE_LK8EX1
 
 #define EXCLUDE_GNSS_UBLOX
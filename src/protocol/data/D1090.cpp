@@ -22,22 +22,58 @@
 #include "../../system/SoC.h"
 #include "D1090.h"
 #include "../../driver/GNSS.h"
+#include "../../driver/WiFi.h"
 #include "GDL90.h"
 #include "../../driver/EEPROM.h"
 #include "../../TrafficHelper.h"
 
-#define ADDR_TO_HEX_STR(s, c) (s += ((c) < 0x10 ? "0" : "") + String((c), HEX))
+/* "*" + hex + ";\r\n" per DF17 frame, dump1090 raw output format */
+#define D1090_FRAME_SIZE      (1 + 2 * sizeof(frame_data_t) + 3)
 
-#define DF17_FRAME_TO_HEX_STR(s)                        \
-      ({                                                \
-        for (int i=0; i < sizeof(frame_data_t); i++) {  \
-          byte c = df17.msg[i];                         \
-          s += (c < 0x10 ? "0" : "") + String(c, HEX);  \
-        }                                               \
-      })
+/*
+ * Identification frame never changes for a target,
+ * position frames change only when the target moves.
+ * Low memory targets keep one entry and rebuild everything.
+ */
+#if !defined(EXCLUDE_D1090_CACHE)
+#define D1090_CACHE_SIZE      MAX_TRACKING_OBJECTS
+#define D1090_CACHE_NDX(i)    (i)
+#else
+#define D1090_CACHE_SIZE      1
+#define D1090_CACHE_NDX(i)    0
+#endif /* EXCLUDE_D1090_CACHE */
+
+typedef struct d1090_cache_struct {
+  uint32_t      addr;
+  uint8_t       protocol;
+  uint8_t       aircraft_type;
+  bool          ident_valid;
+  bool          pos_valid;
+  float         latitude;
+  float         longitude;
+  float         altitude;
+  frame_data_t  ident;
+  frame_data_t  even;
+  frame_data_t  odd;
+} d1090_cache_t;
+
+static d1090_cache_t D1090_Cache[D1090_CACHE_SIZE];
+
+static char   D1090_Batch[D1090_BATCH_SIZE];
+static size_t D1090_Batch_Len = 0;
+
+static const char D1090_Hex[] = "0123456789ABCDEF";
+
+#if defined(D1090_TCP_SERVICE)
+WiFiServer D1090TCPServer(D1090_TCP_PORT);
+WiFiClient D1090TCP[MAX_D1090TCP_CLIENTS];
+static bool D1090TCP_active = false;
+#endif /* D1090_TCP_SERVICE */
 
 static void D1090_Out(byte *buf, size_t size)
 {
+  Traffic_Export_Out(settings->d1090, size);
+
   switch(settings->d1090)
   {
   case D1090_UART:
@@ -47,6 +83,22 @@ static void D1090_Out(byte *buf, size_t size)
       SerialOutput.write(buf, size);
     }
     break;
+  case D1090_UDP:
+    {
+      SoC->WiFi_transmit_UDP(D1090_UDP_PORT, buf, size);
+    }
+    break;
+  case D1090_TCP:
+    {
+#if defined(D1090_TCP_SERVICE)
+      for (uint8_t acc_ndx = 0; acc_ndx < MAX_D1090TCP_CLIENTS; acc_ndx++) {
+        if (D1090TCP[acc_ndx] && D1090TCP[acc_ndx].connected()) {
+          D1090TCP[acc_ndx].write(buf, size);
+        }
+      }
+#endif /* D1090_TCP_SERVICE */
+    }
+    break;
   case D1090_USB:
     {
       if (SoC->USB_ops) {
@@ -61,88 +113,761 @@ static void D1090_Out(byte *buf, size_t size)
       }
     }
     break;
-  case D1090_UDP:
-  case D1090_TCP:
   case D1090_OFF:
   default:
     break;
   }
 }
 
+static void D1090_Batch_Flush()
+{
+  if (D1090_Batch_Len > 0) {
+    D1090_Out((byte *) D1090_Batch, D1090_Batch_Len);
+    D1090_Batch_Len = 0;
+  }
+}
+
+/* append one frame as "*8D...;\r\n", the batch goes out early when it is full */
+static void D1090_Batch_Add(const frame_data_t *frame)
+{
+  if (D1090_Batch_Len + D1090_FRAME_SIZE > sizeof(D1090_Batch)) {
+    D1090_Batch_Flush();
+  }
+
+  char *ptr = D1090_Batch + D1090_Batch_Len;
+
+  *ptr++ = '*';
+  for (int i=0; i < sizeof(frame_data_t); i++) {
+    byte c = frame->msg[i];
+    *ptr++ = D1090_Hex[c >> 4];
+    *ptr++ = D1090_Hex[c & 0xF];
+  }
+  *ptr++ = ';';
+  *ptr++ = '\r';
+  *ptr++ = '\n';
+
+  D1090_Batch_Len = ptr - D1090_Batch;
+}
+
+#if defined(D1090_TCP_SERVICE)
+static void D1090_TCP_Accept()
+{
+  uint8_t i;
+
+  if (!D1090TCP_active) {
+    D1090TCPServer.begin();
+    Serial.print(F("D1090 TCP server has started at port: "));
+    Serial.println(D1090_TCP_PORT);
+
+    D1090TCPServer.setNoDelay(true);
+    D1090TCP_active = true;
+  }
+
+  if (D1090TCPServer.hasClient()) {
+    for(i = 0; i < MAX_D1090TCP_CLIENTS; i++) {
+      // find free/disconnected spot
+      if (!D1090TCP[i] || !D1090TCP[i].connected()) {
+        if(D1090TCP[i]) {
+          D1090TCP[i].stop();
+        }
+        D1090TCP[i] = D1090TCPServer.available();
+        break;
+      }
+    }
+    if (i >= MAX_D1090TCP_CLIENTS) {
+      // no free/disconnected spot so reject
+      D1090TCPServer.available().stop();
+    }
+  }
+}
+#endif /* D1090_TCP_SERVICE */
+
+void D1090_fini()
+{
+#if defined(D1090_TCP_SERVICE)
+  if (D1090TCP_active) {
+    for (uint8_t i = 0; i < MAX_D1090TCP_CLIENTS; i++) {
+      if (D1090TCP[i]) {
+        D1090TCP[i].stop();
+      }
+    }
+    D1090TCPServer.stop();
+    D1090TCP_active = false;
+  }
+#endif /* D1090_TCP_SERVICE */
+}
+
 void D1090_Export()
 {
   frame_data_t df17;
   float distance;
-  String str;
   time_t this_moment = now();
 
   if (settings->d1090 != D1090_OFF) {
+#if defined(D1090_TCP_SERVICE)
+    if (settings->d1090 == D1090_TCP) {
+      D1090_TCP_Accept();
+    }
+#endif /* D1090_TCP_SERVICE */
+
+    Traffic_Export_Begin(TRAFFIC_SINK_D1090, settings->d1090);
+
     for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      if (Container[i].addr && (this_moment - Container[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
+      if (Traffic_Hot.addr[i] && (this_moment - Traffic_Hot.timestamp[i]) <= EXPORT_EXPIRATION_TIME) {
 
         distance = Container[i].distance;
 
-        if (distance < ALARM_ZONE_NONE) {
+        if (distance < ALARM_ZONE_NONE && Traffic_Export_Due(TRAFFIC_SINK_D1090, i)) {
+
+          ufo_t *fop = &Container[i];
+          d1090_cache_t *cache = &D1090_Cache[D1090_CACHE_NDX(i)];
+
+          if (cache->addr          != fop->addr     ||
+              cache->protocol      != fop->protocol ||
+              cache->aircraft_type != fop->aircraft_type) {
+            cache->addr          = fop->addr;
+            cache->protocol      = fop->protocol;
+            cache->aircraft_type = fop->aircraft_type;
+            cache->ident_valid   = false;
+            cache->pos_valid     = false;
+          }
 
           float altitude;
           /* If the aircraft's data has standard pressure altitude - make use it */
-          if (Container[i].pressure_altitude != 0.0) {
-            altitude = Container[i].pressure_altitude;
+          if (fop->pressure_altitude != 0.0) {
+            altitude = fop->pressure_altitude;
           } else if (ThisAircraft.pressure_altitude != 0.0) {
             /* If this SoftRF unit is equiped with baro sensor - try to make an adjustment */
             float altDiff = ThisAircraft.pressure_altitude - ThisAircraft.altitude;
-            altitude = Container[i].altitude + altDiff;
+            altitude = fop->altitude + altDiff;
           } else {
             /* If no other choice - report GNSS altitude as pressure altitude */
-            altitude = Container[i].altitude;
+            altitude = fop->altitude;
           }
           altitude *= _GPS_FEET_PER_METER;
 
-          df17 = make_air_position_frame(11, Container[i].addr,
-            Container[i].latitude, Container[i].longitude,
-            altitude, CPR_EVEN, DF17);
+          if (!cache->pos_valid                    ||
+              cache->latitude  != fop->latitude    ||
+              cache->longitude != fop->longitude   ||
+              cache->altitude  != altitude) {
 
-          str = "*";
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
+            cache->even = make_air_position_frame(11, fop->addr,
+              fop->latitude, fop->longitude,
+              altitude, CPR_EVEN, DF17);
 
-          df17 = make_air_position_frame(11, Container[i].addr,
-            Container[i].latitude, Container[i].longitude,
-            altitude, CPR_ODD, DF17);
+            cache->odd  = make_air_position_frame(11, fop->addr,
+              fop->latitude, fop->longitude,
+              altitude, CPR_ODD, DF17);
 
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
+            cache->latitude  = fop->latitude;
+            cache->longitude = fop->longitude;
+            cache->altitude  = altitude;
+            cache->pos_valid = true;
+          }
 
-          String callsign = String(GDL90_CallSign_Prefix[Container[i].protocol]);
-        
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr >> 16) & 0xFF);
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr >>  8) & 0xFF);
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr      ) & 0xFF);
+          if (!cache->ident_valid) {
+            const char *prefix = GDL90_CallSign_Prefix[fop->protocol];
+            unsigned char callsign[9];
+            size_t len = strlen(prefix);
 
-          callsign.toUpperCase();
+            memcpy(callsign, prefix, len);
+            for (int shift = 20; shift >= 0; shift -= 4) {
+              callsign[len++] = D1090_Hex[(fop->addr >> shift) & 0xF];
+            }
+            callsign[len] = 0;
 
-          df17 = make_aircraft_identification_frame(Container[i].addr,
-            (unsigned char*) callsign.c_str(),
-            Category_Set_D,
-            AT_TO_GDL90(Container[i].aircraft_type),
-            DF17);
+            cache->ident = make_aircraft_identification_frame(fop->addr,
+              callsign,
+              Category_Set_D,
+              AT_TO_GDL90(fop->aircraft_type),
+              DF17);
 
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
+            cache->ident_valid = true;
+          }
 
-          df17 = make_velocity_frame(Container[i].addr,
-            Container[i].speed * cos(Container[i].course * PI / 180),
-            Container[i].speed * sin(Container[i].course * PI / 180),
-            Container[i].vs,
+          df17 = make_velocity_frame(fop->addr,
+            fop->speed * cos(fop->course * PI / 180),
+            fop->speed * sin(fop->course * PI / 180),
+            fop->vs,
             DF17);
 
-          DF17_FRAME_TO_HEX_STR(str);
-          str.toUpperCase();
-          str += ";\r\n";
+          D1090_Batch_Add(&cache->even);
+          D1090_Batch_Add(&cache->odd);
+          D1090_Batch_Add(&cache->ident);
+          D1090_Batch_Add(&df17);
 
-          D1090_Out((byte *) str.c_str(), str.length());
+          Traffic_Export_Sent(TRAFFIC_SINK_D1090, i, 4 * D1090_FRAME_SIZE);
         }
       }
     }
+
+    D1090_Batch_Flush();
+  }
+}
+
+#if defined(RASPBERRY_PI)
+
+#include <math.h>
+
+#include "../../driver/RF.h"
+#include "../radio/ES1090.h"
+
+/*
+ * Mode-S ingest. D1090_Feed() takes the stream in whatever pieces
+ * it arrives and keeps the partial frame in the feed. Extended squitters
+ * (DF17, DF18 with an ICAO or anonymous address) that pass the CRC update
+ * a per-ICAO entry. Every airborne position message is CPR decoded on its
+ * own: relative to the last position of the aircraft, else from an even
+ * and odd pair, else relative to own position when that puts the aircraft
+ * well inside of 180 NM. The target then goes to the sink through
+ * es1090_decode().
+ *
+ * The ICAO table is shared by all feeds, so they all have to be run
+ * by the same thread.
+ */
+
+/* CRC-24 of Mode-S, generator 0xFFF409, MSB first */
+static const uint32_t D1090_CRC_Table[256] = {
+  0x000000, 0xfff409, 0x001c1b, 0xffe812, 0x003836, 0xffcc3f, 0x00242d, 0xffd024,
+  0x00706c, 0xff8465, 0x006c77, 0xff987e, 0x00485a, 0xffbc53, 0x005441, 0xffa048,
+  0x00e0d8, 0xff14d1, 0x00fcc3, 0xff08ca, 0x00d8ee, 0xff2ce7, 0x00c4f5, 0xff30fc,
+  0x0090b4, 0xff64bd, 0x008caf, 0xff78a6, 0x00a882, 0xff5c8b, 0x00b499, 0xff4090,
+  0x01c1b0, 0xfe35b9, 0x01ddab, 0xfe29a2, 0x01f986, 0xfe0d8f, 0x01e59d, 0xfe1194,
+  0x01b1dc, 0xfe45d5, 0x01adc7, 0xfe59ce, 0x0189ea, 0xfe7de3, 0x0195f1, 0xfe61f8,
+  0x012168, 0xfed561, 0x013d73, 0xfec97a, 0x01195e, 0xfeed57, 0x010545, 0xfef14c,
+  0x015104, 0xfea50d, 0x014d1f, 0xfeb916, 0x016932, 0xfe9d3b, 0x017529, 0xfe8120,
+  0x038360, 0xfc7769, 0x039f7b, 0xfc6b72, 0x03bb56, 0xfc4f5f, 0x03a74d, 0xfc5344,
+  0x03f30c, 0xfc0705, 0x03ef17, 0xfc1b1e, 0x03cb3a, 0xfc3f33, 0x03d721, 0xfc2328,
+  0x0363b8, 0xfc97b1, 0x037fa3, 0xfc8baa, 0x035b8e, 0xfcaf87, 0x034795, 0xfcb39c,
+  0x0313d4, 0xfce7dd, 0x030fcf, 0xfcfbc6, 0x032be2, 0xfcdfeb, 0x0337f9, 0xfcc3f0,
+  0x0242d0, 0xfdb6d9, 0x025ecb, 0xfdaac2, 0x027ae6, 0xfd8eef, 0x0266fd, 0xfd92f4,
+  0x0232bc, 0xfdc6b5, 0x022ea7, 0xfddaae, 0x020a8a, 0xfdfe83, 0x021691, 0xfde298,
+  0x02a208, 0xfd5601, 0x02be13, 0xfd4a1a, 0x029a3e, 0xfd6e37, 0x028625, 0xfd722c,
+  0x02d264, 0xfd266d, 0x02ce7f, 0xfd3a76, 0x02ea52, 0xfd1e5b, 0x02f649, 0xfd0240,
+  0x0706c0, 0xf8f2c9, 0x071adb, 0xf8eed2, 0x073ef6, 0xf8caff, 0x0722ed, 0xf8d6e4,
+  0x0776ac, 0xf882a5, 0x076ab7, 0xf89ebe, 0x074e9a, 0xf8ba93, 0x075281, 0xf8a688,
+  0x07e618, 0xf81211, 0x07fa03, 0xf80e0a, 0x07de2e, 0xf82a27, 0x07c235, 0xf8363c,
+  0x079674, 0xf8627d, 0x078a6f, 0xf87e66, 0x07ae42, 0xf85a4b, 0x07b259, 0xf84650,
+  0x06c770, 0xf93379, 0x06db6b, 0xf92f62, 0x06ff46, 0xf90b4f, 0x06e35d, 0xf91754,
+  0x06b71c, 0xf94315, 0x06ab07, 0xf95f0e, 0x068f2a, 0xf97b23, 0x069331, 0xf96738,
+  0x0627a8, 0xf9d3a1, 0x063bb3, 0xf9cfba, 0x061f9e, 0xf9eb97, 0x060385, 0xf9f78c,
+  0x0657c4, 0xf9a3cd, 0x064bdf, 0xf9bfd6, 0x066ff2, 0xf99bfb, 0x0673e9, 0xf987e0,
+  0x0485a0, 0xfb71a9, 0x0499bb, 0xfb6db2, 0x04bd96, 0xfb499f, 0x04a18d, 0xfb5584,
+  0x04f5cc, 0xfb01c5, 0x04e9d7, 0xfb1dde, 0x04cdfa, 0xfb39f3, 0x04d1e1, 0xfb25e8,
+  0x046578, 0xfb9171, 0x047963, 0xfb8d6a, 0x045d4e, 0xfba947, 0x044155, 0xfbb55c,
+  0x041514, 0xfbe11d, 0x04090f, 0xfbfd06, 0x042d22, 0xfbd92b, 0x043139, 0xfbc530,
+  0x054410, 0xfab019, 0x05580b, 0xfaac02, 0x057c26, 0xfa882f, 0x05603d, 0xfa9434,
+  0x05347c, 0xfac075, 0x052867, 0xfadc6e, 0x050c4a, 0xfaf843, 0x051051, 0xfae458,
+  0x05a4c8, 0xfa50c1, 0x05b8d3, 0xfa4cda, 0x059cfe, 0xfa68f7, 0x0580e5, 0xfa74ec,
+  0x05d4a4, 0xfa20ad, 0x05c8bf, 0xfa3cb6, 0x05ec92, 0xfa189b, 0x05f089, 0xfa0480
+};
+
+enum
+{
+  D1090_FEED_SYNC,
+  D1090_FEED_TYPE,    /* Beast, after 0x1A */
+  D1090_FEED_DATA,
+  D1090_FEED_ESCAPE,  /* Beast, 0x1A inside a frame */
+  D1090_FEED_HEX,     /* AVR, high nibble next */
+  D1090_FEED_NIBBLE   /* AVR, low nibble next */
+};
+
+#define D1090_BEAST_ESC       0x1A
+#define D1090_SHORT_MSG_BYTES 7
+#define D1090_LONG_MSG_BYTES  14
+
+#define D1090_ICAO_PROBE      8
+#define D1090_ICAO_TTL        60000  /* ms */
+#define D1090_CPR_PAIR_MS     10000  /* even and odd halves of a global decode */
+#define D1090_CPR_LOCAL_MS    30000  /* last position stays a CPR reference */
+#define D1090_CPR_OWN_RANGE   150000 /* metres, own position as CPR reference */
+#define D1090_CPR_SCALE       131072.0 /* 2^17 */
+#define D1090_METERS_PER_DEG  111195.0 /* of latitude */
+
+typedef struct {
+  bool      used;
+  bool      anonymous;    /* DF18 CF1, not an ICAO address */
+  bool      alt_valid;
+  bool      pos_valid;
+  uint8_t   cpr_valid;    /* bit 0 - even, bit 1 - odd */
+  uint32_t  addr;
+  uint32_t  seen_ms;
+  uint32_t  pos_ms;
+  uint32_t  cpr_ms[2];
+  uint32_t  cpr_lat[2];
+  uint32_t  cpr_lon[2];
+  int       vert_rate;    /* feet per minute */
+  float     rssi;
+  struct mode_s_aircraft a;
+} d1090_icao_t;
+
+static d1090_icao_t D1090_ICAO[D1090_ICAO_SIZE];
+
+static uint32_t D1090_CRC(const uint8_t *msg, size_t len)
+{
+  uint32_t crc = 0;
+
+  while (len--) {
+    crc = ((crc << 8) ^ D1090_CRC_Table[((crc >> 16) ^ *msg++) & 0xFF]) & 0xFFFFFF;
+  }
+
+  return crc;
+}
+
+/* entry of the aircraft, a free, expired or the stalest one for a new one */
+static d1090_icao_t *D1090_ICAO_Find(uint32_t addr, uint32_t ms)
+{
+  uint32_t hash = ((addr * 0x9E3779B1) >> 16) & (D1090_ICAO_SIZE - 1);
+  d1090_icao_t *victim = NULL;
+
+  for (int i = 0; i < D1090_ICAO_PROBE; i++) {
+    d1090_icao_t *e = &D1090_ICAO[(hash + i) & (D1090_ICAO_SIZE - 1)];
+
+    if (e->used && e->addr == addr) {
+      return e;
+    }
+
+    if (!e->used || ms - e->seen_ms > D1090_ICAO_TTL) {
+      if (victim == NULL || (victim->used && ms - victim->seen_ms <= D1090_ICAO_TTL)) {
+        victim = e;
+      }
+    } else if (victim == NULL ||
+               (victim->used && ms - e->seen_ms > ms - victim->seen_ms)) {
+      victim = e;
+    }
+  }
+
+  memset(victim, 0, sizeof(d1090_icao_t));
+  victim->used   = true;
+  victim->addr   = addr;
+  victim->a.addr = addr;
+  victim->a.unit = MODE_S_UNIT_FEET;
+
+  return victim;
+}
+
+static double D1090_Mod(double a, double b)
+{
+  double r = fmod(a, b);
+
+  return r < 0 ? r + b : r;
+}
+
+/* number of longitude zones */
+static int D1090_CPR_NL(double lat)
+{
+  lat = fabs(lat);
+
+  if (lat < 1e-6) return 59;
+  if (lat > 87.0) return 1;
+  if (lat == 87.0) return 2;
+
+  double a = 1 - cos(M_PI / (2 * 15));
+  double b = cos(M_PI / 180.0 * lat);
+
+  return (int) floor(2 * M_PI / acos(1 - a / (b * b)));
+}
+
+/* one half alone, the reference has to be within 180 NM of the aircraft */
+static void D1090_CPR_Local(int odd, uint32_t cpr_lat, uint32_t cpr_lon,
+                            double ref_lat, double ref_lon,
+                            double *lat, double *lon)
+{
+  double yz   = cpr_lat / D1090_CPR_SCALE;
+  double xz   = cpr_lon / D1090_CPR_SCALE;
+  double dlat = 360.0 / (odd ? 59 : 60);
+  double j    = floor(ref_lat / dlat) +
+                floor(0.5 + D1090_Mod(ref_lat, dlat) / dlat - yz);
+
+  *lat = dlat * (j + yz);
+
+  int ni = D1090_CPR_NL(*lat) - odd;
+  double dlon = 360.0 / (ni > 1 ? ni : 1);
+  double m    = floor(ref_lon / dlon) +
+                floor(0.5 + D1090_Mod(ref_lon, dlon) / dlon - xz);
+
+  *lon = dlon * (m + xz);
+}
+
+/* even and odd halves together, position is that of the newer one */
+static bool D1090_CPR_Global(d1090_icao_t *e, int odd, double *lat, double *lon)
+{
+  double lat0 = e->cpr_lat[0] / D1090_CPR_SCALE;
+  double lat1 = e->cpr_lat[1] / D1090_CPR_SCALE;
+  double lon0 = e->cpr_lon[0] / D1090_CPR_SCALE;
+  double lon1 = e->cpr_lon[1] / D1090_CPR_SCALE;
+
+  double j     = floor(59 * lat0 - 60 * lat1 + 0.5);
+  double rlat0 = 360.0 / 60 * (D1090_Mod(j, 60) + lat0);
+  double rlat1 = 360.0 / 59 * (D1090_Mod(j, 59) + lat1);
+
+  if (rlat0 >= 270) rlat0 -= 360;
+  if (rlat1 >= 270) rlat1 -= 360;
+
+  if (rlat0 < -90 || rlat0 > 90 || rlat1 < -90 || rlat1 > 90) {
+    return false;
+  }
+
+  /* the halves straddle a zone boundary */
+  int nl = D1090_CPR_NL(rlat0);
+  if (nl != D1090_CPR_NL(rlat1)) {
+    return false;
+  }
+
+  int ni   = nl - odd > 1 ? nl - odd : 1;
+  double m = floor(lon0 * (nl - 1) - lon1 * nl + 0.5);
+
+  *lat = odd ? rlat1 : rlat0;
+  *lon = 360.0 / ni * (D1090_Mod(m, ni) + (odd ? lon1 : lon0));
+
+  return true;
+}
+
+/* square of the distance from own position, flat earth is good enough */
+static float D1090_Distance2(d1090_feed_t *feed, double lat, double lon)
+{
+  float dlon = lon - feed->longitude;
+
+  if (dlon >  180.0) dlon -= 360.0;
+  if (dlon < -180.0) dlon += 360.0;
+
+  float north = (lat - feed->latitude) * D1090_METERS_PER_DEG;
+  float east  = dlon * D1090_METERS_PER_DEG * cosf(radians(feed->latitude));
+
+  return north * north + east * east;
+}
+
+static void D1090_Target(d1090_feed_t *feed, d1090_icao_t *e)
+{
+  ufo_t fo = EmptyFO;
+
+  /* no target is given out before its altitude is known */
+  if (feed->sink == NULL || !e->alt_valid) {
+    return;
+  }
+
+  /* EmptyFO stands in for ThisAircraft, timestamp 0 is stamped by the sink */
+  if (!es1090_decode(&e->a, &EmptyFO, &fo)) {
+    return;
+  }
+
+  /* TBD */
+  fo.altitude = fo.pressure_altitude;
+
+  if (e->anonymous) {
+    fo.addr_type = ADDR_TYPE_ANONYMOUS;
+  }
+  fo.vs   = e->vert_rate;
+  fo.rssi = e->rssi;
+
+  feed->targets++;
+  (*feed->sink)(&fo, NULL, 0);
+}
+
+/* TC 1-4: call sign and emitter category */
+static void D1090_Ident(d1090_icao_t *e, const uint8_t *me)
+{
+  static const char charset[] =
+    "#ABCDEFGHIJKLMNOPQRSTUVWXYZ##### ###############0123456789######";
+  uint64_t chars = 0;
+  int tc = me[0] >> 3;
+  int ca = me[0] & 7;
+
+  for (int i = 1; i < 7; i++) {
+    chars = (chars << 8) | me[i];
+  }
+
+  for (int i = 0; i < 8; i++) {
+    e->a.flight[i] = charset[(chars >> (42 - 6 * i)) & 0x3F];
+  }
+  for (int i = 7; i >= 0 && (e->a.flight[i] == ' ' || e->a.flight[i] == '#'); i--) {
+    e->a.flight[i] = '\0';
+  }
+  e->a.flight[8] = '\0';
+
+  /* sets A, B and C of DO-260 line up with GDL90 emitter categories */
+  if (tc > 1 && ca != 0) {
+    e->a.aircraft_type = (4 - tc) * 8 + ca;
+  }
+}
+
+/* TC 9-18 (barometric altitude) and 20-22 (GNSS height, not taken) */
+static void D1090_Position(d1090_feed_t *feed, d1090_icao_t *e,
+                           const uint8_t *me, bool baro)
+{
+  int odd = (me[2] >> 2) & 1;
+  double lat, lon;
+
+  if (baro) {
+    uint16_t ac12 = (me[1] << 4) | (me[2] >> 4);
+
+    /* Q = 1, 25 ft steps. Gillham coded 100 ft steps are left out */
+    if (ac12 & 0x10) {
+      e->a.altitude = ((((ac12 & 0xFE0) >> 1) | (ac12 & 0x0F)) * 25) - 1000;
+      e->alt_valid  = true;
+    }
+  }
+
+  e->cpr_lat[odd] = ((me[2] & 3) << 15) | (me[3] << 7) | (me[4] >> 1);
+  e->cpr_lon[odd] = ((me[4] & 1) << 16) | (me[5] << 8) | me[6];
+  e->cpr_ms[odd]  = feed->ms;
+  e->cpr_valid   |= 1 << odd;
+
+  if (e->pos_valid && feed->ms - e->pos_ms < D1090_CPR_LOCAL_MS) {
+    D1090_CPR_Local(odd, e->cpr_lat[odd], e->cpr_lon[odd],
+                    e->a.lat, e->a.lon, &lat, &lon);
+  } else if (e->cpr_valid == 3 &&
+             feed->ms - e->cpr_ms[!odd] < D1090_CPR_PAIR_MS) {
+    if (!D1090_CPR_Global(e, odd, &lat, &lon)) {
+      return;
+    }
+  } else if (feed->fix) {
+    D1090_CPR_Local(odd, e->cpr_lat[odd], e->cpr_lon[odd],
+                    feed->latitude, feed->longitude, &lat, &lon);
+
+    /*
+     * Wrong by a whole zone when the aircraft is over 180 NM away,
+     * only a result well inside of that is taken.
+     */
+    if (D1090_Distance2(feed, lat, lon) >
+        (float) D1090_CPR_OWN_RANGE * D1090_CPR_OWN_RANGE) {
+      return;
+    }
+  } else {
+    return;
+  }
+
+  if (lon >= 180.0) lon -= 360.0;
+  if (lat < -90.0 || lat > 90.0) {
+    return;
+  }
+
+  e->a.lat     = lat;
+  e->a.lon     = lon;
+  e->pos_ms    = feed->ms;
+  e->pos_valid = true;
+  feed->positions++;
+
+  if (e->alt_valid &&
+      (feed->range <= 0 ||
+       D1090_Distance2(feed, lat, lon) < feed->range * feed->range)) {
+    D1090_Target(feed, e);
+  }
+}
+
+/* TC 19: ground speed or airspeed, track or heading, vertical rate */
+static void D1090_Velocity(d1090_icao_t *e, const uint8_t *me)
+{
+  int st = me[0] & 7;
+  int vr = ((me[4] & 7) << 6) | (me[5] >> 2);
+
+  if (st == 1 || st == 2) {
+    int ew = ((me[1] & 3) << 8) | me[2];
+    int ns = ((me[3] & 0x7F) << 3) | (me[4] >> 5);
+
+    if (ew != 0 && ns != 0) {
+      float vx = (ew - 1) * (st == 2 ? 4 : 1);
+      float vy = (ns - 1) * (st == 2 ? 4 : 1);
+
+      if (me[1] & 0x04) vx = -vx;
+      if (me[3] & 0x80) vy = -vy;
+
+      int track = (int) lroundf(atan2f(vx, vy) * 180.0 / M_PI);
+
+      e->a.speed = (int) lroundf(sqrtf(vx * vx + vy * vy));
+      e->a.track = track < 0 ? track + 360 : track;
+    }
+  } else if (st == 3 || st == 4) {
+    int as = ((me[3] & 0x7F) << 3) | (me[4] >> 5);
+
+    if (me[1] & 0x04) {
+      e->a.track = (((me[1] & 3) << 8) | me[2]) * 360 / 1024;
+    }
+    if (as != 0) {
+      e->a.speed = (as - 1) * (st == 4 ? 4 : 1);
+    }
+  } else {
+    return;
+  }
+
+  if (vr != 0) {
+    e->vert_rate = (me[4] & 0x08) ? -(vr - 1) * 64 : (vr - 1) * 64;
+  }
+}
+
+static void D1090_Frame(d1090_feed_t *feed, const uint8_t *msg, size_t len,
+                        uint8_t signal)
+{
+  feed->frames++;
+
+  /* ADS-B comes with the long frames of DF17 and DF18 only */
+  if (len != D1090_LONG_MSG_BYTES) {
+    return;
+  }
+
+  int df = msg[0] >> 3;
+  int cf = msg[0] & 7;
+
+  if (df != 17 && !(df == 18 && cf <= 1)) {
+    return;
+  }
+
+  if (D1090_CRC(msg, len) != 0) {
+    feed->crc_errors++;
+    return;
+  }
+
+  uint32_t addr = ((uint32_t) msg[1] << 16) | (msg[2] << 8) | msg[3];
+  d1090_icao_t *e = D1090_ICAO_Find(addr, feed->ms);
+  const uint8_t *me = msg + 4;
+  int tc = me[0] >> 3;
+
+  e->seen_ms   = feed->ms;
+  e->anonymous = (df == 18 && cf == 1);
+  if (signal > 0) {
+    e->rssi = 20 * log10f(signal / 255.0);
+  }
+
+  if (tc >= 1 && tc <= 4) {
+    D1090_Ident(e, me);
+  } else if (tc >= 9 && tc <= 18) {
+    D1090_Position(feed, e, me, true);
+  } else if (tc == 19) {
+    D1090_Velocity(e, me);
+  } else if (tc >= 20 && tc <= 22) {
+    D1090_Position(feed, e, me, false);
+  }
+}
+
+static int D1090_Nibble(uint8_t c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+/*
+ * Beast: 0x1A, type '1' (Mode-A/C), '2' (short) or '3' (long), 6 octets
+ * of 12 MHz timestamp, signal level and the message. Any 0x1A past the
+ * type is sent twice.
+ */
+static void D1090_Beast_Put(d1090_feed_t *feed, uint8_t c)
+{
+  feed->frame[feed->size++] = c;
+
+  if (feed->size == feed->need) {
+    D1090_Frame(feed, feed->frame + 7, feed->need - 7, feed->frame[6]);
+    feed->state = D1090_FEED_SYNC;
+  } else {
+    feed->state = D1090_FEED_DATA;
+  }
+}
+
+static void D1090_Beast(d1090_feed_t *feed, uint8_t c)
+{
+  switch (feed->state)
+  {
+  case D1090_FEED_DATA:
+    if (c == D1090_BEAST_ESC) {
+      feed->state = D1090_FEED_ESCAPE;
+    } else {
+      D1090_Beast_Put(feed, c);
+    }
+    break;
+  case D1090_FEED_ESCAPE:
+    if (c == D1090_BEAST_ESC) {
+      D1090_Beast_Put(feed, c);
+    } else {
+      /* a lone 0x1A starts the next frame, this one is cut short */
+      feed->state = D1090_FEED_TYPE;
+      D1090_Beast(feed, c);
+    }
+    break;
+  case D1090_FEED_TYPE:
+    feed->size  = 0;
+    feed->state = D1090_FEED_DATA;
+    switch (c)
+    {
+    case '1': feed->need = 7 + 2;                     break;
+    case '2': feed->need = 7 + D1090_SHORT_MSG_BYTES; break;
+    case '3': feed->need = 7 + D1090_LONG_MSG_BYTES;  break;
+    default:  feed->state = D1090_FEED_SYNC;          break;
+    }
+    break;
+  case D1090_FEED_SYNC:
+  default:
+    if (c == D1090_BEAST_ESC) {
+      feed->state = D1090_FEED_TYPE;
+    }
+    break;
+  }
+}
+
+/*
+ * AVR: "*" message ";", "@" 6 octets of timestamp and message ";"
+ * or "<" timestamp, signal level and message ";", all in hex.
+ */
+static void D1090_AVR(d1090_feed_t *feed, uint8_t c)
+{
+  int nibble = D1090_Nibble(c);
+
+  switch (feed->state)
+  {
+  case D1090_FEED_HEX:
+    if (nibble >= 0 && feed->size < sizeof(feed->frame)) {
+      feed->frame[feed->size] = nibble << 4;
+      feed->state = D1090_FEED_NIBBLE;
+      break;
+    }
+    if (c == ';' && feed->size > feed->need) {
+      D1090_Frame(feed, feed->frame + feed->need, feed->size - feed->need,
+                  feed->need == 7 ? feed->frame[6] : 0);
+    }
+    feed->state = D1090_FEED_SYNC;
+    break;
+  case D1090_FEED_NIBBLE:
+    if (nibble >= 0) {
+      feed->frame[feed->size++] |= nibble;
+      feed->state = D1090_FEED_HEX;
+    } else {
+      feed->state = D1090_FEED_SYNC;
+    }
+    break;
+  case D1090_FEED_SYNC:
+  default:
+    break;
+  }
+
+  if (feed->state == D1090_FEED_SYNC) {
+    feed->size = 0;
+    switch (c)
+    {
+    case '*': feed->need = 0; feed->state = D1090_FEED_HEX; break;
+    case '@': feed->need = 6; feed->state = D1090_FEED_HEX; break;
+    case '<': feed->need = 7; feed->state = D1090_FEED_HEX; break;
+    default:                                                break;
+    }
+  }
+}
+
+void D1090_Feed_init(d1090_feed_t *feed, uint8_t format)
+{
+  memset(feed, 0, sizeof(d1090_feed_t));
+  feed->format = format;
+  feed->state  = D1090_FEED_SYNC;
+}
+
+void D1090_Feed(d1090_feed_t *feed, const uint8_t *buf, size_t size)
+{
+  if (feed->format == D1090_FEED_BEAST) {
+    for (size_t i = 0; i < size; i++) {
+      D1090_Beast(feed, buf[i]);
+    }
+  } else {
+    for (size_t i = 0; i < size; i++) {
+      D1090_AVR(feed, buf[i]);
+    }
   }
 }
+#endif /* RASPBERRY_PI */
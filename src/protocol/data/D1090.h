@@ -29,6 +29,59 @@ enum
 	D1090_BLUETOOTH
 };
 
+/* all frames of an export cycle leave with a single write */
+#if !defined(D1090_BATCH_SIZE)
+#define D1090_BATCH_SIZE      1024
+#endif /* D1090_BATCH_SIZE */
+
+#if defined(D1090_TCP_SERVICE)
+#define MAX_D1090TCP_CLIENTS  2
+#endif /* D1090_TCP_SERVICE */
+
+#if defined(RASPBERRY_PI)
+/*
+ * Mode-S ingest from a dump1090 style feed, Beast binary (30005)
+ * or AVR raw text (30002) output. Frames are cut out of the stream
+ * as it arrives, ADS-B positions are decoded one message at a time.
+ */
+enum
+{
+	D1090_FEED_BEAST,
+	D1090_FEED_AVR
+};
+
+#define D1090_FEED_FRAME_MAX  (6 + 1 + 14) /* Beast timestamp, signal, long frame */
+#define D1090_ICAO_SIZE       256          /* aircraft tracked for CPR, power of 2 */
+
+/* where a decoded target goes, same as json_traffic_t, raw is always NULL */
+typedef void (*d1090_traffic_t)(ufo_t *, const uint8_t *, size_t);
+
+typedef struct {
+  uint8_t          format;
+  uint8_t          state;
+  uint8_t          size;                 /* octets of frame[] collected */
+  uint8_t          need;                 /* Beast: frame length, AVR: octets ahead of message */
+  uint8_t          frame[D1090_FEED_FRAME_MAX];
+
+  /* set by the caller ahead of D1090_Feed() */
+  uint32_t         ms;                   /* receive time */
+  bool             fix;                  /* latitude/longitude are own position */
+  float            latitude;
+  float            longitude;
+  float            range;                /* metres, 0 - no filter */
+  d1090_traffic_t  sink;                 /* NULL - keep decoding, deliver nothing */
+
+  uint32_t         frames;
+  uint32_t         crc_errors;
+  uint32_t         positions;            /* decoded by CPR */
+  uint32_t         targets;              /* handed to sink */
+} d1090_feed_t;
+
+void D1090_Feed_init(d1090_feed_t *, uint8_t);
+void D1090_Feed(d1090_feed_t *, const uint8_t *, size_t);
+#endif /* RASPBERRY_PI */
+
 void D1090_Export(void);
+void D1090_fini(void);
 
 #endif /* D1090HELPER_H */
\ No newline at end of file
@@ -20,10 +20,10 @@
  */
 
 #include <TimeLib.h>
-#include <lib_crc.h>
 #include <protocol.h>
 
 #include "../../system/SoC.h"
+#include "../../system/CRC.h"
 #include "GDL90.h"
 #include "../../driver/GNSS.h"
 #include "../../driver/EEPROM.h"
@@ -42,6 +42,15 @@ static GDL90_Msg_HeartBeat_t HeartBeat;
 static GDL90_Msg_Traffic_t Traffic;
 static GDL90_Msg_OwnershipGeometricAltitude_t GeometricAltitude;
 
+static uint8_t GDL90_Batch[GDL90_BATCH_SIZE];
+static size_t  GDL90_Batch_Len = 0;
+
+#if defined(GDL90_TCP_SERVICE)
+WiFiServer GDL90TCPServer(GDL90_TCP_PORT);
+WiFiClient GDL90TCP[MAX_GDL90TCP_CLIENTS];
+static bool GDL90TCP_active = false;
+#endif /* GDL90_TCP_SERVICE */
+
 const char *GDL90_CallSign_Prefix[] = {
   [RF_PROTOCOL_LEGACY]    = "FL",
   [RF_PROTOCOL_OGNTP]     = "OG",
@@ -163,12 +172,12 @@ uint16_t GDL90_calcFCS(uint8_t msg_id, uint8_t *msg, int size)
 {
   uint16_t crc16 = 0x0000;  /* seed value */
 
-  crc16 = update_crc_gdl90(crc16, msg_id);
+  crc16 = CRC_GDL90_Byte(crc16, msg_id);
 
   for (int i=0; i < size; i++)
   {
-    crc16 = update_crc_gdl90(crc16, msg[i]);
-  }    
+    crc16 = CRC_GDL90_Byte(crc16, msg[i]);
+  }
 
   return(crc16);
 }
@@ -187,6 +196,43 @@ uint8_t *GDL90_EscapeFilter(uint8_t *buf, uint8_t *p, int size)
   return (buf);
 }
 
+static inline uint8_t *GDL90_Stuff(uint8_t *ptr, uint8_t c)
+{
+  if (c != 0x7D && c != 0x7E) {
+    *ptr++ = c;
+  } else {
+    *ptr++ = 0x7D;
+    *ptr++ = c ^ 0x20;
+  }
+
+  return (ptr);
+}
+
+/*
+ * Frame one message: FCS is computed and control octets
+ * are escaped on the way into 'buf', in a single pass.
+ * 'buf' has to have room for GDL90_FRAME_SIZE(size) bytes.
+ */
+static size_t GDL90_Frame(uint8_t *buf, uint8_t id, const uint8_t *msg, size_t size)
+{
+  uint8_t *ptr = buf;
+  uint16_t fcs = CRC_GDL90_Byte(0x0000, id);
+
+  *ptr++ = 0x7E; /* Start flag */
+  ptr = GDL90_Stuff(ptr, id);
+
+  while (size--) {
+    fcs = CRC_GDL90_Byte(fcs, *msg);
+    ptr = GDL90_Stuff(ptr, *msg++);
+  }
+
+  ptr = GDL90_Stuff(ptr, fcs        & 0xFF); /* LSB first */
+  ptr = GDL90_Stuff(ptr, (fcs >> 8) & 0xFF);
+  *ptr++ = 0x7E; /* Stop flag */
+
+  return(ptr-buf);
+}
+
 static void *msgHeartbeat()
 {
   time_t ts = elapsedSecsToday(now());
@@ -253,6 +299,11 @@ static void *msgType10and20(ufo_t *aircraft)
   }
  
   uint8_t misc = 9;
+
+  /* "report is extrapolated" between two received fixes */
+  if (Traffic_Extrapolated(aircraft)) {
+    misc |= 0x4;
+  }
   //altitude = 0x678;
   
   uint16_t horiz_vel = (uint16_t) aircraft->speed /* 0x123 */ ; /*  in knots */
@@ -343,86 +394,29 @@ static void *msgOwnershipGeometricAltitude(ufo_t *aircraft)
 
 static size_t makeHeartbeat(uint8_t *buf)
 {
-  uint8_t *ptr = buf;
-  uint8_t *msg = (uint8_t *) msgHeartbeat();
-  uint16_t fcs = GDL90_calcFCS(GDL90_HEARTBEAT_MSG_ID, msg,
-                               sizeof(GDL90_Msg_HeartBeat_t));
-  uint8_t fcs_lsb, fcs_msb;
-  
-  fcs_lsb = fcs        & 0xFF;
-  fcs_msb = (fcs >> 8) & 0xFF;
-
-  *ptr++ = 0x7E; /* Start flag */
-  *ptr++ = GDL90_HEARTBEAT_MSG_ID;
-  ptr = GDL90_EscapeFilter(ptr, msg, sizeof(GDL90_Msg_HeartBeat_t));
-  ptr = GDL90_EscapeFilter(ptr, &fcs_lsb, 1);
-  ptr = GDL90_EscapeFilter(ptr, &fcs_msb, 1);
-  *ptr++ = 0x7E; /* Stop flag */
-
-  return(ptr-buf);
+  return GDL90_Frame(buf, GDL90_HEARTBEAT_MSG_ID, (uint8_t *) msgHeartbeat(),
+                     sizeof(GDL90_Msg_HeartBeat_t));
 }
 
 static size_t makeType10and20(uint8_t *buf, uint8_t id, ufo_t *aircraft)
 {
-  uint8_t *ptr = buf;
-  uint8_t *msg = (uint8_t *) msgType10and20(aircraft);
-  uint16_t fcs = GDL90_calcFCS(id, msg, sizeof(GDL90_Msg_Traffic_t));
-  uint8_t fcs_lsb, fcs_msb;
-  
-  fcs_lsb = fcs        & 0xFF;
-  fcs_msb = (fcs >> 8) & 0xFF;
-
-  *ptr++ = 0x7E; /* Start flag */
-  *ptr++ = id;
-  ptr = GDL90_EscapeFilter(ptr, msg, sizeof(GDL90_Msg_Traffic_t));
-  ptr = GDL90_EscapeFilter(ptr, &fcs_lsb, 1);
-  ptr = GDL90_EscapeFilter(ptr, &fcs_msb, 1);
-  *ptr++ = 0x7E; /* Stop flag */
-
-  return(ptr-buf);
+  return GDL90_Frame(buf, id, (uint8_t *) msgType10and20(aircraft),
+                     sizeof(GDL90_Msg_Traffic_t));
 }
 
 static size_t makeGeometricAltitude(uint8_t *buf, ufo_t *aircraft)
 {
-  uint8_t *ptr = buf;
-  uint8_t *msg = (uint8_t *) msgOwnershipGeometricAltitude(aircraft);
-  uint16_t fcs = GDL90_calcFCS(GDL90_OWNGEOMALT_MSG_ID, msg,
-                               sizeof(GDL90_Msg_OwnershipGeometricAltitude_t));
-  uint8_t fcs_lsb, fcs_msb;
-
-  fcs_lsb = fcs        & 0xFF;
-  fcs_msb = (fcs >> 8) & 0xFF;
-
-  *ptr++ = 0x7E; /* Start flag */
-  *ptr++ = GDL90_OWNGEOMALT_MSG_ID;
-  ptr = GDL90_EscapeFilter(ptr, msg, sizeof(GDL90_Msg_OwnershipGeometricAltitude_t));
-  ptr = GDL90_EscapeFilter(ptr, &fcs_lsb, 1);
-  ptr = GDL90_EscapeFilter(ptr, &fcs_msb, 1);
-  *ptr++ = 0x7E; /* Stop flag */
-
-  return(ptr-buf);
+  return GDL90_Frame(buf, GDL90_OWNGEOMALT_MSG_ID,
+                     (uint8_t *) msgOwnershipGeometricAltitude(aircraft),
+                     sizeof(GDL90_Msg_OwnershipGeometricAltitude_t));
 }
 
 #if defined(DO_GDL90_FF_EXT)
 
 static size_t makeFFid(uint8_t *buf)
 {
-  uint8_t *ptr = buf;
-  uint8_t *msg = (uint8_t *) &msgFFid;
-  uint16_t fcs = GDL90_calcFCS(GDL90_FFEXT_MSG_ID, msg, sizeof(GDL90_Msg_FF_ID_t));
-  uint8_t fcs_lsb, fcs_msb;
-
-  fcs_lsb = fcs        & 0xFF;
-  fcs_msb = (fcs >> 8) & 0xFF;
-
-  *ptr++ = 0x7E; /* Start flag */
-  *ptr++ = GDL90_FFEXT_MSG_ID;
-  ptr = GDL90_EscapeFilter(ptr, msg, sizeof(GDL90_Msg_FF_ID_t));
-  ptr = GDL90_EscapeFilter(ptr, &fcs_lsb, 1);
-  ptr = GDL90_EscapeFilter(ptr, &fcs_msb, 1);
-  *ptr++ = 0x7E; /* Stop flag */
-
-  return(ptr-buf);
+  return GDL90_Frame(buf, GDL90_FFEXT_MSG_ID, (uint8_t *) &msgFFid,
+                     sizeof(GDL90_Msg_FF_ID_t));
 }
 #endif
 
@@ -432,6 +426,8 @@ static size_t makeFFid(uint8_t *buf)
 static void GDL90_Out(byte *buf, size_t size)
 {
   if (size > 0) {
+    Traffic_Export_Out(settings->gdl90, size);
+
     switch(settings->gdl90)
     {
     case GDL90_UART:
@@ -461,6 +457,16 @@ static void GDL90_Out(byte *buf, size_t size)
       }
       break;
     case GDL90_TCP:
+      {
+#if defined(GDL90_TCP_SERVICE)
+        for (uint8_t acc_ndx = 0; acc_ndx < MAX_GDL90TCP_CLIENTS; acc_ndx++) {
+          if (GDL90TCP[acc_ndx] && GDL90TCP[acc_ndx].connected()) {
+            GDL90TCP[acc_ndx].write(buf, size);
+          }
+        }
+#endif /* GDL90_TCP_SERVICE */
+      }
+      break;
     case GDL90_OFF:
     default:
       break;
@@ -468,47 +474,131 @@ static void GDL90_Out(byte *buf, size_t size)
   }
 }
 
+static void GDL90_Batch_Flush()
+{
+  if (GDL90_Batch_Len > 0) {
+    GDL90_Out(GDL90_Batch, GDL90_Batch_Len);
+    GDL90_Batch_Len = 0;
+  }
+}
+
+/* room for one frame at the end of the batch, the batch goes out early when it is full */
+static uint8_t *GDL90_Batch_Tail(size_t size)
+{
+  if (GDL90_Batch_Len + size > sizeof(GDL90_Batch)) {
+    GDL90_Batch_Flush();
+  }
+
+  return GDL90_Batch + GDL90_Batch_Len;
+}
+
+#if defined(GDL90_TCP_SERVICE)
+static void GDL90_TCP_Accept()
+{
+  uint8_t i;
+
+  if (!GDL90TCP_active) {
+    GDL90TCPServer.begin();
+    Serial.print(F("GDL90 TCP server has started at port: "));
+    Serial.println(GDL90_TCP_PORT);
+
+    GDL90TCPServer.setNoDelay(true);
+    GDL90TCP_active = true;
+  }
+
+  if (GDL90TCPServer.hasClient()) {
+    for(i = 0; i < MAX_GDL90TCP_CLIENTS; i++) {
+      // find free/disconnected spot
+      if (!GDL90TCP[i] || !GDL90TCP[i].connected()) {
+        if(GDL90TCP[i]) {
+          GDL90TCP[i].stop();
+        }
+        GDL90TCP[i] = GDL90TCPServer.available();
+        break;
+      }
+    }
+    if (i >= MAX_GDL90TCP_CLIENTS) {
+      // no free/disconnected spot so reject
+      GDL90TCPServer.available().stop();
+    }
+  }
+}
+#endif /* GDL90_TCP_SERVICE */
+
+void GDL90_fini()
+{
+#if defined(GDL90_TCP_SERVICE)
+  if (GDL90TCP_active) {
+    for (uint8_t i = 0; i < MAX_GDL90TCP_CLIENTS; i++) {
+      if (GDL90TCP[i]) {
+        GDL90TCP[i].stop();
+      }
+    }
+    GDL90TCPServer.stop();
+    GDL90TCP_active = false;
+  }
+#endif /* GDL90_TCP_SERVICE */
+}
+
 void GDL90_Export()
 {
-  size_t size;
+  uint8_t *buf;
   float distance;
   time_t this_moment = now();
-  uint8_t *buf = (uint8_t *) (sizeof(UDPpacketBuffer) < UDP_PACKET_BUFSIZE ?
-                              NMEABuffer : UDPpacketBuffer);
 
   if (settings->gdl90 != GDL90_OFF) {
-    size = makeHeartbeat(buf);
-    GDL90_Out(buf, size);
+#if defined(GDL90_TCP_SERVICE)
+    if (settings->gdl90 == GDL90_TCP) {
+      GDL90_TCP_Accept();
+    }
+#endif /* GDL90_TCP_SERVICE */
+
+    Traffic_Export_Begin(TRAFFIC_SINK_GDL90, settings->gdl90);
+
+    if (Traffic_Export_Beat()) {
+      buf = GDL90_Batch_Tail(GDL90_FRAME_SIZE(sizeof(GDL90_Msg_HeartBeat_t)));
+      GDL90_Batch_Len += makeHeartbeat(buf);
 
 #if defined(DO_GDL90_FF_EXT)
-    size = makeFFid(buf);
-    GDL90_Out(buf, size);
+      buf = GDL90_Batch_Tail(GDL90_FRAME_SIZE(sizeof(GDL90_Msg_FF_ID_t)));
+      GDL90_Batch_Len += makeFFid(buf);
 #endif /* DO_GDL90_FF_EXT */
 
 #if defined(ENABLE_AHRS)
-    size = AHRS_GDL90(buf);
-    GDL90_Out(buf, size);
+      buf = GDL90_Batch_Tail(GDL90_FRAME_SIZE_MAX);
+      GDL90_Batch_Len += AHRS_GDL90(buf);
 #endif /* ENABLE_AHRS */
+    }
 
     if (isValidFix()) {
-      size = makeOwnershipReport(buf, &ThisAircraft);
-      GDL90_Out(buf, size);
+      if (Traffic_Export_Beat()) {
+        buf = GDL90_Batch_Tail(GDL90_FRAME_SIZE(sizeof(GDL90_Msg_Traffic_t)));
+        GDL90_Batch_Len += makeOwnershipReport(buf, &ThisAircraft);
+
+        buf = GDL90_Batch_Tail(GDL90_FRAME_SIZE(sizeof(GDL90_Msg_OwnershipGeometricAltitude_t)));
+        GDL90_Batch_Len += makeGeometricAltitude(buf, &ThisAircraft);
+      }
 
-      size = makeGeometricAltitude(buf, &ThisAircraft);
-      GDL90_Out(buf, size);
+      Traffic_Extrapolate();
 
       for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-        if (Container[i].addr &&
-           (this_moment - Container[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
+        if (Traffic_Hot.addr[i] &&
+           (this_moment - Traffic_Hot.timestamp[i]) <= EXPORT_EXPIRATION_TIME) {
 
           distance = Container[i].distance;
 
-          if (distance < ALARM_ZONE_NONE) {
+          if (distance < ALARM_ZONE_NONE && Traffic_Export_Due(TRAFFIC_SINK_GDL90, i)) {
+            size_t size;
+
+            buf  = GDL90_Batch_Tail(GDL90_FRAME_SIZE(sizeof(GDL90_Msg_Traffic_t)));
             size = makeTrafficReport(buf, &Container[i]);
-            GDL90_Out(buf, size);
+            GDL90_Batch_Len += size;
+            Traffic_Export_Sent(TRAFFIC_SINK_GDL90, i, size);
           }
         }
       }
     }
+
+    GDL90_Batch_Flush();
   }
 }
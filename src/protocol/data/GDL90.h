@@ -150,6 +150,19 @@ typedef struct GDL90_Msg_FF_ID {
 
 #endif
 
+/* worst case size of a message after byte stuffing, with flags and FCS */
+#define GDL90_FRAME_SIZE(n)     (2 + 2 * (1 + (n) + 2))
+#define GDL90_FRAME_SIZE_MAX    GDL90_FRAME_SIZE(40) /* ForeFlight ID is the largest */
+
+/* all messages of an export cycle leave as one datagram */
+#if !defined(GDL90_BATCH_SIZE)
+#define GDL90_BATCH_SIZE        1024
+#endif /* GDL90_BATCH_SIZE */
+
+#if defined(GDL90_TCP_SERVICE)
+#define MAX_GDL90TCP_CLIENTS    2
+#endif /* GDL90_TCP_SERVICE */
+
 #define AT_TO_GDL90(x)  ((x) > 15 ? \
    GDL90_EMITTER_CATEGORY_NONE : pgm_read_byte(&aircraft_type_to_gdl90[(x)]))
 
@@ -161,6 +174,7 @@ extern const uint8_t gdl90_to_aircraft_type[] PROGMEM;
 extern const char *GDL90_CallSign_Prefix[];
 
 void GDL90_Export(void);
+void GDL90_fini(void);
 uint16_t GDL90_calcFCS(uint8_t, uint8_t *, int);
 uint8_t *GDL90_EscapeFilter(uint8_t *, uint8_t *, int);
 
@@ -59,6 +59,31 @@ byte getVal(char c)
      return (byte)(toupper(c)-'A'+10);
 }
 
+/*
+ * JSON_Export() streams aircraft objects to the sink through a fixed chunk,
+ * memory use does not depend on the number of targets.
+ */
+static char   JSON_Chunk[JSON_CHUNK_SIZE];
+static size_t JSON_Chunk_Len = 0;
+
+static void JSON_Flush()
+{
+  if (JSON_Chunk_Len > 0) {
+    Serial.write((const uint8_t *) JSON_Chunk, JSON_Chunk_Len);
+    JSON_Chunk_Len = 0;
+  }
+}
+
+static void JSON_Put(const char *s, size_t len)
+{
+  if (JSON_Chunk_Len + len > sizeof(JSON_Chunk)) {
+    JSON_Flush();
+  }
+
+  memcpy(JSON_Chunk + JSON_Chunk_Len, s, len);
+  JSON_Chunk_Len += len;
+}
+
 void JSON_Export()
 {
   if (settings->json != JSON_PING) {
@@ -67,74 +92,106 @@ void JSON_Export()
 
   float distance;
   time_t this_moment = now();
-  char buffer[3 * 80 * MAX_TRACKING_OBJECTS];
   bool has_aircraft = false;
+  char timebuf[32];
+  char object[JSON_AIRCRAFT_SIZE];
+  time_t timestamp = now(); /* GNSS date&time */
 
-  JsonObject& root = jsonBuffer.createObject();
-  JsonArray& aircraft_array = root.createNestedArray("aircraft");
+  /* Time packet was received at the pingStation ISO 8601 format: YYYY-MM-DDTHH:mm:ss:ffffffffZ */
+  strftime(timebuf, sizeof(timebuf), "%FT%T:00000000Z", gmtime(&timestamp));
+
+  /* goes to stdout, which keeps up like USB */
+  Traffic_Export_Begin(TRAFFIC_SINK_JSON, NMEA_USB);
 
   for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-    if (Container[i].addr && (this_moment - Container[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
+    if (Traffic_Hot.addr[i] && (this_moment - Traffic_Hot.timestamp[i]) <= EXPORT_EXPIRATION_TIME) {
 
       distance = Container[i].distance;
 
-      if (distance < ALARM_ZONE_NONE) {
-
-        char hexbuf[8];
-        char callsign[8+1];
-        char timebuf[32];
-        time_t timestamp = now(); /* GNSS date&time */
-
-        snprintf(hexbuf, sizeof(hexbuf), "%06X", Container[i].addr);
-
-        JsonObject& aircraft = aircraft_array.createNestedObject();
-
-        aircraft["icaoAddress"] = hexbuf; // ICAO of the aircraft
-        aircraft["trafficSource"] = 2; // 0 = 1090ES , 1 = UAT
-        aircraft["latDD"] = Container[i].latitude;  // Latitude expressed as decimal degrees
-        aircraft["lonDD"] = Container[i].longitude; // Longitude expressed as decimal degrees
-        /* Geometric altitude or barometric pressure altitude in millimeters */
-        aircraft["altitudeMM"] = (long) (Container[i].altitude * 1000);
-        /* Course over ground in centi-degrees */
-        aircraft["headingDE2"] = (int) (Container[i].course * 100);
-        /* Horizontal velocity in centimeters/sec */
-        aircraft["horVelocityCMS"] = (unsigned long) (Container[i].speed * _GPS_MPS_PER_KNOT * 100);
-        /* Vertical velocity in centimeters/sec with positive being up */
-        aircraft["verVelocityCMS"] = (long) (Container[i].vs * 100 / (_GPS_FEET_PER_METER * 60.0));
-        aircraft["squawk"] = (settings->band == RF_BAND_US ? 1200 : 7000); // VFR Squawk code
-        aircraft["altitudeType"] = 1; // Altitude Source: 0 = Pressure 1 = Geometric
-        memcpy(callsign, GDL90_CallSign_Prefix[Container[i].protocol],
-          strlen(GDL90_CallSign_Prefix[Container[i].protocol]));
-        memcpy(callsign + strlen(GDL90_CallSign_Prefix[Container[i].protocol]),
-          hexbuf, strlen(hexbuf) + 1);
-        aircraft["Callsign"] = callsign; // Callsign
-        aircraft["emitterType"] = AT_TO_GDL90(Container[i].aircraft_type); // Category type of the emitter
-        aircraft["utcSync"] = 1; // UTC time flag
-        /* Time packet was received at the pingStation ISO 8601 format: YYYY-MM-DDTHH:mm:ss:ffffffffZ */
-        strftime(timebuf, sizeof(timebuf), "%FT%T:00000000Z", gmtime(&timestamp));
-        aircraft["timeStamp"] = timebuf;
-
-        has_aircraft = true;
+      if (distance < ALARM_ZONE_NONE && Traffic_Export_Due(TRAFFIC_SINK_JSON, i)) {
+
+        /*
+         * icaoAddress    - ICAO of the aircraft
+         * trafficSource  - 0 = 1090ES , 1 = UAT
+         * latDD, lonDD   - Latitude/Longitude expressed as decimal degrees
+         * altitudeMM     - Geometric altitude or barometric pressure altitude in millimeters
+         * headingDE2     - Course over ground in centi-degrees
+         * horVelocityCMS - Horizontal velocity in centimeters/sec
+         * verVelocityCMS - Vertical velocity in centimeters/sec with positive being up
+         * squawk         - VFR Squawk code
+         * altitudeType   - Altitude Source: 0 = Pressure 1 = Geometric
+         * emitterType    - Category type of the emitter
+         * utcSync        - UTC time flag
+         */
+        int len = snprintf(object, sizeof(object),
+          "%s{\"icaoAddress\":\"%06X\",\"trafficSource\":2,"
+          "\"latDD\":%.6f,\"lonDD\":%.6f,\"altitudeMM\":%ld,"
+          "\"headingDE2\":%d,\"horVelocityCMS\":%lu,\"verVelocityCMS\":%ld,"
+          "\"squawk\":%d,\"altitudeType\":1,\"Callsign\":\"%s%06X\","
+          "\"emitterType\":%d,\"utcSync\":1,\"timeStamp\":\"%s\"}",
+          has_aircraft ? "," : "{\"aircraft\":[",
+          Container[i].addr,
+          Container[i].latitude, Container[i].longitude,
+          (long) (Container[i].altitude * 1000),
+          (int) (Container[i].course * 100),
+          (unsigned long) (Container[i].speed * _GPS_MPS_PER_KNOT * 100),
+          (long) (Container[i].vs * 100 / (_GPS_FEET_PER_METER * 60.0)),
+          (settings->band == RF_BAND_US ? 1200 : 7000),
+          GDL90_CallSign_Prefix[Container[i].protocol], Container[i].addr,
+          AT_TO_GDL90(Container[i].aircraft_type),
+          timebuf);
+
+        if (len > 0) {
+          len = len < (int) sizeof(object) ? len : sizeof(object) - 1;
+          JSON_Put(object, len);
+          Traffic_Export_Sent(TRAFFIC_SINK_JSON, i, len);
+          has_aircraft = true;
+        }
       }
     }
   }
 
   if (has_aircraft) {
-    root.printTo(buffer);
-    Serial.println(buffer);
+    JSON_Put("]}\r\n", 4);
+    JSON_Flush();
+  }
+}
+
+/* targets of the ingest parsers go straight into the traffic table by default */
+void JSON_Traffic_Store(ufo_t *fop, const uint8_t *raw, size_t size)
+{
+  if (fop->timestamp == 0) {
+    fop->timestamp = now();
   }
 
-  jsonBuffer.clear();
+  if (raw) {
+    /* Raw data has no aircraft ID - always takes a free entry */
+    ufo_t *slot = Traffic_Store(fop);
+    if (slot) {
+      Traffic_Raw_Store(slot, raw, size);
+    }
+  } else {
+    Traffic_Update(fop);
+
+    /* Update an entry with the same aircraft ID or take a free one */
+    Traffic_Store(fop);
+  }
 }
 
-void parsePING(JsonObject& root)
+/*
+ * The ingest parsers may run on a thread of their own (RPi pipeline),
+ * so they build targets in a local 'fo' rather than in the global one
+ * and leave the timestamp to the sink, TimeLib now() is not thread safe.
+ */
+void parsePING(JsonObject& root, json_traffic_t sink)
 {
   ping_aircraft_t *aircraft_array;
+  ufo_t fo;
 
   JsonArray& aircraft = root["aircraft"];
 
   int size = aircraft.size();
-  time_t timestamp = now();
+  time_t timestamp = 0; /* stamped by the sink */
 
   if (size > 0) {
     aircraft_array = (ping_aircraft_t *)
@@ -171,7 +228,6 @@ void parsePING(JsonObject& root)
           aircraft_array[i].altitudeMM != 0) {
 
         fo = EmptyFO;
-        memset(fo.raw, 0, sizeof(fo.raw));
 
 #if 0
         std::tm t = {};
@@ -215,42 +271,7 @@ void parsePING(JsonObject& root)
         fo.no_track = false;
         fo.rssi = 0;
 
-        Traffic_Update(&fo);
-
-        int j;
-
-        /* Try to find and update an entry with the same aircraft ID */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == fo.addr && Container[j].protocol == fo.protocol) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Fill a free entry if able */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == 0 &&
-             memcmp(Container[j].raw, EmptyFO.raw, sizeof(EmptyFO.raw)) == 0) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Overwrite expired entry */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (timestamp - Container[j].timestamp > ENTRY_EXPIRATION_TIME) {
-            Container[j] = fo;
-            break;
-          }
-        }
+        (*sink)(&fo, NULL, 0);
       }
     }
 
@@ -334,7 +355,59 @@ void parseTPV(JsonObject& root)
   }
 }
 
-void parseD1090(JsonObject& root)
+static bool D1090_Valid(dump1090_aircraft_t *ap)
+{
+  return ap->hex           &&
+         ap->lat      != 0.0 &&
+         ap->lon      != 0.0 &&
+         ap->altitude != 0.0;
+}
+
+static void D1090_Target(dump1090_aircraft_t *ap, json_traffic_t sink)
+{
+  ufo_t fo;
+  time_t timestamp = 0; /* stamped by the sink */
+
+  if (!D1090_Valid(ap)) {
+    return;
+  }
+
+  fo = EmptyFO;
+#if 0
+  fo.timestamp = (time_t) (var_now - ap->seen_pos);
+#else
+  fo.timestamp = timestamp;
+#endif
+  fo.protocol = RF_PROTOCOL_ADSB_1090;
+
+  /* strtoul() stops at the closing quote of a streamed 'hex' */
+  if (ap->hex[0] == '~') {
+    fo.addr = strtoul (&ap->hex[1], NULL, 16);
+    fo.addr_type = ADDR_TYPE_ANONYMOUS;
+  } else {
+    fo.addr = strtoul (&ap->hex[0], NULL, 16);
+    fo.addr_type = ADDR_TYPE_ICAO;
+  }
+
+  fo.latitude = ap->lat;
+  fo.longitude = ap->lon;
+  fo.pressure_altitude = ap->altitude / _GPS_FEET_PER_METER;
+
+  /* TBD */
+  fo.altitude = fo.pressure_altitude;
+
+  fo.course = ap->track;
+  fo.speed = ap->speed;
+  fo.aircraft_type = AIRCRAFT_TYPE_JET;
+  fo.vs = ap->vert_rate;
+  fo.stealth = false;
+  fo.no_track = false;
+  fo.rssi = ap->rssi;
+
+  (*sink)(&fo, NULL, 0);
+}
+
+void parseD1090(JsonObject& root, json_traffic_t sink)
 {
   dump1090_aircraft_t *aircraft_array;
 
@@ -344,7 +417,6 @@ void parseD1090(JsonObject& root)
   JsonArray& aircraft = root["aircraft"];
 
   int size = aircraft.size();
-  time_t timestamp = now();
 
   if (size > 0) {
     aircraft_array = (dump1090_aircraft_t *)
@@ -374,81 +446,7 @@ void parseD1090(JsonObject& root)
     }
 
     for (int i=0; i < size; i++) {
-
-      if (aircraft_array[i].hex &&
-          aircraft_array[i].lat != 0.0 &&
-          aircraft_array[i].lon != 0.0 &&
-          aircraft_array[i].altitude != 0.0) {
-
-        fo = EmptyFO;
-        memset(fo.raw, 0, sizeof(fo.raw));
-#if 0
-        fo.timestamp = (time_t) (var_now - aircraft_array[i].seen_pos);
-#else
-        fo.timestamp = timestamp;
-#endif
-        fo.protocol = RF_PROTOCOL_ADSB_1090;
-
-        if (aircraft_array[i].hex[0] == '~') {
-          fo.addr = strtoul (&aircraft_array[i].hex[1], NULL, 16);
-          fo.addr_type = ADDR_TYPE_ANONYMOUS;
-        } else {
-          fo.addr = strtoul (&aircraft_array[i].hex[0], NULL, 16);
-          fo.addr_type = ADDR_TYPE_ICAO;
-        }
-
-        fo.latitude = aircraft_array[i].lat;
-        fo.longitude = aircraft_array[i].lon;
-        fo.pressure_altitude = aircraft_array[i].altitude / _GPS_FEET_PER_METER;
-
-        /* TBD */
-        fo.altitude = fo.pressure_altitude;
-
-        fo.course = aircraft_array[i].track;
-        fo.speed = aircraft_array[i].speed;
-        fo.aircraft_type = AIRCRAFT_TYPE_JET;
-        fo.vs = aircraft_array[i].vert_rate;
-        fo.stealth = false;
-        fo.no_track = false;
-        fo.rssi = aircraft_array[i].rssi;
-
-        Traffic_Update(&fo);
-
-        int j;
-
-        /* Try to find and update an entry with the same aircraft ID */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == fo.addr && Container[j].protocol == fo.protocol) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Fill a free entry if able */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == 0 &&
-             memcmp(Container[j].raw, EmptyFO.raw, sizeof(EmptyFO.raw)) == 0) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Overwrite expired entry */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (timestamp - Container[j].timestamp > ENTRY_EXPIRATION_TIME) {
-            Container[j] = fo;
-            break;
-          }
-        }
-      }
+      D1090_Target(&aircraft_array[i], sink);
     }
 
 #if 0
@@ -474,13 +472,304 @@ void parseD1090(JsonObject& root)
   }
 }
 
-void parseRAW(JsonObject& root)
+/*
+ * parseD1090_Stream() walks a dump1090 'aircraft.json' document in place,
+ * SAX style. An aircraft object is taken as soon as its closing brace is
+ * seen and goes into one dump1090_aircraft_t, strings are left in the
+ * document. Objects which are out of 'range' metres of (lat, lon) are
+ * dropped before a ufo_t is built, range 0 takes all of them. Memory use
+ * does not depend on the size of the document.
+ *
+ * 'str' has to be NUL terminated. Returns false, with no target delivered,
+ * when this is not a dump1090 document ("now" and "messages" ahead of
+ * "aircraft"), the caller hands those to the DOM parsers. A NULL 'sink'
+ * recognises the document and drops all of it.
+ */
+typedef struct {
+  const char *p;
+  const char *end;
+} json_scan_t;
+
+#define JSON_KEY_IS(s, n, k)  ((n) == sizeof(k) - 1 && !memcmp((s), (k), (n)))
+#define JSON_METERS_PER_DEG   111195.0 /* of latitude */
+
+static char JSON_Scan_Peek(json_scan_t *s)
+{
+  while (s->p < s->end && isspace((unsigned char) *s->p)) {
+    s->p++;
+  }
+
+  return s->p < s->end ? *s->p : '\0';
+}
+
+static bool JSON_Scan_Char(json_scan_t *s, char c)
+{
+  if (JSON_Scan_Peek(s) != c) {
+    return false;
+  }
+  s->p++;
+
+  return true;
+}
+
+/* contents of a string, escapes are stepped over but not decoded */
+static bool JSON_Scan_String(json_scan_t *s, const char **str, size_t *len)
+{
+  if (!JSON_Scan_Char(s, '"')) {
+    return false;
+  }
+
+  *str = s->p;
+
+  while (s->p < s->end && *s->p != '"') {
+    if (*s->p == '\\') {
+      s->p++;
+    }
+    s->p++;
+  }
+
+  if (s->p >= s->end) {
+    return false;
+  }
+
+  *len = s->p - *str;
+  s->p++;
+
+  return true;
+}
+
+/* any value, nested ones are counted through rather than recursed into */
+static bool JSON_Scan_Skip(json_scan_t *s)
+{
+  const char *str;
+  size_t len;
+  int depth = 0;
+
+  do {
+    char c = JSON_Scan_Peek(s);
+
+    switch (c)
+    {
+    case '"':
+      if (!JSON_Scan_String(s, &str, &len)) {
+        return false;
+      }
+      break;
+    case '{':
+    case '[':
+      depth++;
+      s->p++;
+      break;
+    case '}':
+    case ']':
+      if (--depth < 0) {
+        return false;
+      }
+      s->p++;
+      break;
+    case ',':
+    case ':':
+      if (depth == 0) {
+        return false;
+      }
+      s->p++;
+      break;
+    case '\0':
+      return false;
+    default:
+      while (s->p < s->end && !strchr(",:{}[]\" \t\r\n", *s->p)) {
+        s->p++;
+      }
+      break;
+    }
+  } while (depth > 0);
+
+  return true;
+}
+
+/* a non-numeric value ("altitude":"ground") is skipped and reads as 0 */
+static bool JSON_Scan_Number(json_scan_t *s, float *val)
+{
+  char *last;
+
+  JSON_Scan_Peek(s);
+  *val = strtof(s->p, &last);
+
+  if (last == s->p || last > s->end) {
+    *val = 0;
+    return JSON_Scan_Skip(s);
+  }
+  s->p = last;
+
+  return true;
+}
+
+static bool JSON_Scan_Key(json_scan_t *s, const char **key, size_t *len)
 {
+  return JSON_Scan_String(s, key, len) && JSON_Scan_Char(s, ':');
+}
+
+/* ',' ahead of another member or element, or the closing bracket */
+static bool JSON_Scan_Next(json_scan_t *s, char close, bool *more)
+{
+  if (JSON_Scan_Char(s, ',')) {
+    *more = true;
+    return true;
+  }
+  *more = false;
+
+  return JSON_Scan_Char(s, close);
+}
+
+static bool D1090_Scan_Aircraft(json_scan_t *s, dump1090_aircraft_t *ap)
+{
+  const char *key;
+  size_t len;
+  bool more;
+  float val;
+
+  memset(ap, 0, sizeof(dump1090_aircraft_t));
+
+  if (!JSON_Scan_Char(s, '{')) {
+    return false;
+  }
+  if (JSON_Scan_Char(s, '}')) {
+    return true;
+  }
+
+  do {
+    if (!JSON_Scan_Key(s, &key, &len)) {
+      return false;
+    }
+
+    if (JSON_KEY_IS(key, len, "hex")) {
+      const char *hex;
+      size_t hex_len;
+
+      if (JSON_Scan_Peek(s) != '"') {
+        if (!JSON_Scan_Skip(s)) return false;
+      } else {
+        if (!JSON_Scan_String(s, &hex, &hex_len)) return false;
+        ap->hex = hex_len > 0 ? hex : NULL;
+      }
+    } else if (JSON_KEY_IS(key, len, "lat")) {
+      if (!JSON_Scan_Number(s, &ap->lat)) return false;
+    } else if (JSON_KEY_IS(key, len, "lon")) {
+      if (!JSON_Scan_Number(s, &ap->lon)) return false;
+    } else if (JSON_KEY_IS(key, len, "altitude")) {
+      if (!JSON_Scan_Number(s, &val)) return false;
+      ap->altitude = val;
+    } else if (JSON_KEY_IS(key, len, "vert_rate")) {
+      if (!JSON_Scan_Number(s, &val)) return false;
+      ap->vert_rate = val;
+    } else if (JSON_KEY_IS(key, len, "track")) {
+      if (!JSON_Scan_Number(s, &val)) return false;
+      ap->track = val;
+    } else if (JSON_KEY_IS(key, len, "speed")) {
+      if (!JSON_Scan_Number(s, &val)) return false;
+      ap->speed = val;
+    } else if (JSON_KEY_IS(key, len, "rssi")) {
+      if (!JSON_Scan_Number(s, &ap->rssi)) return false;
+    } else {
+      if (!JSON_Scan_Skip(s)) return false;
+    }
+
+    if (!JSON_Scan_Next(s, '}', &more)) {
+      return false;
+    }
+  } while (more);
+
+  return true;
+}
+
+/* flat earth is good enough to tell 'near' from 'far' */
+static bool D1090_In_Range(dump1090_aircraft_t *ap,
+                           float lat, float lon, float range)
+{
+  float dlon = ap->lon - lon;
+
+  if (range <= 0) {
+    return true;
+  }
+
+  if (dlon >  180.0) dlon -= 360.0;
+  if (dlon < -180.0) dlon += 360.0;
+
+  float north = (ap->lat - lat) * JSON_METERS_PER_DEG;
+  float east  = dlon * JSON_METERS_PER_DEG * cosf(radians(lat));
+
+  return north * north + east * east < range * range;
+}
+
+bool parseD1090_Stream(const char *str, size_t len,
+                       float lat, float lon, float range,
+                       json_traffic_t sink)
+{
+  json_scan_t s = { str, str + len };
+  dump1090_aircraft_t aircraft;
+  bool has_now = false;
+  bool has_messages = false;
+  const char *key;
+  size_t key_len;
+  bool more = true;
+
+  if (!JSON_Scan_Char(&s, '{')) {
+    return false;
+  }
+
+  do {
+    if (!JSON_Scan_Key(&s, &key, &key_len)) {
+      return false;
+    }
+
+    if (JSON_KEY_IS(key, key_len, "aircraft")) {
+      break;
+    } else if (JSON_KEY_IS(key, key_len, "now")) {
+      has_now = true;
+    } else if (JSON_KEY_IS(key, key_len, "messages")) {
+      has_messages = true;
+    }
+
+    if (!JSON_Scan_Skip(&s) || !JSON_Scan_Next(&s, '}', &more)) {
+      return false;
+    }
+  } while (more);
+
+  if (!more || !has_now || !has_messages || !JSON_Scan_Char(&s, '[')) {
+    return false;
+  }
+
+  /*
+   * From here on the document is taken as dump1090 output. A syntax error
+   * ends the walk, aircraft ahead of it have been delivered already.
+   */
+  if (JSON_Scan_Char(&s, ']')) {
+    return true;
+  }
+
+  do {
+    if (!D1090_Scan_Aircraft(&s, &aircraft)) {
+      break;
+    }
+
+    if (sink && D1090_Valid(&aircraft) &&
+        D1090_In_Range(&aircraft, lat, lon, range)) {
+      D1090_Target(&aircraft, sink);
+    }
+  } while (JSON_Scan_Next(&s, ']', &more) && more);
+
+  return true;
+}
+
+void parseRAW(JsonObject& root, json_traffic_t sink)
+{
+  ufo_t fo;
+  uint8_t fo_raw[RAW_DATA_SIZE];
 
   JsonArray& rawdata = root["rawdata"];
 
   int size = rawdata.size();
-  time_t timestamp = now();
+  time_t timestamp = 0; /* stamped by the sink */
 
   if (size > 0) {
 
@@ -495,49 +784,31 @@ void parseRAW(JsonObject& root)
           data_len = 2 * MAX_PKT_SIZE;
         }
 
-        if (data_len > 2 * sizeof(fo.raw)) {
-          data_len = 2 * sizeof(fo.raw);
+        if (data_len > 2 * sizeof(fo_raw)) {
+          data_len = 2 * sizeof(fo_raw);
         }
 
+        memset(fo_raw, 0, sizeof(fo_raw));
+
         for(int j = 0; j < data_len ; j+=2)
         {
-          fo.raw[j>>1] = getVal(data[j+1]) + (getVal(data[j]) << 4);
+          fo_raw[j>>1] = getVal(data[j+1]) + (getVal(data[j]) << 4);
         }
 
         fo.timestamp = timestamp;
         fo.protocol = RF_PROTOCOL_ADSB_1090;
 
-        int j;
-
-        /* Fill a free entry if able */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == 0 &&
-             memcmp(Container[j].raw, EmptyFO.raw, sizeof(EmptyFO.raw)) == 0) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Overwrite expired entry */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (timestamp - Container[j].timestamp > ENTRY_EXPIRATION_TIME) {
-            Container[j] = fo;
-            break;
-          }
-        }
+        (*sink)(&fo, fo_raw, (data_len + 1) / 2);
       }
     }
 
 #if 0
     for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      if (memcmp(Container[i].raw, EmptyFO.raw, sizeof(EmptyFO.raw)) != 0) {
+      uint8_t *raw = Traffic_Raw(&Container[i]);
+      if (raw) {
         size_t size = RF_Payload_Size(settings->rf_protocol);
-        size = size > sizeof(Container[i].raw) ? sizeof(Container[i].raw) : size;
-        String str = Bin2Hex(Container[i].raw, size);
+        size = size > RAW_DATA_SIZE ? RAW_DATA_SIZE : size;
+        String str = Bin2Hex(raw, size);
         printf("%s\n", str.c_str());
       }
     }
@@ -30,6 +30,9 @@
 #endif /* RASPBERRY_PI */
 
 #define JSON_BUFFER_SIZE  65536
+#define JSON_CHUNK_SIZE     1024 /* output of JSON_Export() leaves in chunks of this size */
+#define JSON_AIRCRAFT_SIZE  384  /* longest "aircraft" object of a PING report */
+#define JSON_D1090_RANGE    (ALARM_ZONE_NONE + 2000) /* metres, farther dump1090 targets are dropped on ingest */
 #define isValidGPSDFix() (hasValidGPSDFix)
 
 enum
@@ -75,6 +78,9 @@ struct ping_aircraft_struct {
 typedef  struct dump1090_aircraft_struct dump1090_aircraft_t;
 typedef  struct ping_aircraft_struct ping_aircraft_t;
 
+/* where parseD1090(), parsePING() and parseRAW() deliver a target, raw is NULL unless from parseRAW() */
+typedef void (*json_traffic_t)(ufo_t *, const uint8_t *, size_t);
+
 extern StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
 extern bool hasValidGPSDFix;
 
@@ -82,9 +88,11 @@ extern void JSON_Export();
 extern void parseTPV(JsonObject&);
 extern void parseSettings(JsonObject&);
 extern void parseUISettings(JsonObject&);
-extern void parseD1090(JsonObject&);
-extern void parsePING(JsonObject&);
-extern void parseRAW(JsonObject&);
+extern void parseD1090(JsonObject&, json_traffic_t);
+extern void parsePING(JsonObject&, json_traffic_t);
+extern void parseRAW(JsonObject&, json_traffic_t);
+extern bool parseD1090_Stream(const char *, size_t, float, float, float, json_traffic_t);
+extern void JSON_Traffic_Store(ufo_t *, const uint8_t *, size_t);
 extern byte getVal(char);
 
 #endif /* JSONHELPER_H */
\ No newline at end of file
@@ -59,7 +59,7 @@ void MAVLinkShareTraffic()
     time_t this_moment = now();
 
     for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      if (Container[i].addr && (this_moment - Container[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
+      if (Traffic_Hot.addr[i] && (this_moment - Traffic_Hot.timestamp[i]) <= EXPORT_EXPIRATION_TIME) {
 
         char hexbuf[8];
         char callsign[8+1];
@@ -28,8 +28,6 @@
 #include "../../driver/Baro.h"
 #include "../../TrafficHelper.h"
 
-#define ADDR_TO_HEX_STR(s, c) (s += ((c) < 0x10 ? "0" : "") + String((c), HEX))
-
 #if defined(NMEA_TCP_SERVICE)
 WiFiServer NmeaTCPServer(NMEA_TCP_PORT);
 NmeaTCP_t NmeaTCP[MAX_NMEATCP_CLIENTS];
@@ -37,7 +35,17 @@ NmeaTCP_t NmeaTCP[MAX_NMEATCP_CLIENTS];
 
 char NMEABuffer[NMEA_BUFFER_SIZE]; //buffer for NMEA data
 
-static char NMEA_Callsign[NMEA_CALLSIGN_SIZE];
+/* callsign substitute of a slot, made once per target */
+typedef struct nmea_callsign_struct {
+  uint32_t addr;
+  uint8_t  protocol;
+  char     name[NMEA_CALLSIGN_SIZE];
+} nmea_callsign_t;
+
+static nmea_callsign_t NMEA_Callsign[MAX_TRACKING_OBJECTS];
+
+static char   NMEA_Batch[NMEA_BATCH_SIZE];
+static size_t NMEA_Batch_Len = 0;
 
 #if defined(USE_NMEALIB)
 #include <nmealib.h>
@@ -66,16 +74,6 @@ extern uint32_t tx_packets_counter, rx_packets_counter;
 unsigned long RPYL_TimeMarker = 0;
 #endif /* ENABLE_AHRS */
 
-static char *ltrim(char *s)
-{
-  if(s) {
-    while(*s && isspace(*s))
-      ++s;
-  }
-
-  return s;
-}
-
 void NMEA_add_checksum(char *buf, size_t limit)
 {
   size_t sentence_size = strlen(buf);
@@ -90,6 +88,142 @@ void NMEA_add_checksum(char *buf, size_t limit)
   snprintf_P(csum_ptr, limit, PSTR("%02X\r\n"), cs);
 }
 
+/*
+ * Single pass sentence writer: fields are appended in place
+ * and the XOR checksum is carried along, no printf and no heap.
+ */
+typedef struct nmea_writer_struct {
+  char    *buf;
+  size_t  size;
+  size_t  len;
+  uint8_t cs;
+} nmea_writer_t;
+
+#define NMEA_TAIL_SIZE  6 /* "*HH\r\n" and NUL */
+
+static const char NMEA_Hex[] = "0123456789ABCDEF";
+
+static inline void NMEA_Put_Char(nmea_writer_t *w, char c)
+{
+  if (w->len < w->size) {
+    w->buf[w->len++] = c;
+    w->cs ^= (uint8_t) c;
+  }
+}
+
+static void NMEA_Put_Str(nmea_writer_t *w, const char *s, size_t n)
+{
+  while (n-- && *s) {
+    NMEA_Put_Char(w, *s++);
+  }
+}
+
+static void NMEA_Put_Int(nmea_writer_t *w, long val)
+{
+  char digits[10];
+  int n = 0;
+  unsigned long u = val < 0 ? 0UL - (unsigned long) val : (unsigned long) val;
+
+  if (val < 0) {
+    NMEA_Put_Char(w, '-');
+  }
+  do {
+    digits[n++] = '0' + (u % 10);
+    u /= 10;
+  } while (u);
+
+  while (n) {
+    NMEA_Put_Char(w, digits[--n]);
+  }
+}
+
+static void NMEA_Put_Hex(nmea_writer_t *w, uint32_t val, int width)
+{
+  while (width--) {
+    NMEA_Put_Char(w, NMEA_Hex[(val >> (width * 4)) & 0xF]);
+  }
+}
+
+/* fixed point value with one decimal, given in tenths */
+static void NMEA_Put_Tenths(nmea_writer_t *w, long val)
+{
+  if (val < 0) {
+    NMEA_Put_Char(w, '-');
+    val = -val;
+  }
+  NMEA_Put_Int(w, val / 10);
+  NMEA_Put_Char(w, '.');
+  NMEA_Put_Char(w, '0' + (val % 10));
+}
+
+/* account for 'n' chars that snprintf() has placed at the tail */
+static void NMEA_Put_Raw(nmea_writer_t *w, int n)
+{
+  if (n <= 0 || w->len >= w->size) {
+    return;
+  }
+  if ((size_t) n > w->size - w->len - 1) {
+    n = w->size - w->len - 1;
+  }
+  while (n--) {
+    w->cs ^= (uint8_t) w->buf[w->len++];
+  }
+}
+
+static void NMEA_Begin(nmea_writer_t *w, char *buf, size_t size, const char *name)
+{
+  w->buf  = buf;
+  w->size = size - NMEA_TAIL_SIZE;
+  w->len  = 0;
+  w->cs   = 0;
+
+  w->buf[w->len++] = '$';
+  NMEA_Put_Str(w, name, size);
+}
+
+static size_t NMEA_End(nmea_writer_t *w)
+{
+  char *p = w->buf + w->len;
+
+  *p++ = '*';
+  *p++ = NMEA_Hex[w->cs >> 4];
+  *p++ = NMEA_Hex[w->cs & 0xF];
+  *p++ = '\r';
+  *p++ = '\n';
+  *p   = '\0';
+
+  w->len += NMEA_TAIL_SIZE - 1;
+
+  return w->len;
+}
+
+/*
+ * When callsign is not available - generate a callsign substitute,
+ * based upon a protocol ID and the ICAO address
+ */
+static const char *NMEA_Callsign_Get(int ndx)
+{
+  ufo_t *fop = &Container[ndx];
+  nmea_callsign_t *cs = &NMEA_Callsign[ndx];
+
+  if (cs->name[0] == '\0' || cs->addr != fop->addr || cs->protocol != fop->protocol) {
+    const char *prefix = NMEA_CallSign_Prefix[fop->protocol];
+    size_t len = strlen(prefix);
+
+    memcpy(cs->name, prefix, len);
+    cs->name[len++] = '_';
+    for (int shift = 20; shift >= 0; shift -= 4) {
+      cs->name[len++] = NMEA_Hex[(fop->addr >> shift) & 0xF];
+    }
+    cs->name[len] = '\0';
+
+    cs->addr     = fop->addr;
+    cs->protocol = fop->protocol;
+  }
+
+  return cs->name;
+}
+
 void NMEA_setup()
 {
 #if defined(NMEA_TCP_SERVICE)
@@ -210,36 +344,25 @@ void NMEA_fini()
 #endif /* NMEA_TCP_SERVICE */
 }
 
-void NMEA_Out(uint8_t dest, byte *buf, size_t size, bool nl)
+/* pieces of 'iov' leave as one datagram, or one write per piece at most */
+static void NMEA_Write(uint8_t dest, byte *buf, size_t size)
 {
+  Traffic_Export_Out(dest, size);
+
   switch (dest)
   {
   case NMEA_UART:
     {
       if (SoC->UART_ops) {
         SoC->UART_ops->write(buf, size);
-        if (nl)
-          SoC->UART_ops->write((byte *) "\n", 1);
       } else {
         SerialOutput.write(buf, size);
-        if (nl)
-          SerialOutput.write('\n');
       }
     }
     break;
   case NMEA_UDP:
     {
-      size_t udp_size = size;
-
-      if (size >= sizeof(UDPpacketBuffer))
-        udp_size = sizeof(UDPpacketBuffer) - 1;
-      memcpy(UDPpacketBuffer, buf, udp_size);
-
-      if (nl)
-        UDPpacketBuffer[udp_size] = '\n';
-
-      SoC->WiFi_transmit_UDP(NMEA_UDP_PORT, (byte *) UDPpacketBuffer,
-                              nl ? udp_size + 1 : udp_size);
+      SoC->WiFi_transmit_UDP(NMEA_UDP_PORT, buf, size);
     }
     break;
   case NMEA_TCP:
@@ -249,8 +372,6 @@ void NMEA_Out(uint8_t dest, byte *buf, size_t size, bool nl)
         if (NmeaTCP[acc_ndx].client && NmeaTCP[acc_ndx].client.connected()){
           if (NmeaTCP[acc_ndx].ack) {
             NmeaTCP[acc_ndx].client.write(buf, size);
-            if (nl)
-              NmeaTCP[acc_ndx].client.write('\n');
           }
         }
       }
@@ -261,8 +382,6 @@ void NMEA_Out(uint8_t dest, byte *buf, size_t size, bool nl)
     {
       if (SoC->USB_ops) {
         SoC->USB_ops->write(buf, size);
-        if (nl)
-          SoC->USB_ops->write((byte *) "\n", 1);
       }
     }
     break;
@@ -270,8 +389,6 @@ void NMEA_Out(uint8_t dest, byte *buf, size_t size, bool nl)
     {
       if (SoC->Bluetooth_ops) {
         SoC->Bluetooth_ops->write(buf, size);
-        if (nl)
-          SoC->Bluetooth_ops->write((byte *) "\n", 1);
       }
     }
     break;
@@ -281,6 +398,53 @@ void NMEA_Out(uint8_t dest, byte *buf, size_t size, bool nl)
   }
 }
 
+void NMEA_Out(uint8_t dest, byte *buf, size_t size, bool nl)
+{
+  /* a pass-through line goes out with its newline in one write */
+  if (nl && NMEA_Batch_Len == 0 && size < sizeof(NMEA_Batch)) {
+    memcpy(NMEA_Batch, buf, size);
+    NMEA_Batch[size] = '\n';
+    NMEA_Write(dest, (byte *) NMEA_Batch, size + 1);
+    return;
+  }
+
+  NMEA_Write(dest, buf, size);
+  if (nl) {
+    NMEA_Write(dest, (byte *) "\n", 1);
+  }
+}
+
+static void NMEA_Batch_Flush(uint8_t dest)
+{
+  if (NMEA_Batch_Len > 0) {
+    NMEA_Out(dest, (byte *) NMEA_Batch, NMEA_Batch_Len, false);
+    NMEA_Batch_Len = 0;
+  }
+}
+
+/* queue a complete sentence, the batch goes out early when it is full */
+static void NMEA_Batch_Add(uint8_t dest, const char *sentence)
+{
+  size_t len = strlen(sentence);
+
+  if (NMEA_Batch_Len + len > sizeof(NMEA_Batch)) {
+    NMEA_Batch_Flush(dest);
+  }
+
+  memcpy(NMEA_Batch + NMEA_Batch_Len, sentence, len);
+  NMEA_Batch_Len += len;
+}
+
+/* room for a sentence to be written in place at the end of the batch */
+static char *NMEA_Batch_Tail(uint8_t dest, size_t size)
+{
+  if (NMEA_Batch_Len + size > sizeof(NMEA_Batch)) {
+    NMEA_Batch_Flush(dest);
+  }
+
+  return NMEA_Batch + NMEA_Batch_Len;
+}
+
 void NMEA_Export()
 {
     int bearing;
@@ -300,10 +464,15 @@ void NMEA_Export()
     uint32_t HP_addr   = 0;
 
     bool has_Fix       = isValidFix() || (settings->mode == SOFTRF_MODE_TXRX_TEST);
+    bool alarm_sent    = false;
+
+    Traffic_Export_Begin(TRAFFIC_SINK_NMEA, settings->nmea_out);
 
     if (has_Fix) {
+      Traffic_Extrapolate();
+
       for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-        if (Container[i].addr && (this_moment - Container[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
+        if (Traffic_Hot.addr[i] && (this_moment - Traffic_Hot.timestamp[i]) <= EXPORT_EXPIRATION_TIME) {
 
 #if 0
           Serial.println(fo.addr);
@@ -323,60 +492,71 @@ void NMEA_Export()
 
               total_objects++;
 
-              char str_climb_rate[8] = "";
-              uint8_t addr_type = Container[i].addr_type > ADDR_TYPE_ANONYMOUS ?
-                                  ADDR_TYPE_ANONYMOUS : Container[i].addr_type;
-
               bearing = Container[i].bearing;
               alarm_level = Container[i].alarm_level;
               alt_diff = (int) (Container[i].altitude - ThisAircraft.altitude);
 
-              if (!Container[i].stealth && !ThisAircraft.stealth) {
-                dtostrf(
-                  constrain(Container[i].vs / (_GPS_FEET_PER_METER * 60.0), -32.7, 32.7),
-                  5, 1, str_climb_rate);
+              if (Traffic_Export_Due(TRAFFIC_SINK_NMEA, i)) {
+                nmea_writer_t w;
+                uint8_t addr_type = Container[i].addr_type > ADDR_TYPE_ANONYMOUS ?
+                                    ADDR_TYPE_ANONYMOUS : Container[i].addr_type;
+
+                data_source = Traffic_Position_Source(&Container[i]) == RF_PROTOCOL_ADSB_UAT ?
+                              DATA_SOURCE_ADSB : DATA_SOURCE_FLARM;
+
+                NMEA_Begin(&w, NMEA_Batch_Tail(settings->nmea_out, NMEA_BUFFER_SIZE),
+                           NMEA_BUFFER_SIZE, "PFLAA,");
+
+                NMEA_Put_Int(&w, alarm_level);
+                NMEA_Put_Char(&w, ',');
+                NMEA_Put_Int(&w, (int) (distance * cos(radians(bearing))));
+                NMEA_Put_Char(&w, ',');
+                NMEA_Put_Int(&w, (int) (distance * sin(radians(bearing))));
+                NMEA_Put_Char(&w, ',');
+                NMEA_Put_Int(&w, alt_diff);
+                NMEA_Put_Char(&w, ',');
+                NMEA_Put_Int(&w, addr_type);
+                NMEA_Put_Char(&w, ',');
+                NMEA_Put_Hex(&w, Container[i].addr, 6);
+                NMEA_Put_Char(&w, '!');
+
+                /* When callsign is available - send it to a NMEA client */
+                if (Container[i].callsign[0]) {
+                  NMEA_Put_Str(&w, (char *) Container[i].callsign,
+                               sizeof(Container[i].callsign));
+                } else {
+                  NMEA_Put_Str(&w, NMEA_Callsign_Get(i), NMEA_CALLSIGN_SIZE);
+                }
+
+                NMEA_Put_Char(&w, ',');
+                NMEA_Put_Int(&w, (int) Container[i].course);
+                NMEA_Put_Str(&w, ",,", 2);
+                NMEA_Put_Int(&w, (int) (Container[i].speed * _GPS_MPS_PER_KNOT));
+                NMEA_Put_Char(&w, ',');
+
+                if (!Container[i].stealth && !ThisAircraft.stealth) {
+                  NMEA_Put_Tenths(&w, lround(
+                    constrain(Container[i].vs / (_GPS_FEET_PER_METER * 6.0), -327, 327)));
+                }
+
+                NMEA_Put_Char(&w, ',');
+                NMEA_Put_Int(&w, Container[i].aircraft_type);
+
+                if (sizeof(PFLAA_EXT1_FMT) > 1) {
+                  NMEA_Put_Raw(&w, snprintf_P(w.buf + w.len, w.size - w.len,
+                                              PSTR(PFLAA_EXT1_FMT) PFLAA_EXT1_ARGS));
+                }
+
+                size_t len = NMEA_End(&w);
+
+                NMEA_Batch_Len += len;
+                Traffic_Export_Sent(TRAFFIC_SINK_NMEA, i, len);
+
+                if (alarm_level > ALARM_LEVEL_NONE) {
+                  alarm_sent = true;
+                }
               }
 
-              /*
-               * When callsign is available - send it to a NMEA client.
-               * If it is not - generate a callsign substitute,
-               * based upon a protocol ID and the ICAO address
-               */
-              memset((void *) NMEA_Callsign, 0, sizeof(NMEA_Callsign));
-
-              if (strnlen((char *) Container[i].callsign, sizeof(Container[i].callsign)) > 0) {
-                memcpy(NMEA_Callsign, Container[i].callsign, sizeof(Container[i].callsign));
-              } else {
-                memcpy(NMEA_Callsign, NMEA_CallSign_Prefix[Container[i].protocol],
-                  strlen(NMEA_CallSign_Prefix[Container[i].protocol]));
-
-                String str = "_";
-
-                ADDR_TO_HEX_STR(str, (Container[i].addr >> 16) & 0xFF);
-                ADDR_TO_HEX_STR(str, (Container[i].addr >>  8) & 0xFF);
-                ADDR_TO_HEX_STR(str, (Container[i].addr      ) & 0xFF);
-
-                str.toUpperCase();
-                memcpy(NMEA_Callsign + strlen(NMEA_CallSign_Prefix[Container[i].protocol]),
-                  str.c_str(), str.length());
-              }
-
-              data_source = Container[i].protocol == RF_PROTOCOL_ADSB_UAT ?
-                            DATA_SOURCE_ADSB : DATA_SOURCE_FLARM;
-
-              snprintf_P(NMEABuffer, sizeof(NMEABuffer),
-                      PSTR("$PFLAA,%d,%d,%d,%d,%d,%06X!%s,%d,,%d,%s,%d" PFLAA_EXT1_FMT "*"),
-                      alarm_level,
-                      (int) (distance * cos(radians(bearing))), (int) (distance * sin(radians(bearing))),
-                      alt_diff, addr_type, Container[i].addr, NMEA_Callsign,
-                      (int) Container[i].course, (int) (Container[i].speed * _GPS_MPS_PER_KNOT),
-                      ltrim(str_climb_rate), Container[i].aircraft_type
-                      PFLAA_EXT1_ARGS );
-
-              NMEA_add_checksum(NMEABuffer, sizeof(NMEABuffer) - strlen(NMEABuffer));
-
-              NMEA_Out(settings->nmea_out, (byte *) NMEABuffer, strlen(NMEABuffer), false);
-
               /* Most close traffic is treated as highest priority target */
               if (distance < HP_distance && abs(alt_diff) < VERTICAL_VISIBILITY_RANGE) {
                 HP_bearing = bearing;
@@ -392,8 +572,11 @@ void NMEA_Export()
       }
     }
 
-    /* One PFLAU NMEA sentence is mandatory regardless of traffic reception status */
-    if (settings->nmea_l) {
+    /*
+     * One PFLAU NMEA sentence is mandatory regardless of traffic reception status,
+     * it also goes out with every report of a target in alarm
+     */
+    if (settings->nmea_l && (Traffic_Export_Beat() || alarm_sent)) {
       float voltage    = Battery_voltage();
       int power_status = voltage > BATTERY_THRESHOLD_INVALID &&
                          voltage < Battery_threshold() ?
@@ -423,8 +606,10 @@ void NMEA_Export()
 
       NMEA_add_checksum(NMEABuffer, sizeof(NMEABuffer) - strlen(NMEABuffer));
 
-      NMEA_Out(settings->nmea_out, (byte *) NMEABuffer, strlen(NMEABuffer), false);
+      NMEA_Batch_Add(settings->nmea_out, NMEABuffer);
     }
+
+    NMEA_Batch_Flush(settings->nmea_out);
 }
 
 #if defined(USE_NMEALIB)
@@ -32,6 +32,11 @@ enum
 };
 
 #define NMEA_BUFFER_SIZE    128
+
+/* PFLAA and PFLAU sentences of one export cycle are sent with a single write */
+#if !defined(NMEA_BATCH_SIZE)
+#define NMEA_BATCH_SIZE     1024 /* fits into one UDP datagram */
+#endif /* NMEA_BATCH_SIZE */
 #define NMEA_CALLSIGN_SIZE  (3 /* prefix */ + 1 /* _ */ + 6 /* ICAO */ + 1 /* EOL */)
 
 #define PSRFC_VERSION       1
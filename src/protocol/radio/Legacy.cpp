@@ -122,6 +122,41 @@ void make_key(uint32_t key[4], uint32_t timestamp, uint32_t address) {
     }
 }
 
+/*
+ * Direct mapped cache of derived keys. The key is a function of
+ * (timestamp >> 6) and the address only, so an entry is good until
+ * the 64 seconds epoch rolls over.
+ */
+typedef struct {
+    bool     valid;
+    uint32_t epoch;
+    uint32_t address;
+    uint32_t key[4];
+} legacy_key_t;
+
+#if defined(RASPBERRY_PI)
+/* frames are decoded by the RX pipeline worker and encoded by the main thread */
+static __thread legacy_key_t legacy_keys[LEGACY_KEY_CACHE_SIZE];
+#else
+static legacy_key_t legacy_keys[LEGACY_KEY_CACHE_SIZE];
+#endif /* RASPBERRY_PI */
+
+static const uint32_t *legacy_key(uint32_t timestamp, uint32_t address) {
+    uint32_t epoch = timestamp >> 6;
+    /* low octet of the "address" argument is always zero */
+    legacy_key_t *kp = &legacy_keys[((address >> 8) ^ (address >> 16)) %
+                                    LEGACY_KEY_CACHE_SIZE];
+
+    if (!kp->valid || kp->epoch != epoch || kp->address != address) {
+        make_key(kp->key, timestamp, address);
+        kp->epoch   = epoch;
+        kp->address = address;
+        kp->valid   = true;
+    }
+
+    return kp->key;
+}
+
 bool legacy_decode(void *legacy_pkt, ufo_t *this_aircraft, ufo_t *fop) {
 
     legacy_packet_t *pkt = (legacy_packet_t *) legacy_pkt;
@@ -131,12 +166,11 @@ bool legacy_decode(void *legacy_pkt, ufo_t *this_aircraft, ufo_t *fop) {
     float geo_separ = this_aircraft->geoid_separation;
     uint32_t timestamp = (uint32_t) this_aircraft->timestamp;
 
-    uint32_t key[4];
     int ndx;
     uint8_t pkt_parity=0;
 
-    make_key(key, timestamp, (pkt->addr << 8) & 0xffffff);
-    btea((uint32_t *) pkt + 1, -5, key);
+    btea((uint32_t *) pkt + 1, -5,
+         legacy_key(timestamp, (pkt->addr << 8) & 0xffffff));
 
     for (ndx = 0; ndx < sizeof (legacy_packet_t); ndx++) {
       pkt_parity += parity(*(((unsigned char *) pkt) + ndx));
@@ -195,6 +229,7 @@ bool legacy_decode(void *legacy_pkt, ufo_t *this_aircraft, ufo_t *fop) {
     fop->ns[2] = pkt->ns[2]; fop->ns[3] = pkt->ns[3];
     fop->ew[0] = pkt->ew[0]; fop->ew[1] = pkt->ew[1];
     fop->ew[2] = pkt->ew[2]; fop->ew[3] = pkt->ew[3];
+    fop->smult = pkt->smult;
 
     return true;
 }
@@ -205,7 +240,7 @@ size_t legacy_encode(void *legacy_pkt, ufo_t *this_aircraft) {
 
     int ndx;
     uint8_t pkt_parity=0;
-    uint32_t key[4];
+    const uint32_t *key;
 
     uint32_t id = this_aircraft->addr;
     float lat = this_aircraft->latitude;
@@ -278,7 +313,7 @@ size_t legacy_encode(void *legacy_pkt, ufo_t *this_aircraft) {
 
     pkt->parity = (pkt_parity % 2);
 
-    make_key(key, timestamp , (pkt->addr << 8) & 0xffffff);
+    key = legacy_key(timestamp , (pkt->addr << 8) & 0xffffff);
 
 #if 0
     Serial.print(key[0]);   Serial.print(", ");
@@ -39,6 +39,17 @@
 #define LEGACY_KEY2 0x045d9f3b
 #define LEGACY_KEY3 0x87b562f4
 
+/* XXTEA keys are constant for 64 seconds per sender */
+#if !defined(LEGACY_KEY_CACHE_SIZE)
+#if defined(RASPBERRY_PI)
+#define LEGACY_KEY_CACHE_SIZE  64
+#elif defined(ARDUINO_ARCH_AVR)
+#define LEGACY_KEY_CACHE_SIZE  2
+#else
+#define LEGACY_KEY_CACHE_SIZE  16
+#endif
+#endif /* LEGACY_KEY_CACHE_SIZE */
+
 /* FTD-12 Version: 7.00 */
 enum
 {
@@ -144,6 +144,93 @@ bool ogntp_decode(void *pkt, ufo_t *this_aircraft, ufo_t *fop) {
   return true;
 }
 
+#define OGNTP_LDPC_BITS       ((OGNTP_PAYLOAD_SIZE + OGNTP_CRC_SIZE) * 8)
+#define OGNTP_LDPC_CHECKS     (OGNTP_CRC_SIZE * 8)
+#define OGNTP_LDPC_WORDS      ((OGNTP_LDPC_BITS + 31) / 32)
+
+static inline uint32_t ogntp_parity_check(uint8_t row, uint8_t word)
+{
+#if defined(__AVR__)
+  return pgm_read_dword(&LDPC_ParityCheck_n208k160[row][word]);
+#else
+  return LDPC_ParityCheck_n208k160[row][word];
+#endif
+}
+
+/*
+ * Hard decision (Gallager B style) bit flipping over the 26 bytes code word.
+ * Every iteration flips the bits which take part in the largest number of
+ * failed parity checks. The frame is written back only when all
+ * of the checks are satisfied within OGNTP_LDPC_MAX_ITER iterations
+ * and OGNTP_LDPC_MAX_FLIPS flips in all. Nothing else guards the frame,
+ * a decoder let go further would rather make up another code word
+ * than find the one sent.
+ */
+bool ogntp_repair(void *pkt) {
+
+  uint32_t cw[OGNTP_LDPC_WORDS];
+  uint8_t  votes[OGNTP_LDPC_WORDS * 32];
+  uint8_t  iter, row, word;
+  uint8_t  flips = 0;
+
+  memset(cw, 0, sizeof(cw));
+  memcpy(cw, pkt, OGNTP_PAYLOAD_SIZE + OGNTP_CRC_SIZE);
+
+  for (iter = 0; ; iter++) {
+    uint8_t failed = 0;
+    uint8_t max_votes = 0;
+
+    memset(votes, 0, sizeof(votes));
+
+    for (row = 0; row < OGNTP_LDPC_CHECKS; row++) {
+      uint32_t sum = 0;
+
+      for (word = 0; word < OGNTP_LDPC_WORDS; word++) {
+        sum ^= cw[word] & ogntp_parity_check(row, word);
+      }
+
+      if (__builtin_parity(sum) == 0) {
+        continue;
+      }
+
+      failed++;
+
+      for (word = 0; word < OGNTP_LDPC_WORDS; word++) {
+        uint32_t mask = ogntp_parity_check(row, word);
+
+        while (mask) {
+          uint8_t *vp = &votes[word * 32 + __builtin_ctz(mask)];
+
+          if (++(*vp) > max_votes) {
+            max_votes = *vp;
+          }
+          mask &= mask - 1;
+        }
+      }
+    }
+
+    if (failed == 0) {
+      if (iter > 0) {
+        memcpy(pkt, cw, OGNTP_PAYLOAD_SIZE + OGNTP_CRC_SIZE);
+      }
+      return true;
+    }
+
+    if (iter == OGNTP_LDPC_MAX_ITER) {
+      return false;
+    }
+
+    for (uint16_t bit = 0; bit < OGNTP_LDPC_BITS; bit++) {
+      if (votes[bit] == max_votes) {
+        if (++flips > OGNTP_LDPC_MAX_FLIPS) {
+          return false;
+        }
+        cw[bit >> 5] ^= 1UL << (bit & 31);
+      }
+    }
+  }
+}
+
 size_t ogntp_encode(void *pkt, ufo_t *this_aircraft) {
 
   uint32_t *key = settings->igc_key;
@@ -35,6 +35,11 @@
 #define OGNTP_TX_INTERVAL_MIN 600 /* in ms */
 #define OGNTP_TX_INTERVAL_MAX 1400
 
+/* LDPC(208,160) bit flipping decoder, worst case is bounded by this */
+#define OGNTP_LDPC_MAX_ITER   8
+/* OGNTP has no outer CRC, a repair which needs more flips is dropped */
+#define OGNTP_LDPC_MAX_FLIPS  2
+
 #include "ogn.h"
 
 typedef struct {
@@ -47,5 +52,6 @@ extern const rf_proto_desc_t ogntp_proto_desc;
 
 bool ogntp_decode(void *, ufo_t *, ufo_t *);
 size_t ogntp_encode(void *, ufo_t *);
+bool ogntp_repair(void *);
 
 #endif /* PROTOCOL_OGNTP_H */
\ No newline at end of file
@@ -0,0 +1,75 @@
+/*
+ * CRC.h
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CRC_H
+#define CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if !defined(PROGMEM)
+#define PROGMEM
+#endif
+
+#if !defined(pgm_read_byte)
+#define pgm_read_byte(addr)   (*(const uint8_t  *)(addr))
+#endif
+
+#if !defined(pgm_read_word)
+#define pgm_read_word(addr)   (*(const uint16_t *)(addr))
+#endif
+
+/*
+ * Slicing factor of the table driven CRC routines.
+ * AVR keeps one 256 entries table per CRC to save flash,
+ * everything else walks the payload 4 bytes at a time.
+ */
+#if defined(ARDUINO_ARCH_AVR)
+#define CRC_SLICES              1
+#else
+#define CRC_SLICES              4
+#endif
+
+#define CRC_CCITT_SEED_0000     0x0000
+#define CRC_CCITT_SEED_FFFF     0xFFFF
+#define CRC_8_107_SEED          0x71
+
+/*
+ * Running CRC-CCITT (0xFFFF seed) value after
+ * NRF905/FLARM "address" bytes 0x31 0xFA 0xB6
+ */
+#define CRC_CCITT_LEGACY_FFFF   0x051E
+
+extern const uint16_t CRC_CCITT_Table[CRC_SLICES][256] PROGMEM;
+
+uint16_t CRC_CCITT_Update(uint16_t, const uint8_t *, size_t);
+uint8_t  CRC_8_107_Update(uint8_t,  const uint8_t *, size_t);
+
+/* single octet step, for loops that produce the payload on the fly */
+static inline uint16_t CRC_CCITT_Byte(uint16_t crc, uint8_t val)
+{
+  return (crc << 8) ^ pgm_read_word(&CRC_CCITT_Table[0][(crc >> 8) ^ val]);
+}
+
+/* GDL 90 ICD flavour of the same polynomial: octet is added after the lookup */
+static inline uint16_t CRC_GDL90_Byte(uint16_t crc, uint8_t val)
+{
+  return (crc << 8) ^ pgm_read_word(&CRC_CCITT_Table[0][crc >> 8]) ^ val;
+}
+
+#endif /* CRC_H */
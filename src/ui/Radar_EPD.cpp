@@ -65,6 +65,8 @@ static void EPD_Draw_Radar()
     /* divider is a half of full scale */
     int32_t divider = 2000;
 
+    Traffic_Extrapolate();
+
     display->setFont(&FreeMono9pt7b);
     display->getTextBounds("N", 0, 0, &tbx, &tby, &tbw, &tbh);
 
@@ -115,18 +117,29 @@ static void EPD_Draw_Radar()
     display->fillScreen(GxEPD_WHITE);
 
     {
+#if !defined(EXCLUDE_TRAFFIC_SNAPSHOT)
+      traffic_snapshot_t *snap = Traffic_Snapshot_Acquire();
+
+      for (int i=0; i < snap->count; i++) {
+        ufo_t *fop = &snap->fo[i];
+
+        if ((now() - fop->timestamp) <= EPD_EXPIRATION_TIME) {
+#else
       for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-        if (Container[i].addr && (now() - Container[i].timestamp) <= EPD_EXPIRATION_TIME) {
+        ufo_t *fop = &Container[i];
+
+        if (Traffic_Hot.addr[i] && (now() - Traffic_Hot.timestamp[i]) <= EPD_EXPIRATION_TIME) {
+#endif /* EXCLUDE_TRAFFIC_SNAPSHOT */
 
           int16_t rel_x;
           int16_t rel_y;
           float distance;
           float bearing;
 
-          bool isTeam = (Container[i].addr == ui->team) ;
+          bool isTeam = (fop->addr == ui->team) ;
 
-          distance = Container[i].distance;
-          bearing  = Container[i].bearing;
+          distance = fop->distance;
+          bearing  = fop->bearing;
 
           switch (ui->orientation)
           {
@@ -148,7 +161,40 @@ static void EPD_Draw_Radar()
           int16_t x = ((int32_t) rel_x * (int32_t) radius) / divider;
           int16_t y = ((int32_t) rel_y * (int32_t) radius) / divider;
 
-          float RelativeVertical = Container[i].altitude - ThisAircraft.altitude;
+#if !defined(EXCLUDE_TRAFFIC_HISTORY)
+          traffic_point_t trail[EPD_RADAR_TRAIL];
+#if !defined(EXCLUDE_TRAFFIC_SNAPSHOT)
+          ufo_t *live = &Container[snap->slot[i]];
+#else
+          ufo_t *live = fop;
+#endif /* EXCLUDE_TRAFFIC_SNAPSHOT */
+          /* the slot may have been given to another target since publication */
+          int points = live->addr == fop->addr ?
+                       Traffic_History(live, trail, EPD_RADAR_TRAIL) : 0;
+
+          if (points > 0) {
+            float m_per_deg = 6372795.0 * PI / 180.0; /* same Earth as TinyGPS++ */
+            float rot = ui->orientation == DIRECTION_TRACK_UP ?
+                        radians(ThisAircraft.course) : 0.0;
+            float cos_rot = cos(rot);
+            float sin_rot = sin(rot);
+            float cos_lat = cos(radians(ThisAircraft.latitude));
+
+            for (int k=0; k < points; k++) {
+              float north = (trail[k].latitude  - ThisAircraft.latitude)  * m_per_deg;
+              float east  = (trail[k].longitude - ThisAircraft.longitude) * m_per_deg * cos_lat;
+
+              int32_t tx = constrain(east * cos_rot - north * sin_rot, -32768, 32767);
+              int32_t ty = constrain(east * sin_rot + north * cos_rot, -32768, 32767);
+
+              display->drawPixel(radar_center_x + (tx * radius) / divider,
+                                 radar_center_y - (ty * radius) / divider,
+                                 GxEPD_BLACK);
+            }
+          }
+#endif /* EXCLUDE_TRAFFIC_HISTORY */
+
+          float RelativeVertical = fop->altitude - ThisAircraft.altitude;
 
           if        (RelativeVertical >   EPD_RADAR_V_THRESHOLD) {
             if (isTeam) {
@@ -199,6 +245,10 @@ static void EPD_Draw_Radar()
         }
       }
 
+#if !defined(EXCLUDE_TRAFFIC_SNAPSHOT)
+      Traffic_Snapshot_Release(snap);
+#endif /* EXCLUDE_TRAFFIC_SNAPSHOT */
+
       display->drawCircle(  radar_center_x, radar_center_y,
                             radius, GxEPD_BLACK);
       display->drawCircle(  radar_center_x, radar_center_y,
@@ -75,14 +75,27 @@ static void EPD_Draw_Text()
   char info_line [TEXT_VIEW_LINE_LENGTH];
   char id_text   [TEXT_VIEW_LINE_LENGTH];
 
+#if !defined(EXCLUDE_TRAFFIC_SNAPSHOT)
+  traffic_snapshot_t *snap = Traffic_Snapshot_Acquire();
+
+  for (int i=0; i < snap->count; i++) {
+    if ((now() - snap->fo[i].timestamp) <= EPD_EXPIRATION_TIME) {
+
+      traffic_by_dist[j].fop = &snap->fo[i];
+      traffic_by_dist[j].distance = snap->fo[i].distance;
+      j++;
+    }
+  }
+#else
   for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-    if (Container[i].addr && (now() - Container[i].timestamp) <= EPD_EXPIRATION_TIME) {
+    if (Traffic_Hot.addr[i] && (now() - Traffic_Hot.timestamp[i]) <= EPD_EXPIRATION_TIME) {
 
       traffic_by_dist[j].fop = &Container[i];
       traffic_by_dist[j].distance = Container[i].distance;
       j++;
     }
   }
+#endif /* EXCLUDE_TRAFFIC_SNAPSHOT */
 
 #if defined(USE_EPD_TASK)
   if (j > 0 && EPD_update_in_progress == EPD_UPDATE_NONE) {
@@ -257,6 +270,10 @@ static void EPD_Draw_Text()
     display->display(true);
 #endif
   }
+
+#if !defined(EXCLUDE_TRAFFIC_SNAPSHOT)
+  Traffic_Snapshot_Release(snap);
+#endif /* EXCLUDE_TRAFFIC_SNAPSHOT */
 }
 
 void EPD_text_setup()
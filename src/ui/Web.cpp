@@ -591,7 +591,7 @@ void handleRoot() {
   char str_alt[16];
   char str_Vcc[8];
 
-  char *Root_temp = (char *) malloc(2300);
+  char *Root_temp = (char *) malloc(2400);
   if (Root_temp == NULL) {
     return;
   }
@@ -601,7 +601,7 @@ void handleRoot() {
   dtostrf(ThisAircraft.altitude,  7, 1, str_alt);
   dtostrf(vdd, 4, 2, str_Vcc);
 
-  snprintf_P ( Root_temp, 2300,
+  snprintf_P ( Root_temp, 2400,
     PSTR("<html>\
   <head>\
     <meta name='viewport' content='width=device-width, initial-scale=1'>\
@@ -638,6 +638,7 @@ void handleRoot() {
      <th align=left>Tx&nbsp;&nbsp;</th><td align=right>%u</td>\
      <th align=left>&nbsp;&nbsp;&nbsp;&nbsp;Rx&nbsp;&nbsp;</th><td align=right>%u</td>\
    </tr></table></td></tr>\
+   <tr><th align=left>Manchester errors</th><td align=right>%u</td></tr>\
  </table>\
  <h2 align=center>Most recent GNSS fix</h2>\
  <table width=100%%>\
@@ -671,7 +672,7 @@ void handleRoot() {
 #endif /* ENABLE_AHRS */
     hr, min % 60, sec % 60, ESP.getFreeHeap(),
     low_voltage ? "red" : "green", str_Vcc,
-    tx_packets_counter, rx_packets_counter,
+    tx_packets_counter, rx_packets_counter, rx_manchester_errors,
     timestamp, sats, str_lat, str_lon, str_alt
   );
   SoC->swSer_enableRx(false);
@@ -0,0 +1,244 @@
+/*
+ * Alarm_bench.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Cost and accuracy of locating a target. Traffic_Update() projects
+ * targets within TRAFFIC_LTP_RANGE on the local tangent plane and falls
+ * back to TinyGPS++ haversine beyond it, which is what it did for any
+ * target before. Accuracy is taken against haversine in double precision
+ * over ALARM_ZONE_NONE, at a few latitudes of this aircraft.
+ *
+ * "Legacy" alarms of a full container are evaluated by Traffic_loop() in
+ * one CPA batch, a single target by Traffic_Update() on a spare lane.
+ * The CPA cost per target is taken against the same runs without alarms.
+ */
+
+#include <TinyGPS++.h>
+
+#include "Host.h"
+#include "../src/TrafficHelper.h"
+#include "../src/driver/RF.h"
+#include "../src/driver/EEPROM.h"
+
+#define BENCH_TARGETS         1000
+#define BENCH_ROUNDS          50
+#define BENCH_FAR             60000.0 /* metres, past TRAFFIC_LTP_RANGE */
+#define BENCH_LOOPS           1000
+#define BENCH_RUNS            40
+
+static const double m_per_deg = 111195.0;
+
+static uint32_t Bench_Random = 7;
+static ufo_t    Bench_Target[BENCH_TARGETS];
+
+volatile float  Bench_Sink;
+
+/* same sequence on any host */
+static double Bench_Uniform()
+{
+  Bench_Random = Bench_Random * 1103515245 + 12345;
+
+  return ((Bench_Random >> 8) & 0xFFFF) / 65536.0;
+}
+
+/* targets spread over a disc of 'range' metres around ThisAircraft */
+static void Bench_Spread(double min_range, double range)
+{
+  Bench_Random = 7;
+
+  for (int i=0; i < BENCH_TARGETS; i++) {
+    ufo_t *fop = &Bench_Target[i];
+    double d = min_range + (range - min_range) * Bench_Uniform();
+    double b = 360.0 * Bench_Uniform();
+
+    *fop = EmptyFO;
+    fop->addr      = 0x400000 + i;
+    fop->addr_type = ADDR_TYPE_FLARM;
+    fop->protocol  = RF_PROTOCOL_LEGACY;
+    fop->latitude  = ThisAircraft.latitude + d * cos(radians(b)) / m_per_deg;
+    fop->longitude = ThisAircraft.longitude + d * sin(radians(b)) /
+                     (m_per_deg * cos(radians(ThisAircraft.latitude)));
+    fop->altitude  = ThisAircraft.altitude;
+    fop->course    = 360.0 * Bench_Uniform();
+    fop->speed     = 20.0 + 80.0 * Bench_Uniform(); /* knots */
+  }
+}
+
+/* a full container, under the 'alarm' method */
+static void Bench_Fill(uint8_t alarm)
+{
+  settings->alarm = alarm;
+  Host_Clock_Set(0);
+  Traffic_setup();
+  ThisAircraft.timestamp = now();
+
+  Bench_Spread(0, ALARM_ZONE_NONE);
+
+  for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    Bench_Target[i].timestamp = now();
+    Traffic_Update(&Bench_Target[i]);
+    Traffic_Store(&Bench_Target[i]);
+  }
+}
+
+/* ns per target of Traffic_loop() */
+static double Bench_Loop()
+{
+  const uint32_t start = 1000;
+  double t0 = Host_Time_us();
+
+  for (int r=0; r < BENCH_LOOPS; r++) {
+    /* every call is due, targets stay within 2 s of their fix */
+    Host_Clock_Set(r & 1 ? start : start + TRAFFIC_UPDATE_INTERVAL_MS + 1);
+    Traffic_loop();
+  }
+
+  return (Host_Time_us() - t0) * 1000.0 / ((double) BENCH_LOOPS * Traffic_Count());
+}
+
+/* ns per target of Traffic_Update() */
+static double Bench_Update()
+{
+  double t0 = Host_Time_us();
+
+  for (int r=0; r < BENCH_ROUNDS; r++) {
+    for (int i=0; i < BENCH_TARGETS; i++) {
+      Traffic_Update(&Bench_Target[i]);
+      Bench_Sink = Bench_Target[i].distance;
+    }
+  }
+
+  return (Host_Time_us() - t0) * 1000.0 / (BENCH_ROUNDS * BENCH_TARGETS);
+}
+
+/* ns per target of distanceBetween() and courseTo() alone */
+static double Bench_Haversine()
+{
+  double t0 = Host_Time_us();
+
+  for (int r=0; r < BENCH_ROUNDS; r++) {
+    for (int i=0; i < BENCH_TARGETS; i++) {
+      ufo_t *fop = &Bench_Target[i];
+
+      fop->distance = TinyGPSPlus::distanceBetween(ThisAircraft.latitude,
+                                                   ThisAircraft.longitude,
+                                                   fop->latitude,
+                                                   fop->longitude);
+      fop->bearing  = TinyGPSPlus::courseTo(ThisAircraft.latitude,
+                                            ThisAircraft.longitude,
+                                            fop->latitude,
+                                            fop->longitude);
+      Bench_Sink = fop->distance;
+    }
+  }
+
+  return (Host_Time_us() - t0) * 1000.0 / (BENCH_ROUNDS * BENCH_TARGETS);
+}
+
+int main()
+{
+  static const float latitudes[] = { 0.0, 45.0, 60.0, 70.0 };
+
+  Host_setup();
+  settings->alarm = TRAFFIC_ALARM_NONE;
+  Traffic_setup();
+
+  printf("lat   distance error (m)   bearing error (deg)\n");
+  printf("          max     mean        max     mean\n");
+
+  for (size_t l=0; l < sizeof(latitudes) / sizeof(latitudes[0]); l++) {
+    double d_max = 0, d_sum = 0, b_max = 0, b_sum = 0;
+
+    ThisAircraft.latitude = latitudes[l];
+    Bench_Spread(0, ALARM_ZONE_NONE);
+
+    for (int i=0; i < BENCH_TARGETS; i++) {
+      ufo_t *fop = &Bench_Target[i];
+
+      Traffic_Update(fop);
+
+      double d = TinyGPSPlus::distanceBetween(ThisAircraft.latitude,
+                                              ThisAircraft.longitude,
+                                              fop->latitude,
+                                              fop->longitude);
+      double b = TinyGPSPlus::courseTo(ThisAircraft.latitude,
+                                       ThisAircraft.longitude,
+                                       fop->latitude,
+                                       fop->longitude);
+      double de = fabs(fop->distance - d);
+      double be = fabs(fop->bearing - b);
+
+      be = be > 180.0 ? 360.0 - be : be;
+
+      d_max  = de > d_max ? de : d_max;
+      b_max  = be > b_max ? be : b_max;
+      d_sum += de;
+      b_sum += be;
+    }
+
+    printf("%3.0f  %9.3f %8.3f  %9.4f %8.4f\n", latitudes[l],
+           d_max, d_sum / BENCH_TARGETS, b_max, b_sum / BENCH_TARGETS);
+
+    /* as promised next to Traffic_Locate() */
+    HOST_CHECK(d_max < 1.0);
+  }
+
+  ThisAircraft.latitude = 45.0;
+
+  /* the runs take turns and the best of each is kept, all meet the same noise */
+  double ltp = 1e9, hav = 1e9, far = 1e9;
+
+  for (int r=0; r < BENCH_RUNS; r++) {
+    Bench_Spread(0, ALARM_ZONE_NONE);
+    ltp = fmin(ltp, Bench_Update());
+    hav = fmin(hav, Bench_Haversine());
+
+    Bench_Spread(BENCH_FAR, BENCH_FAR + ALARM_ZONE_NONE);
+    far = fmin(far, Bench_Update());
+  }
+
+  double loop_none = 1e9, loop_cpa = 1e9, one_none = 1e9, one_cpa = 1e9;
+  int    count     = 0;
+
+  for (int r=0; r < BENCH_RUNS; r++) {
+    Bench_Fill(TRAFFIC_ALARM_NONE);
+    count     = Traffic_Count();
+    loop_none = fmin(loop_none, Bench_Loop());
+    one_none  = fmin(one_none,  Bench_Update());
+
+    Bench_Fill(TRAFFIC_ALARM_LEGACY);
+    loop_cpa  = fmin(loop_cpa,  Bench_Loop());
+    one_cpa   = fmin(one_cpa,   Bench_Update());
+    HOST_CHECK(Traffic_Count() == count && count == MAX_TRACKING_OBJECTS);
+  }
+
+  printf("\nns per target\n");
+  printf("Traffic_Update(), LTP, within %d m       %7.1f\n",
+         ALARM_ZONE_NONE, ltp);
+  printf("Traffic_Update(), haversine, past %d m   %7.1f\n",
+         (int) BENCH_FAR, far);
+  printf("distanceBetween() + courseTo() alone        %7.1f\n", hav);
+
+  printf("\n\"Legacy\" CPA, %d targets, ns per target\n", count);
+  printf("Traffic_loop(), batch                       %7.1f\n",
+         loop_cpa - loop_none);
+  printf("Traffic_Update(), spare lane                %7.1f\n",
+         one_cpa - one_none);
+
+  return Host_Result("Alarm_bench");
+}
@@ -0,0 +1,142 @@
+/*
+ * CRC_test.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Table driven CRC-CCITT and CRC-8 against bitwise references, over
+ * random buffers of any length up to TEST_MAX_SIZE and for every seed
+ * the radio paths use, then the throughput of both on radio frames.
+ */
+
+#include "Host.h"
+#include "../src/system/CRC.h"
+
+#define TEST_BUFFERS          100000
+#define TEST_MAX_SIZE         64
+#define TEST_FRAME_SIZE       26     /* NRF905/FLARM payload and CRC */
+#define TEST_FRAMES           1000000
+
+static uint32_t Test_Random = 7;
+
+volatile uint16_t Test_Sink;
+
+/* same sequence on any host */
+static uint8_t Test_Byte()
+{
+  Test_Random = Test_Random * 1103515245 + 12345;
+
+  return (Test_Random >> 16) & 0xFF;
+}
+
+static uint16_t Test_CCITT_Bitwise(uint16_t crc, const uint8_t *buf, size_t size)
+{
+  while (size--) {
+    crc ^= *buf++ << 8;
+    for (int b=0; b < 8; b++) {
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+
+  return crc;
+}
+
+static uint8_t Test_CRC8_Bitwise(uint8_t crc, const uint8_t *buf, size_t size)
+{
+  while (size--) {
+    crc ^= *buf++;
+    for (int b=0; b < 8; b++) {
+      crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+
+  return crc;
+}
+
+/* MB/s of 'crc' over TEST_FRAMES frames */
+static double Test_Throughput(uint16_t (*crc)(uint16_t, const uint8_t *, size_t))
+{
+  static uint8_t frame[TEST_FRAME_SIZE];
+  uint16_t sum = 0;
+
+  for (size_t i=0; i < sizeof(frame); i++) {
+    frame[i] = Test_Byte();
+  }
+
+  double t0 = Host_Time_us();
+
+  for (int n=0; n < TEST_FRAMES; n++) {
+    frame[0] = n;
+    sum ^= crc(CRC_CCITT_LEGACY_FFFF, frame, sizeof(frame));
+  }
+
+  Test_Sink = sum;
+
+  return (double) TEST_FRAMES * sizeof(frame) / (Host_Time_us() - t0);
+}
+
+int main()
+{
+  static const uint16_t seeds[] = {
+    CRC_CCITT_SEED_0000, CRC_CCITT_SEED_FFFF, CRC_CCITT_LEGACY_FFFF
+  };
+  static const uint8_t legacy_address[] = { 0x31, 0xFA, 0xB6 };
+  uint8_t buf[TEST_MAX_SIZE];
+  int mismatch = 0;
+
+  HOST_CHECK(CRC_CCITT_Update(CRC_CCITT_SEED_FFFF, legacy_address,
+                              sizeof(legacy_address)) == CRC_CCITT_LEGACY_FFFF);
+  HOST_CHECK(Test_CCITT_Bitwise(CRC_CCITT_SEED_FFFF, legacy_address,
+                                sizeof(legacy_address)) == CRC_CCITT_LEGACY_FFFF);
+
+  for (int n=0; n < TEST_BUFFERS; n++) {
+    size_t size = 1 + Test_Byte() % TEST_MAX_SIZE;
+
+    for (size_t i=0; i < size; i++) {
+      buf[i] = Test_Byte();
+    }
+
+    for (size_t s=0; s < sizeof(seeds) / sizeof(seeds[0]); s++) {
+      if (CRC_CCITT_Update(seeds[s], buf, size) !=
+          Test_CCITT_Bitwise(seeds[s], buf, size)) {
+        mismatch++;
+      }
+    }
+
+    if (CRC_8_107_Update(CRC_8_107_SEED, buf, size) !=
+        Test_CRC8_Bitwise(CRC_8_107_SEED, buf, size)) {
+      mismatch++;
+    }
+
+    /* byte at a time, as the TX paths that produce the payload do */
+    uint16_t crc = CRC_CCITT_LEGACY_FFFF;
+    for (size_t i=0; i < size; i++) {
+      crc = CRC_CCITT_Byte(crc, buf[i]);
+    }
+    if (crc != Test_CCITT_Bitwise(CRC_CCITT_LEGACY_FFFF, buf, size)) {
+      mismatch++;
+    }
+  }
+
+  printf("%d random buffers, %d mismatches\n", TEST_BUFFERS, mismatch);
+  HOST_CHECK(mismatch == 0);
+
+  printf("CRC-CCITT, %d octet frames: table %.0f MB/s, bitwise %.0f MB/s\n",
+         TEST_FRAME_SIZE, Test_Throughput(CRC_CCITT_Update),
+         Test_Throughput(Test_CCITT_Bitwise));
+
+  return Host_Result("CRC_test");
+}
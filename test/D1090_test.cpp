@@ -0,0 +1,242 @@
+/*
+ * D1090_test.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * D1090_Feed() on the well known DF17 frames of 40621D: an even and
+ * odd position pair at 38000 ft, identification and velocity. A target
+ * goes to the sink only after a barometric altitude, and comes with it.
+ * The frames go in as AVR text and as Beast binary, a few octets at
+ * a time, with escapes and garbage in between.
+ */
+
+#include <TimeLib.h>
+#include <TinyGPS++.h>
+
+#include "Host.h"
+#include "../src/TrafficHelper.h"
+#include "../src/driver/EEPROM.h"
+#include "../src/driver/RF.h"
+#include "../src/protocol/data/GDL90.h"
+#include "../src/protocol/data/D1090.h"
+
+#define TEST_EVEN             "8D40621D58C382D690C8AC2863A7"
+#define TEST_ODD              "8D40621D58C386435CC412692AD6"
+#define TEST_IDENT            "8D40621D202CC371C32CE02E065C"
+#define TEST_VELOCITY         "8D40621D994409940838174550B1"
+#define TEST_ADDR             0x40621D
+#define TEST_ALT_FT           38000.0
+#define TEST_LAT              52.2572   /* of the even and odd pair */
+#define TEST_LON              3.9194
+#define TEST_OWN_LAT          52.258
+#define TEST_OWN_LON          3.918
+
+/* SoC.cpp and GDL90.cpp, only D1090_Export() and es1090_decode() read them */
+const SoC_ops_t *SoC;
+const uint8_t aircraft_type_to_gdl90[] PROGMEM = { GDL90_EMITTER_CATEGORY_NONE };
+const uint8_t gdl90_to_aircraft_type[16] PROGMEM = { AIRCRAFT_TYPE_UNKNOWN };
+const char *GDL90_CallSign_Prefix[] = { "" };
+
+static ufo_t Test_Last;
+static int   Test_Count;
+
+static void Test_Sink(ufo_t *fop, const uint8_t *raw, size_t size)
+{
+  Test_Last = *fop;
+  Test_Count++;
+}
+
+static size_t Test_Hex(const char *hex, uint8_t *msg)
+{
+  size_t len = 0;
+
+  for (; hex[0] && hex[1]; hex += 2) {
+    unsigned int x;
+
+    sscanf(hex, "%2x", &x);
+    msg[len++] = x;
+  }
+
+  return len;
+}
+
+/* Mode-S parity, bit by bit, generator 0xFFF409 */
+static uint32_t Test_CRC(const uint8_t *msg, size_t len)
+{
+  uint32_t crc = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint32_t) msg[i] << 16;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x800000) ? (crc << 1) ^ 0xFFF409 : crc << 1;
+    }
+  }
+
+  return crc & 0xFFFFFF;
+}
+
+/* the even position as TC 20: GNSS height, no barometric altitude */
+static String Test_GNSS_Height()
+{
+  uint8_t msg[14];
+  char hex[2 * sizeof(msg) + 1];
+
+  Test_Hex(TEST_EVEN, msg);
+  msg[4] = (20 << 3) | (msg[4] & 7);
+
+  uint32_t crc = Test_CRC(msg, 11);
+  msg[11] = crc >> 16;
+  msg[12] = crc >> 8;
+  msg[13] = crc;
+
+  for (size_t i = 0; i < sizeof(msg); i++) {
+    snprintf(hex + 2 * i, 3, "%02X", msg[i]);
+  }
+
+  return String(hex);
+}
+
+static String Test_AVR(const char *hex)
+{
+  return String("*") + hex + ";\r\n";
+}
+
+/* Beast is binary, not for String */
+static uint8_t Test_Stream[256];
+static size_t  Test_Stream_Len;
+
+static void Test_Put(uint8_t c)
+{
+  Test_Stream[Test_Stream_Len++] = c;
+}
+
+/* a Beast frame: 0x1A, type, 6 octets of time, signal, message */
+static void Test_Beast(const char *hex, uint8_t signal, uint64_t ts)
+{
+  uint8_t frame[6 + 1 + 14];
+  size_t len = 0;
+
+  for (int i = 5; i >= 0; i--) {
+    frame[len++] = ts >> (8 * i);
+  }
+  frame[len++] = signal;
+  size_t msg_len = Test_Hex(hex, frame + len);
+  len += msg_len;
+
+  Test_Put(0x1A);
+  Test_Put(msg_len == 14 ? '3' : '2');
+  for (size_t i = 0; i < len; i++) {
+    Test_Put(frame[i]);
+    if (frame[i] == 0x1A) {
+      Test_Put(0x1A);
+    }
+  }
+}
+
+static void Test_Feed(d1090_feed_t *feed, const uint8_t *buf, size_t size,
+                      size_t step)
+{
+  for (size_t i = 0; i < size; i += step) {
+    D1090_Feed(feed, buf + i, step < size - i ? step : size - i);
+  }
+}
+
+static void Test_Feed(d1090_feed_t *feed, const String &s, size_t step)
+{
+  Test_Feed(feed, (const uint8_t *) s.c_str(), s.length(), step);
+}
+
+static void Test_Feed_Beast(d1090_feed_t *feed, size_t step)
+{
+  Test_Feed(feed, Test_Stream, Test_Stream_Len, step);
+  Test_Stream_Len = 0;
+}
+
+static void Test_Target(const ufo_t *fop)
+{
+  HOST_CHECK(fop->addr == TEST_ADDR);
+  HOST_CHECK(fop->addr_type == ADDR_TYPE_ICAO);
+  HOST_CHECK(fabs(fop->pressure_altitude * _GPS_FEET_PER_METER - TEST_ALT_FT) < 1.0);
+  HOST_CHECK(fop->altitude == fop->pressure_altitude);
+  HOST_CHECK(fabs(fop->latitude  - TEST_LAT) < 0.0005);
+  HOST_CHECK(fabs(fop->longitude - TEST_LON) < 0.0005);
+}
+
+int main()
+{
+  d1090_feed_t feed;
+
+  Host_setup();
+
+  /*
+   * AVR, decoded against own position. The GNSS height position
+   * gets decoded, but no target is given out without an altitude.
+   */
+  D1090_Feed_init(&feed, D1090_FEED_AVR);
+  feed.sink      = Test_Sink;
+  feed.ms        = 1000;
+  feed.fix       = true;
+  feed.latitude  = TEST_OWN_LAT;
+  feed.longitude = TEST_OWN_LON;
+
+  Test_Feed(&feed, Test_AVR(TEST_IDENT) + Test_AVR(TEST_VELOCITY) +
+                   Test_AVR(Test_GNSS_Height().c_str()), 2);
+  HOST_CHECK(feed.frames == 3 && feed.crc_errors == 0);
+  HOST_CHECK(feed.positions == 1);
+  HOST_CHECK(feed.targets == 0 && Test_Count == 0);
+
+  feed.ms += 500;
+  Test_Feed(&feed, Test_AVR(TEST_EVEN) + "*zz;\n*8D40;\n", 5);
+  HOST_CHECK(feed.positions == 2);
+  HOST_CHECK(feed.targets == 1 && Test_Count == 1);
+  Test_Target(&Test_Last);
+  HOST_CHECK(strncmp((char *) Test_Last.callsign, "KLM1023", sizeof(Test_Last.callsign)) == 0);
+
+  /* one bit off fails the CRC */
+  Test_Feed(&feed, Test_AVR("8D40621D58C382D690C8AC2863A8"), 64);
+  HOST_CHECK(feed.crc_errors == 1 && Test_Count == 1);
+
+  /*
+   * Beast, no own position, long after: the entry of the AVR part
+   * is no CPR reference any more. The odd half alone is no position,
+   * the pair is.
+   */
+  D1090_Feed_init(&feed, D1090_FEED_BEAST);
+  feed.sink = Test_Sink;
+  feed.ms   = 1000000;
+  Test_Count = 0;
+
+  Test_Beast(TEST_IDENT, 0x80, 0x1A1A1A1A1A1AULL);
+  for (const char *g = "gar\x1A" "bage"; *g; g++) {
+    Test_Put(*g);
+  }
+  Test_Beast(TEST_VELOCITY, 0x1A, 5);
+  Test_Beast(TEST_ODD, 200, 6);
+  Test_Feed_Beast(&feed, 1);
+  HOST_CHECK(feed.frames == 3 && feed.crc_errors == 0);
+  HOST_CHECK(feed.positions == 0 && Test_Count == 0);
+
+  feed.ms += 500;
+  Test_Beast(TEST_EVEN, 200, 7);
+  Test_Feed_Beast(&feed, 3);
+  HOST_CHECK(feed.positions == 1);
+  HOST_CHECK(feed.targets == 1 && Test_Count == 1);
+  Test_Target(&Test_Last);
+  HOST_CHECK(Test_Last.rssi < 0.0);
+
+  return Host_Result("D1090_test");
+}
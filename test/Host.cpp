@@ -0,0 +1,159 @@
+/*
+ * Host.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/time.h>
+#include <TimeLib.h>
+
+#include "Host.h"
+#include "../src/TrafficHelper.h"
+#include "../src/driver/RF.h"
+#include "../src/driver/EEPROM.h"
+#include "../src/driver/Sound.h"
+
+/*
+ * Stand-ins of the objects which RPi.cpp, RF.cpp and the other drivers
+ * give to the firmware. None of those is built into the host programs.
+ */
+eeprom_t eeprom_block;
+settings_t *settings = &eeprom_block.field.settings;
+ufo_t ThisAircraft;
+
+byte RxBuffer[MAX_PKT_SIZE] __attribute__((aligned(sizeof(uint32_t))));
+byte TxBuffer[MAX_PKT_SIZE] __attribute__((aligned(sizeof(uint32_t))));
+int8_t RF_last_rssi = 0;
+bool   (*protocol_decode)(void *, ufo_t *, ufo_t *);
+
+static uint32_t Host_ms     = 0;
+static int      Host_Failed = 0;
+
+unsigned long millis()
+{
+  return Host_ms;
+}
+
+unsigned long micros()
+{
+  return Host_ms * 1000UL;
+}
+
+void delay(unsigned long ms)
+{
+  Host_ms += ms;
+}
+
+String Bin2Hex(byte *buffer, size_t size)
+{
+  return String("");
+}
+
+uint8_t parity(uint32_t x)
+{
+  return __builtin_parity(x);
+}
+
+uint8_t RF_Payload_Size(uint8_t protocol)
+{
+  return protocol == RF_PROTOCOL_LEGACY ? LEGACY_PAYLOAD_SIZE : 0;
+}
+
+bool Sound_Notify()
+{
+  return false;
+}
+
+void Host_setup()
+{
+  Host_ms = 0;
+  setTime(HOST_EPOCH);
+
+  memset(&eeprom_block, 0, sizeof(eeprom_block));
+  settings->alarm = TRAFFIC_ALARM_DISTANCE;
+
+  ThisAircraft           = EmptyFO;
+  ThisAircraft.addr      = 0xABCDEF;
+  ThisAircraft.latitude  = 45.0;
+  ThisAircraft.longitude = 7.0;
+  ThisAircraft.altitude  = 1000.0;
+  ThisAircraft.timestamp = now();
+}
+
+void Host_Clock_Set(uint32_t ms)
+{
+  Host_ms = ms;
+}
+
+void Host_Clock_Step(uint32_t ms)
+{
+  Host_ms += ms;
+}
+
+uint32_t Host_Clock()
+{
+  return Host_ms;
+}
+
+double Host_Time_us()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+double Host_Best(double (*run)(void), int runs)
+{
+  double best = run();
+
+  while (--runs > 0) {
+    double t = run();
+    best = t < best ? t : best;
+  }
+
+  return best;
+}
+
+bool Host_Check(bool cond, const char *expr, const char *file, int line)
+{
+  if (!cond) {
+    printf("%s:%d: check failed: %s\n", file, line, expr);
+    Host_Failed++;
+  }
+
+  return cond;
+}
+
+int Host_Result(const char *name)
+{
+  printf("%s: %s\n", name, Host_Failed ? "FAILED" : "passed");
+
+  return Host_Failed ? 1 : 0;
+}
+
+void Host_Place(ufo_t *fop, float distance, float bearing)
+{
+  /* local flat earth, good within a few tens of km */
+  const double m_per_deg = 111195.0;
+
+  fop->latitude  = ThisAircraft.latitude +
+                   distance * cos(radians(bearing)) / m_per_deg;
+  fop->longitude = ThisAircraft.longitude +
+                   distance * sin(radians(bearing)) /
+                   (m_per_deg * cos(radians(ThisAircraft.latitude)));
+  fop->altitude  = ThisAircraft.altitude;
+}
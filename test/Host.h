@@ -0,0 +1,52 @@
+/*
+ * Host.h
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HOSTHELPER_H
+#define HOSTHELPER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../src/system/SoC.h"
+
+/*
+ * Host (PC or RPi) test and benchmark programs run the firmware sources
+ * on a simulated clock: millis() and micros() return what the program
+ * has set, now() follows them through TimeLib.
+ */
+#define HOST_EPOCH            1600000000 /* now() at Host_setup() */
+
+#define HOST_CHECK(cond)      Host_Check((cond), #cond, __FILE__, __LINE__)
+
+void     Host_setup(void);
+void     Host_Clock_Set(uint32_t);
+void     Host_Clock_Step(uint32_t);
+uint32_t Host_Clock(void);
+
+/* wall clock, in microseconds, for the benchmarks */
+double   Host_Time_us(void);
+/* least of 'runs' results of a timed run, the others met some noise */
+double   Host_Best(double (*)(void), int);
+
+bool     Host_Check(bool, const char *, const char *, int);
+int      Host_Result(const char *);
+
+/* places 'fop' at 'distance' metres, 'bearing' degrees from ThisAircraft */
+void     Host_Place(ufo_t *, float, float);
+
+#endif /* HOSTHELPER_H */
@@ -0,0 +1,132 @@
+/*
+ * JSON_bench.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * parseD1090_Stream() over a busy dump1090 aircraft.json: 300 aircraft,
+ * BENCH_POSITIONS of them with a position and BENCH_NEAR of those within
+ * JSON_D1090_RANGE of 52N 13E. The document is parsed alone, with a sink
+ * that only counts, and into the container through JSON_Traffic_Store().
+ */
+
+#include <TimeLib.h>
+
+#include "Host.h"
+#include "../src/TrafficHelper.h"
+#include "../src/driver/EEPROM.h"
+#include "../src/protocol/data/GDL90.h"
+#include "../src/protocol/data/JSON.h"
+
+#define BENCH_FIXTURE         "test/data/aircraft_300.json"
+#define BENCH_POSITIONS       129
+#define BENCH_NEAR            20
+#define BENCH_LAT             52.0
+#define BENCH_LON             13.0
+#define BENCH_DOCS            100
+#define BENCH_RUNS            20
+
+/* GDL90.cpp, only JSON_Export() reads them */
+const uint8_t aircraft_type_to_gdl90[] PROGMEM = { GDL90_EMITTER_CATEGORY_NONE };
+const char *GDL90_CallSign_Prefix[] = { "" };
+
+static char   Bench_Doc[128 * 1024];
+static size_t Bench_Doc_Len;
+static int    Bench_Count;
+static int    Bench_Far;
+
+static void Bench_Sink(ufo_t *fop, const uint8_t *raw, size_t size)
+{
+  float north = (fop->latitude  - BENCH_LAT) * 111195.0;
+  float east  = (fop->longitude - BENCH_LON) * 111195.0 * cos(radians(BENCH_LAT));
+
+  if (north * north + east * east > (float) JSON_D1090_RANGE * JSON_D1090_RANGE) {
+    Bench_Far++;
+  }
+  Bench_Count++;
+}
+
+static double Bench_Parse()
+{
+  double t0 = Host_Time_us();
+
+  for (int n=0; n < BENCH_DOCS; n++) {
+    parseD1090_Stream(Bench_Doc, Bench_Doc_Len, BENCH_LAT, BENCH_LON,
+                      JSON_D1090_RANGE, Bench_Sink);
+  }
+
+  return (Host_Time_us() - t0) / BENCH_DOCS;
+}
+
+static double Bench_Store()
+{
+  double t0 = Host_Time_us();
+
+  for (int n=0; n < BENCH_DOCS; n++) {
+    parseD1090_Stream(Bench_Doc, Bench_Doc_Len, BENCH_LAT, BENCH_LON,
+                      JSON_D1090_RANGE, JSON_Traffic_Store);
+  }
+
+  return (Host_Time_us() - t0) / BENCH_DOCS;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *path = argc > 1 ? argv[1] : BENCH_FIXTURE;
+  FILE *fp = fopen(path, "rb");
+
+  if (!HOST_CHECK(fp != NULL)) {
+    return Host_Result("JSON_bench");
+  }
+  Bench_Doc_Len = fread(Bench_Doc, 1, sizeof(Bench_Doc) - 1, fp);
+  fclose(fp);
+
+  Host_setup();
+  ThisAircraft.latitude  = BENCH_LAT;
+  ThisAircraft.longitude = BENCH_LON;
+  Traffic_setup();
+
+  /* every aircraft with a position, then only the near ones */
+  HOST_CHECK(parseD1090_Stream(Bench_Doc, Bench_Doc_Len, BENCH_LAT, BENCH_LON,
+                               0, Bench_Sink));
+  HOST_CHECK(Bench_Count == BENCH_POSITIONS);
+
+  Bench_Count = Bench_Far = 0;
+  HOST_CHECK(parseD1090_Stream(Bench_Doc, Bench_Doc_Len, BENCH_LAT, BENCH_LON,
+                               JSON_D1090_RANGE, Bench_Sink));
+  HOST_CHECK(Bench_Count == BENCH_NEAR && Bench_Far == 0);
+
+  parseD1090_Stream(Bench_Doc, Bench_Doc_Len, BENCH_LAT, BENCH_LON,
+                    JSON_D1090_RANGE, JSON_Traffic_Store);
+  HOST_CHECK(Traffic_Count() == BENCH_NEAR);
+
+  /* the runs take turns and the best of each is kept */
+  double us_parse = 1e9, us_store = 1e9;
+
+  for (int r=0; r < BENCH_RUNS; r++) {
+    us_parse = fmin(us_parse, Bench_Parse());
+    us_store = fmin(us_store, Bench_Store());
+  }
+
+  printf("%s: %u bytes, %d aircraft with position, %d near\n",
+         path, (unsigned) Bench_Doc_Len, BENCH_POSITIONS, BENCH_NEAR);
+  printf("parseD1090_Stream()           %7.1f us/doc  %6.1f MB/s\n",
+         us_parse, Bench_Doc_Len / us_parse);
+  printf("  into JSON_Traffic_Store()   %7.1f us/doc  %6.1f MB/s\n",
+         us_store, Bench_Doc_Len / us_store);
+
+  return Host_Result("JSON_bench");
+}
@@ -0,0 +1,116 @@
+/*
+ * LDPC_bench.cpp
+ * Copyright (C) 2017-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * ogntp_repair() over LDPC_ParityCheck_n208k160 of the OGN library.
+ *
+ * The code is linear and a bit flipping decoder only ever looks at the
+ * syndrome, so the all-zero code word with N bits flipped behaves the
+ * same as any frame with the same errors. A repair is "recovered" when
+ * the zero word comes back, "miscorrected" when another code word
+ * passes all the checks, and the frame is dropped otherwise.
+ */
+
+#include "Host.h"
+#include "../src/TrafficHelper.h"
+#include "../src/driver/RF.h"
+
+#define BENCH_FRAMES          100000
+#define BENCH_MAX_ERRORS      6
+#define BENCH_FRAME_SIZE      (OGNTP_PAYLOAD_SIZE + OGNTP_CRC_SIZE)
+#define BENCH_BITS            (BENCH_FRAME_SIZE * 8)
+
+static uint32_t Bench_Random = 7;
+
+/* same sequence on any host */
+static uint32_t Bench_Next()
+{
+  Bench_Random = Bench_Random * 1103515245 + 12345;
+
+  return Bench_Random >> 8;
+}
+
+static bool Bench_Zero(const uint8_t *frame)
+{
+  for (int i=0; i < BENCH_FRAME_SIZE; i++) {
+    if (frame[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main()
+{
+  uint8_t frame[BENCH_FRAME_SIZE];
+
+  Host_setup();
+
+  memset(frame, 0, sizeof(frame));
+  HOST_CHECK(ogntp_repair(frame) && Bench_Zero(frame));
+
+  printf("errors   recovered   miscorrected   dropped   us/frame\n");
+
+  for (int errors=1; errors <= BENCH_MAX_ERRORS; errors++) {
+    int recovered = 0, miscorrected = 0;
+    double us = 0;
+
+    for (int n=0; n < BENCH_FRAMES; n++) {
+      memset(frame, 0, sizeof(frame));
+
+      for (int e=0; e < errors; ) {
+        uint16_t bit = Bench_Next() % BENCH_BITS;
+
+        if ((frame[bit >> 3] & (1 << (bit & 7))) == 0) {
+          frame[bit >> 3] |= 1 << (bit & 7);
+          e++;
+        }
+      }
+
+      double t0 = Host_Time_us();
+      bool ok = ogntp_repair(frame);
+      us += Host_Time_us() - t0;
+
+      if (ok) {
+        if (Bench_Zero(frame)) {
+          recovered++;
+        } else {
+          miscorrected++;
+        }
+      }
+    }
+
+    printf("%6d  %9.2f %%  %11.3f %%  %6.2f %%  %9.2f\n", errors,
+           100.0 * recovered / BENCH_FRAMES,
+           100.0 * miscorrected / BENCH_FRAMES,
+           100.0 * (BENCH_FRAMES - recovered - miscorrected) / BENCH_FRAMES,
+           us / BENCH_FRAMES);
+
+    /* a single bit error is always within reach of the decoder */
+    if (errors == 1) {
+      HOST_CHECK(recovered == BENCH_FRAMES);
+    }
+    /* and no more than OGNTP_LDPC_MAX_FLIPS are ever repaired */
+    if (errors > OGNTP_LDPC_MAX_FLIPS) {
+      HOST_CHECK(recovered == 0);
+    }
+  }
+
+  return Host_Result("LDPC_bench");
+}
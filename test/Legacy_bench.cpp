@@ -0,0 +1,100 @@
+/*
+ * Legacy_bench.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Decode rate of "Legacy" frames from BENCH_SENDERS aircraft, which
+ * take turns on air. The Makefile builds it twice: with the key cache
+ * of the platform and with a single entry, which misses on every frame
+ * the way make_key() ran for every frame before.
+ */
+
+#include <TimeLib.h>
+
+#include "Host.h"
+#include "../src/TrafficHelper.h"
+#include "../src/driver/RF.h"
+
+#define BENCH_SENDERS         32
+#define BENCH_FRAMES          32000
+#define BENCH_RUNS            50
+#define BENCH_ADDR(n)         (0x400000 + (n))
+
+static legacy_packet_t Bench_Frame[BENCH_SENDERS];
+static ufo_t           Bench_Sender[BENCH_SENDERS];
+
+volatile float         Bench_Sink;
+
+static void Bench_Encode()
+{
+  for (int i=0; i < BENCH_SENDERS; i++) {
+    ufo_t *fop = &Bench_Sender[i];
+
+    *fop = EmptyFO;
+    fop->addr      = BENCH_ADDR(i);
+    fop->timestamp = now();
+    fop->course    = 360.0 * i / BENCH_SENDERS;
+    fop->speed     = 60.0; /* knots */
+    Host_Place(fop, 1000.0 + 200.0 * i, fop->course);
+
+    legacy_encode(&Bench_Frame[i], fop);
+  }
+}
+
+/*
+ * ns per frame. Frames are decrypted in place,
+ * each decode takes a fresh copy.
+ */
+static double Bench_Decode()
+{
+  ufo_t fo;
+  double t0 = Host_Time_us();
+
+  for (int n=0; n < BENCH_FRAMES; n++) {
+    legacy_packet_t pkt = Bench_Frame[n % BENCH_SENDERS];
+
+    legacy_decode(&pkt, &ThisAircraft, &fo);
+    Bench_Sink = fo.latitude;
+  }
+
+  return (Host_Time_us() - t0) * 1000.0 / BENCH_FRAMES;
+}
+
+int main()
+{
+  Host_setup();
+  Bench_Encode();
+
+  /* every frame decodes to its sender */
+  for (int i=0; i < BENCH_SENDERS; i++) {
+    legacy_packet_t pkt = Bench_Frame[i];
+    ufo_t fo;
+
+    HOST_CHECK(legacy_decode(&pkt, &ThisAircraft, &fo));
+    HOST_CHECK(fo.addr == BENCH_ADDR(i));
+    HOST_CHECK(fabs(fo.latitude  - Bench_Sender[i].latitude)  < 1e-4);
+    HOST_CHECK(fabs(fo.longitude - Bench_Sender[i].longitude) < 1e-4);
+  }
+
+  double single = Host_Best(Bench_Decode, BENCH_RUNS);
+
+  printf("key cache of %d, %d senders, frames/s\n",
+         LEGACY_KEY_CACHE_SIZE, BENCH_SENDERS);
+  printf("legacy_decode()        %9.0f\n", 1e9 / single);
+
+  return Host_Result("Legacy_bench");
+}
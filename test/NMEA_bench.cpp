@@ -0,0 +1,257 @@
+/*
+ * NMEA_bench.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * PFLAA sentences per second of NMEA_Export(), against the snprintf_P,
+ * dtostrf and String code it had before, which is kept here. Both write
+ * the same batch for the same targets. The scheduler is left out of the
+ * build, so that every target goes out on every call.
+ */
+
+#include <TimeLib.h>
+#include <nmealib.h>
+
+#include "Host.h"
+#include "../src/TrafficHelper.h"
+#include "../src/driver/RF.h"
+#include "../src/driver/EEPROM.h"
+#include "../src/driver/GNSS.h"
+#include "../src/driver/WiFi.h"
+#include "../src/driver/Battery.h"
+#include "../src/protocol/data/NMEA.h"
+#include "../src/protocol/data/JSON.h"
+
+#define BENCH_TARGETS         8
+#define BENCH_CALLS           2000
+#define BENCH_RUNS            20
+
+#define ADDR_TO_HEX_STR(s, c) (s += ((c) < 0x10 ? "0" : "") + String((c), HEX))
+
+extern const char *NMEA_CallSign_Prefix[];
+
+/* GNSS.cpp, JSON.cpp, Battery.cpp, WiFi.cpp, SoC.cpp and nmealib */
+TinyGPSPlus gnss;
+bool hasValidGPSDFix = true;
+char UDPpacketBuffer[UDP_PACKET_BUFSIZE];
+const SoC_ops_t *SoC;
+
+bool  isValidGNSSFix()                { return true; }
+int   LookupSeparation(float, float)  { return 0;    }
+float Battery_voltage()               { return 4.0;  }
+float Battery_threshold()             { return 3.5;  }
+
+void   nmeaInfoClear(NmeaInfo *) {}
+void   nmeaTimeSet(NmeaTime *, uint32_t *, struct timeval *) {}
+size_t nmeaSentenceFromInfo(NmeaMallocedBuffer *, const NmeaInfo *, NmeaSentence)
+{
+  return 0;
+}
+
+static char      Bench_Out[NMEA_BATCH_SIZE * 2];
+static size_t    Bench_Out_Len;
+static SoC_ops_t Bench_SoC = { SOC_NONE, "Bench" };
+
+static size_t Bench_Write(const uint8_t *buf, size_t size)
+{
+  if (Bench_Out_Len + size <= sizeof(Bench_Out)) {
+    memcpy(Bench_Out + Bench_Out_Len, buf, size);
+    Bench_Out_Len += size;
+  }
+
+  return size;
+}
+
+static IODev_ops_t Bench_UART = {
+  "Bench UART", NULL, NULL, NULL, NULL, NULL, Bench_Write
+};
+
+static char   Bench_Batch[NMEA_BATCH_SIZE];
+static size_t Bench_Batch_Len;
+static char   Bench_Callsign[NMEA_CALLSIGN_SIZE];
+
+static char *ltrim(char *s)
+{
+  if(s) {
+    while(*s && isspace(*s))
+      ++s;
+  }
+
+  return s;
+}
+
+/* PFLAA part of NMEA_Export() as it was */
+static void Bench_Export_Before()
+{
+  time_t this_moment = now();
+
+  Traffic_Extrapolate();
+
+  for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    if (Traffic_Hot.addr[i] && (this_moment - Traffic_Hot.timestamp[i]) <= EXPORT_EXPIRATION_TIME) {
+      float distance = Container[i].distance;
+
+      if (distance < ALARM_ZONE_NONE) {
+        int bearing     = Container[i].bearing;
+        int alarm_level = Container[i].alarm_level;
+        int alt_diff    = (int) (Container[i].altitude - ThisAircraft.altitude);
+
+        char str_climb_rate[8] = "";
+        uint8_t addr_type = Container[i].addr_type > ADDR_TYPE_ANONYMOUS ?
+                            ADDR_TYPE_ANONYMOUS : Container[i].addr_type;
+
+        if (!Container[i].stealth && !ThisAircraft.stealth) {
+          dtostrf(
+            constrain(Container[i].vs / (_GPS_FEET_PER_METER * 60.0), -32.7, 32.7),
+            5, 1, str_climb_rate);
+        }
+
+        memset((void *) Bench_Callsign, 0, sizeof(Bench_Callsign));
+
+        if (strnlen((char *) Container[i].callsign, sizeof(Container[i].callsign)) > 0) {
+          memcpy(Bench_Callsign, Container[i].callsign, sizeof(Container[i].callsign));
+        } else {
+          memcpy(Bench_Callsign, NMEA_CallSign_Prefix[Container[i].protocol],
+            strlen(NMEA_CallSign_Prefix[Container[i].protocol]));
+
+          String str = "_";
+
+          ADDR_TO_HEX_STR(str, (Container[i].addr >> 16) & 0xFF);
+          ADDR_TO_HEX_STR(str, (Container[i].addr >>  8) & 0xFF);
+          ADDR_TO_HEX_STR(str, (Container[i].addr      ) & 0xFF);
+
+          str.toUpperCase();
+          memcpy(Bench_Callsign + strlen(NMEA_CallSign_Prefix[Container[i].protocol]),
+            str.c_str(), str.length());
+        }
+
+        snprintf_P(NMEABuffer, sizeof(NMEABuffer),
+                PSTR("$PFLAA,%d,%d,%d,%d,%d,%06X!%s,%d,,%d,%s,%d" PFLAA_EXT1_FMT "*"),
+                alarm_level,
+                (int) (distance * cos(radians(bearing))), (int) (distance * sin(radians(bearing))),
+                alt_diff, addr_type, Container[i].addr, Bench_Callsign,
+                (int) Container[i].course, (int) (Container[i].speed * _GPS_MPS_PER_KNOT),
+                ltrim(str_climb_rate), Container[i].aircraft_type
+                PFLAA_EXT1_ARGS );
+
+        NMEA_add_checksum(NMEABuffer, sizeof(NMEABuffer) - strlen(NMEABuffer));
+
+        size_t len = strlen(NMEABuffer);
+        memcpy(Bench_Batch + Bench_Batch_Len, NMEABuffer, len);
+        Bench_Batch_Len += len;
+      }
+    }
+  }
+
+  Bench_Write((const uint8_t *) Bench_Batch, Bench_Batch_Len);
+  Bench_Batch_Len = 0;
+}
+
+static void Bench_Fill()
+{
+  static const uint8_t protocols[] = {
+    RF_PROTOCOL_LEGACY, RF_PROTOCOL_OGNTP, RF_PROTOCOL_ADSB_1090, RF_PROTOCOL_ADSB_UAT
+  };
+
+  for (int i=0; i < BENCH_TARGETS; i++) {
+    ufo_t fo = EmptyFO;
+
+    fo.addr          = 0x3A0F00 + 0x1111 * i;
+    fo.addr_type     = ADDR_TYPE_ICAO;
+    fo.protocol      = protocols[i % sizeof(protocols)];
+    fo.timestamp     = now();
+    fo.course        = 45.0 * i;
+    fo.speed         = 50.0 + 20.0 * i;           /* knots */
+    fo.vs            = -900.0 + 230.0 * i + 7.0;  /* fpm */
+    fo.aircraft_type = 1 + i % 9;
+    if (i >= BENCH_TARGETS / 2 && i % 2) {
+      snprintf((char *) fo.callsign, sizeof(fo.callsign), "DLH%d", 400 + i);
+    }
+    Host_Place(&fo, 1500.0 + 900.0 * i, 40.0 * i + 5.0);
+    fo.altitude     += 30.0 * i - 100.0;
+
+    Traffic_Update(&fo);
+    Traffic_Store(&fo);
+  }
+}
+
+static double Bench_After()
+{
+  double t0 = Host_Time_us();
+
+  for (int n=0; n < BENCH_CALLS; n++) {
+    Bench_Out_Len = 0;
+    NMEA_Export();
+  }
+
+  return (Host_Time_us() - t0) / BENCH_CALLS;
+}
+
+static double Bench_Before()
+{
+  double t0 = Host_Time_us();
+
+  for (int n=0; n < BENCH_CALLS; n++) {
+    Bench_Out_Len = 0;
+    Bench_Export_Before();
+  }
+
+  return (Host_Time_us() - t0) / BENCH_CALLS;
+}
+
+int main()
+{
+  static char before[sizeof(Bench_Out)];
+  size_t before_len;
+
+  Host_setup();
+  settings->alarm    = TRAFFIC_ALARM_NONE;
+  settings->nmea_l   = true;
+  settings->nmea_out = NMEA_UART;
+
+  Bench_SoC.UART_ops = &Bench_UART;
+  SoC = &Bench_SoC;
+
+  Traffic_setup();
+  Bench_Fill();
+  HOST_CHECK(Traffic_Count() == BENCH_TARGETS);
+
+  /* both write the same bytes */
+  Bench_Out_Len = 0;
+  Bench_Export_Before();
+  memcpy(before, Bench_Out, Bench_Out_Len);
+  before_len = Bench_Out_Len;
+
+  Bench_Out_Len = 0;
+  NMEA_Export();
+  HOST_CHECK(before_len > 0 && Bench_Out_Len == before_len &&
+             memcmp(before, Bench_Out, before_len) == 0);
+
+  /* the runs take turns and the best of each is kept */
+  double us_before = 1e9, us_after = 1e9;
+
+  for (int r=0; r < BENCH_RUNS; r++) {
+    us_before = fmin(us_before, Bench_Before());
+    us_after  = fmin(us_after,  Bench_After());
+  }
+
+  printf("PFLAA, %d targets, sentences/s\n", BENCH_TARGETS);
+  printf("snprintf_P, dtostrf, String  %9.0f\n", BENCH_TARGETS * 1e6 / us_before);
+  printf("NMEA_Export()                %9.0f\n", BENCH_TARGETS * 1e6 / us_after);
+
+  return Host_Result("NMEA_bench");
+}
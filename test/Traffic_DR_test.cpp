@@ -0,0 +1,182 @@
+/*
+ * Traffic_DR_test.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Dead reckoning against ground truth. A target circles at 40 m/s and
+ * 3 degrees per second, one fix a second is sent and a share of them is
+ * lost. Every 100 ms the position of the Container[] entry after
+ * Traffic_Extrapolate() is compared with the true one, and so is the
+ * last received fix, which is what the store kept before.
+ * Then a projected entry has to be flagged as such, and an expired
+ * one has to stay where it was received.
+ */
+
+#include <TimeLib.h>
+
+#include "Host.h"
+#include "../src/TrafficHelper.h"
+#include "../src/driver/RF.h"
+
+#define TEST_ADDR             0x3A0F11
+#define TEST_PROTOCOL         RF_PROTOCOL_OGNTP
+#define TEST_SPEED            40.0  /* m/s */
+#define TEST_TURN             3.0   /* degrees per second */
+#define TEST_RADIUS           2000  /* metres, centre of the circle from ThisAircraft */
+#define TEST_DURATION_MS      600000
+#define TEST_STEP_MS          100
+#define TEST_FIX_MS           1000
+
+static const double m_per_deg = 111195.0;
+
+static uint32_t Test_Random = 7;
+
+/* same sequence on any host */
+static double Test_Uniform()
+{
+  Test_Random = Test_Random * 1103515245 + 12345;
+
+  return ((Test_Random >> 8) & 0xFFFF) / 65536.0;
+}
+
+/* true position in metres north and east of ThisAircraft, and course */
+static void Test_Truth(double t, double *north, double *east, double *course)
+{
+  double w = radians(TEST_TURN);
+  double r = TEST_SPEED / w;
+
+  *north  = TEST_RADIUS + r * sin(w * t);
+  *east   = r * (1.0 - cos(w * t));
+  *course = fmod(TEST_TURN * t, 360.0);
+}
+
+static double Test_Error(float lat, float lon, double north, double east)
+{
+  double dn = (lat - ThisAircraft.latitude) * m_per_deg - north;
+  double de = (lon - ThisAircraft.longitude) * m_per_deg *
+              cos(radians(ThisAircraft.latitude)) - east;
+
+  return sqrt(dn * dn + de * de);
+}
+
+int main()
+{
+  static const double losses[] = { 0.0, 0.2, 0.4, 0.6 };
+
+  printf("loss   held fix (m)   dead reckoning (m)   worst (m)\n");
+
+  for (size_t l=0; l < sizeof(losses) / sizeof(losses[0]); l++) {
+    double held = 0, dr = 0, worst = 0;
+    float fix_lat = 0, fix_lon = 0;
+    int samples = 0;
+    bool fixed = false;
+
+    Host_setup();
+    Traffic_setup();
+    Test_Random = 7;
+
+    for (uint32_t ms=0; ms < TEST_DURATION_MS; ms += TEST_STEP_MS) {
+      double north, east, course;
+
+      Host_Clock_Set(ms);
+      ThisAircraft.timestamp = now();
+      Test_Truth(ms / 1000.0, &north, &east, &course);
+
+      if (ms % TEST_FIX_MS == 0 && Test_Uniform() >= losses[l]) {
+        ufo_t fo = EmptyFO;
+
+        fo.addr      = TEST_ADDR;
+        fo.addr_type = ADDR_TYPE_FLARM;
+        fo.protocol  = TEST_PROTOCOL;
+        fo.timestamp = now();
+        fo.latitude  = ThisAircraft.latitude + north / m_per_deg;
+        fo.longitude = ThisAircraft.longitude + east /
+                       (m_per_deg * cos(radians(ThisAircraft.latitude)));
+        fo.altitude  = ThisAircraft.altitude;
+        fo.course    = course;
+        fo.speed     = TEST_SPEED / _GPS_MPS_PER_KNOT;
+
+        Traffic_Update(&fo);
+        Traffic_Store(&fo);
+
+        fix_lat = fo.latitude;
+        fix_lon = fo.longitude;
+        fixed   = true;
+      }
+
+      if (!fixed) {
+        continue;
+      }
+
+      Traffic_Extrapolate();
+
+      ufo_t *fop = Traffic_Lookup(TEST_ADDR, TEST_PROTOCOL);
+      if (!HOST_CHECK(fop != NULL)) {
+        break;
+      }
+
+      double e = Test_Error(fop->latitude, fop->longitude, north, east);
+
+      dr   += e;
+      held += Test_Error(fix_lat, fix_lon, north, east);
+      worst = e > worst ? e : worst;
+      samples++;
+    }
+
+    held /= samples;
+    dr   /= samples;
+
+    printf("%3.0f %%  %13.1f  %19.1f  %10.1f\n", losses[l] * 100, held, dr, worst);
+
+    /* the turn rate comes from the fixes, the track is followed within metres */
+    HOST_CHECK(dr < held / 4);
+    HOST_CHECK(dr < 5.0);
+  }
+
+  Host_setup();
+  Traffic_setup();
+  Host_Clock_Set(0);
+  ThisAircraft.timestamp = now();
+
+  ufo_t fo = EmptyFO;
+
+  fo.addr      = TEST_ADDR;
+  fo.addr_type = ADDR_TYPE_FLARM;
+  fo.protocol  = TEST_PROTOCOL;
+  fo.timestamp = now();
+  fo.course    = 90.0;
+  fo.speed     = TEST_SPEED / _GPS_MPS_PER_KNOT;
+  Host_Place(&fo, TEST_RADIUS, 0.0);
+
+  Traffic_Update(&fo);
+  ufo_t *fop = Traffic_Store(&fo);
+  HOST_CHECK(fop != NULL && !Traffic_Extrapolated(fop));
+
+  Host_Clock_Set(1000);
+  Traffic_Extrapolate();
+  HOST_CHECK(Traffic_Extrapolated(fop));
+  HOST_CHECK(fop->longitude > fo.longitude);
+
+  float longitude = fop->longitude;
+
+  Host_Clock_Set((ENTRY_EXPIRATION_TIME + 1) * 1000);
+  ThisAircraft.timestamp = now();
+  Traffic_Extrapolate();
+  HOST_CHECK(fop->longitude == longitude);
+
+  return Host_Result("Traffic_DR_test");
+}
@@ -0,0 +1,106 @@
+/*
+ * Traffic_Fusion_test.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * One aircraft heard through Legacy, ADS-B and OGNTP ends up in one
+ * Container[] slot: by address first, then by range for an anonymous
+ * record. The track keeps the protocol it was created with, the
+ * position source and the alarm level follow the freshest best source.
+ */
+
+#include <TimeLib.h>
+
+#include "Host.h"
+#include "../src/TrafficHelper.h"
+#include "../src/driver/RF.h"
+
+#define TEST_ADDR             0x3C6589
+#define TEST_ANON_ADDR        0x1D2E3F
+#define TEST_FAR_ADDR         0x2A3B4C
+#define TEST_RANGE            2000.0 /* metres, no alarm */
+
+static ufo_t *Test_Record(uint32_t addr, uint8_t addr_type, uint8_t protocol,
+                          float distance, float bearing)
+{
+  ufo_t fo = EmptyFO;
+
+  fo.addr      = addr;
+  fo.addr_type = addr_type;
+  fo.protocol  = protocol;
+  fo.timestamp = now();
+  Host_Place(&fo, distance, bearing);
+
+  Traffic_Update(&fo);
+
+  return Traffic_Store(&fo);
+}
+
+int main()
+{
+  Host_setup();
+  Traffic_setup();
+
+  ufo_t *track = Test_Record(TEST_ADDR, ADDR_TYPE_ICAO, RF_PROTOCOL_LEGACY,
+                             TEST_RANGE, 0.0);
+  HOST_CHECK(track != NULL);
+
+  /* same address over ADS-B: one track, Legacy keeps the position */
+  Host_Clock_Step(500);
+  HOST_CHECK(Test_Record(TEST_ADDR, ADDR_TYPE_ICAO, RF_PROTOCOL_ADSB_1090,
+                         TEST_RANGE + 30.0, 0.0) == track);
+  HOST_CHECK(Traffic_Count() == 1);
+  HOST_CHECK(track->protocol == RF_PROTOCOL_LEGACY);
+  HOST_CHECK(Traffic_Position_Source(track) == RF_PROTOCOL_LEGACY);
+
+  /* Legacy goes silent, ADS-B takes over the position but not the ID */
+  Host_Clock_Step(4000);
+  HOST_CHECK(Test_Record(TEST_ADDR, ADDR_TYPE_ICAO, RF_PROTOCOL_ADSB_1090,
+                         ALARM_ZONE_URGENT / 2, 0.0) == track);
+  HOST_CHECK(track->protocol == RF_PROTOCOL_LEGACY);
+  HOST_CHECK(Traffic_Position_Source(track) == RF_PROTOCOL_ADSB_1090);
+  HOST_CHECK(Traffic_Lookup(TEST_ADDR, RF_PROTOCOL_LEGACY) == track);
+  HOST_CHECK(track->alarm_level > ALARM_LEVEL_NONE);
+
+  /* the alarm level comes with the position, down as well as up */
+  Host_Clock_Step(500);
+  HOST_CHECK(Test_Record(TEST_ADDR, ADDR_TYPE_ICAO, RF_PROTOCOL_ADSB_1090,
+                         TEST_RANGE, 0.0) == track);
+  HOST_CHECK(track->alarm_level == ALARM_LEVEL_NONE);
+
+  /* an anonymous OGNTP record next to it joins the track */
+  Host_Clock_Step(500);
+  HOST_CHECK(Test_Record(TEST_ANON_ADDR, ADDR_TYPE_ANONYMOUS, RF_PROTOCOL_OGNTP,
+                         TEST_RANGE + 50.0, 1.0) == track);
+  HOST_CHECK(Traffic_Count() == 1);
+  HOST_CHECK(Traffic_Lookup(TEST_ANON_ADDR, RF_PROTOCOL_OGNTP) == track);
+  HOST_CHECK(track->protocol == RF_PROTOCOL_LEGACY);
+
+  /* one far away is another aircraft */
+  ufo_t *far = Test_Record(TEST_FAR_ADDR, ADDR_TYPE_ANONYMOUS, RF_PROTOCOL_FANET,
+                           TEST_RANGE, 180.0);
+  HOST_CHECK(far != NULL && far != track);
+  HOST_CHECK(Traffic_Count() == 2);
+
+  /* once the track is gone, the grid does not return it */
+  Traffic_Remove(track);
+  HOST_CHECK(Test_Record(TEST_ANON_ADDR + 1, ADDR_TYPE_ANONYMOUS, RF_PROTOCOL_P3I,
+                         TEST_RANGE, 0.0) != NULL);
+  HOST_CHECK(Traffic_Count() == 2);
+
+  return Host_Result("Traffic_Fusion_test");
+}
@@ -0,0 +1,141 @@
+/*
+ * Traffic_test.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Traffic_Store() past MAX_TRACKING_OBJECTS: the least threatening
+ * target gives room to a more threatening one, a less threatening one
+ * is refused, and an expired target goes before any live one.
+ * Of two targets at the same range, the closing one is kept.
+ */
+
+#include <TimeLib.h>
+
+#include "Host.h"
+#include "../src/TrafficHelper.h"
+#include "../src/driver/RF.h"
+
+#define TEST_ADDR(n)          (0x400000 + (n))
+#define TEST_PROTOCOL         RF_PROTOCOL_LEGACY
+#define TEST_RANGE(n)         (2000.0 + 500.0 * (n)) /* metres, no alarm */
+#define TEST_SPEED            200.0 /* knots, CPA within TRAFFIC_THREAT_HORIZON at 3 km */
+
+static ufo_t *Test_Target(uint32_t addr, float distance,
+                          float course = 0.0, float speed = 0.0)
+{
+  ufo_t fo = EmptyFO;
+
+  fo.addr      = addr;
+  fo.addr_type = ADDR_TYPE_FLARM;
+  fo.protocol  = TEST_PROTOCOL;
+  fo.timestamp = now();
+  fo.course    = course;
+  fo.speed     = speed;
+  Host_Place(&fo, distance, 90.0);
+
+  Traffic_Update(&fo);
+
+  return Traffic_Store(&fo);
+}
+
+static bool Test_Kept(uint32_t addr)
+{
+  return Traffic_Lookup(addr, TEST_PROTOCOL) != NULL;
+}
+
+int main()
+{
+  const int n = MAX_TRACKING_OBJECTS;
+
+  Host_setup();
+  Traffic_setup();
+
+  /* fill the container, target k is k-th nearest */
+  for (int k=0; k < n; k++) {
+    HOST_CHECK(Test_Target(TEST_ADDR(k), TEST_RANGE(k)) != NULL);
+  }
+  HOST_CHECK(Traffic_Count() == n);
+
+  /* a target farther than all of them is refused */
+  HOST_CHECK(Test_Target(TEST_ADDR(n), TEST_RANGE(n)) == NULL);
+  HOST_CHECK(!Test_Kept(TEST_ADDR(n)));
+
+  /* closer targets push the farthest ones out, one at a time */
+  for (int k=0; k < n / 4; k++) {
+    uint32_t addr = TEST_ADDR(n + 1 + k);
+
+    HOST_CHECK(Test_Target(addr, TEST_RANGE(0) - 100.0 * (k + 1)) != NULL);
+    HOST_CHECK(Test_Kept(addr));
+    HOST_CHECK(!Test_Kept(TEST_ADDR(n - 1 - k)));
+  }
+  for (int k=0; k < n - n / 4; k++) {
+    HOST_CHECK(Test_Kept(TEST_ADDR(k)));
+  }
+  HOST_CHECK(Traffic_Count() == n);
+
+  /* a target in alarm beats the farthest one, at any range */
+  ufo_t *alarm = Test_Target(TEST_ADDR(2 * n), ALARM_ZONE_URGENT / 2);
+  HOST_CHECK(alarm != NULL && alarm->alarm_level > ALARM_LEVEL_NONE);
+  HOST_CHECK(!Test_Kept(TEST_ADDR(n - 1 - n / 4)));
+
+  /* an update of a stored target takes no room */
+  HOST_CHECK(Test_Target(TEST_ADDR(0), TEST_RANGE(0)) != NULL);
+  HOST_CHECK(Traffic_Count() == n);
+
+  /*
+   * Refresh all of them but the nearest FLARM one, which is then
+   * stale: a new target, farther than any, takes its slot.
+   */
+  Host_Clock_Step((ENTRY_EXPIRATION_TIME + 1) * 1000);
+  ThisAircraft.timestamp = now();
+
+  for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    uint32_t addr = Traffic_Hot.addr[i];
+
+    if (addr != 0 && addr != TEST_ADDR(n + n / 4)) {
+      HOST_CHECK(Test_Target(addr, Container[i].distance) != NULL);
+    }
+  }
+
+  HOST_CHECK(Test_Target(TEST_ADDR(3 * n), TEST_RANGE(2 * n)) != NULL);
+  HOST_CHECK(Test_Kept(TEST_ADDR(3 * n)));
+  HOST_CHECK(!Test_Kept(TEST_ADDR(n + n / 4)));
+  HOST_CHECK(Traffic_Count() == n);
+
+  /*
+   * Start over with two targets at the same range, farther than
+   * the rest. The closing one comes first, still the receding one
+   * is the one to give room to a slightly nearer newcomer.
+   */
+  Host_Clock_Step((ENTRY_EXPIRATION_TIME + 1) * 1000);
+  ThisAircraft.timestamp = now();
+  ClearExpired();
+  HOST_CHECK(Traffic_Count() == 0);
+
+  for (int k=0; k < n - 2; k++) {
+    HOST_CHECK(Test_Target(TEST_ADDR(4 * n + k), 1000.0 + 100.0 * k) != NULL);
+  }
+  HOST_CHECK(Test_Target(TEST_ADDR(5 * n),     3000.0, 270.0, TEST_SPEED) != NULL);
+  HOST_CHECK(Test_Target(TEST_ADDR(5 * n + 1), 3000.0,  90.0, TEST_SPEED) != NULL);
+  HOST_CHECK(Traffic_Count() == n);
+
+  HOST_CHECK(Test_Target(TEST_ADDR(5 * n + 2), 2900.0) != NULL);
+  HOST_CHECK(Test_Kept(TEST_ADDR(5 * n)));
+  HOST_CHECK(!Test_Kept(TEST_ADDR(5 * n + 1)));
+
+  return Host_Result("Traffic_test");
+}